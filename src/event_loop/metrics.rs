@@ -0,0 +1,202 @@
+// Event loop counters behind `perf_hooks`: idle time spent blocked in
+// `poll_oneoff` (for eventLoopUtilization) and a delay histogram fed by a
+// sampling clock, like node's monitorEventLoopDelay.
+
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+// Log-linear buckets in the spirit of HdrHistogram: values below
+// 2^SUB_BITS are exact, above that every power of two is split into
+// 2^SUB_BITS linear buckets, i.e. ~3% relative error with SUB_BITS = 5.
+const SUB_BITS: u32 = 5;
+const SUB_COUNT: usize = 1 << SUB_BITS;
+const MAX_EXP: usize = 64 - SUB_BITS as usize;
+
+pub struct Histogram {
+    counts: Vec<u64>,
+    count: u64,
+    min: u64,
+    max: u64,
+    sum: f64,
+    sum_sq: f64,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Histogram {
+            counts: vec![0; (MAX_EXP + 1) * SUB_COUNT],
+            count: 0,
+            min: u64::MAX,
+            max: 0,
+            sum: 0.0,
+            sum_sq: 0.0,
+        }
+    }
+}
+
+fn bucket_of(v: u64) -> usize {
+    if v < SUB_COUNT as u64 {
+        return v as usize;
+    }
+    let exp = 63 - v.leading_zeros() - SUB_BITS + 1;
+    let sub = (v >> (exp - 1)) as usize - SUB_COUNT;
+    exp as usize * SUB_COUNT + sub
+}
+
+/// Highest value that maps to `bucket`.
+fn bucket_max(bucket: usize) -> u64 {
+    let exp = (bucket / SUB_COUNT) as u32;
+    let sub = (bucket % SUB_COUNT) as u64;
+    if exp == 0 {
+        sub
+    } else {
+        let max = ((SUB_COUNT as u128 + sub as u128 + 1) << (exp - 1)) - 1;
+        max.min(u64::MAX as u128) as u64
+    }
+}
+
+impl Histogram {
+    pub fn record(&mut self, v: u64) {
+        self.counts[bucket_of(v)] += 1;
+        self.count += 1;
+        self.min = self.min.min(v);
+        self.max = self.max.max(v);
+        self.sum += v as f64;
+        self.sum_sq += (v as f64) * (v as f64);
+    }
+
+    pub fn reset(&mut self) {
+        *self = Histogram::default();
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    pub fn min(&self) -> u64 {
+        if self.count == 0 {
+            0
+        } else {
+            self.min
+        }
+    }
+
+    pub fn max(&self) -> u64 {
+        self.max
+    }
+
+    pub fn mean(&self) -> f64 {
+        if self.count == 0 {
+            f64::NAN
+        } else {
+            self.sum / self.count as f64
+        }
+    }
+
+    pub fn stddev(&self) -> f64 {
+        if self.count == 0 {
+            return f64::NAN;
+        }
+        let mean = self.mean();
+        (self.sum_sq / self.count as f64 - mean * mean)
+            .max(0.0)
+            .sqrt()
+    }
+
+    /// Value at percentile `p` in (0, 100], clamped to the recorded range.
+    pub fn percentile(&self, p: f64) -> u64 {
+        if self.count == 0 {
+            return 0;
+        }
+        let target = ((p / 100.0) * self.count as f64).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for (bucket, &n) in self.counts.iter().enumerate() {
+            seen += n;
+            if seen >= target {
+                return bucket_max(bucket).min(self.max).max(self.min);
+            }
+        }
+        self.max
+    }
+}
+
+struct DelayMonitor {
+    resolution: Duration,
+    prev: Instant,
+    next: Instant,
+}
+
+pub struct LoopMetrics {
+    origin: Instant,
+    origin_wall_ms: f64,
+    idle: Duration,
+    monitor: Option<DelayMonitor>,
+    pub delay: Histogram,
+}
+
+impl Default for LoopMetrics {
+    fn default() -> Self {
+        LoopMetrics {
+            origin: Instant::now(),
+            origin_wall_ms: SystemTime::now()
+                .duration_since(UNIX_EPOCH)
+                .unwrap_or_default()
+                .as_secs_f64()
+                * 1000.0,
+            idle: Duration::default(),
+            monitor: None,
+            delay: Histogram::default(),
+        }
+    }
+}
+
+impl LoopMetrics {
+    /// Milliseconds since the time origin, on the monotonic clock.
+    pub fn now_ms(&self) -> f64 {
+        self.origin.elapsed().as_secs_f64() * 1000.0
+    }
+
+    pub fn time_origin_ms(&self) -> f64 {
+        self.origin_wall_ms
+    }
+
+    /// Total milliseconds spent blocked in `poll_oneoff`.
+    pub fn idle_ms(&self) -> f64 {
+        self.idle.as_secs_f64() * 1000.0
+    }
+
+    pub(crate) fn add_idle(&mut self, idle: Duration) {
+        self.idle += idle;
+    }
+
+    pub fn enable_delay_monitor(&mut self, resolution: Duration) {
+        let now = Instant::now();
+        self.monitor = Some(DelayMonitor {
+            resolution,
+            prev: now,
+            next: now + resolution,
+        });
+    }
+
+    pub fn disable_delay_monitor(&mut self) {
+        self.monitor = None;
+    }
+
+    /// When the next delay sample is due, if monitoring.
+    pub(crate) fn next_delay_check(&self) -> Option<Instant> {
+        self.monitor.as_ref().map(|m| m.next)
+    }
+
+    /// Records the interval since the previous sample once a sample is due.
+    /// A loop blocked by synchronous work shows up as a long interval.
+    pub(crate) fn check_delay(&mut self) {
+        if let Some(m) = &mut self.monitor {
+            let now = Instant::now();
+            if now >= m.next {
+                self.delay
+                    .record(now.duration_since(m.prev).as_nanos() as u64);
+                m.prev = now;
+                m.next = now + m.resolution;
+            }
+        }
+    }
+}
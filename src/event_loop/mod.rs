@@ -1,6 +1,8 @@
+pub mod metrics;
 mod poll;
 pub mod wasi_fs;
 
+use crate::event_loop::metrics::LoopMetrics;
 use crate::event_loop::poll::{Eventtype, Subscription};
 use crate::{quickjs_sys as qjs, Context, JsValue};
 use std::borrow::BorrowMut;
@@ -9,6 +11,9 @@ use std::collections::{HashMap, LinkedList};
 use std::io;
 use std::mem::ManuallyDrop;
 use std::ops::Add;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{Receiver, TryRecvError};
+use std::sync::Arc;
 
 pub enum PollResult {
     Timeout,
@@ -88,6 +93,48 @@ impl FdWriteTask {
     }
 }
 
+const DEADLINE_USERDATA: u64 = u64::MAX;
+const DELAY_SAMPLE_USERDATA: u64 = u64::MAX - 1;
+const CHANNEL_WAKE_USERDATA: u64 = u64::MAX - 2;
+
+// poll_oneoff can't be woken up by another thread, so while channels are
+// open the loop wakes up at this interval to check them.
+const CHANNEL_POLL_INTERVAL: std::time::Duration = std::time::Duration::from_millis(1);
+
+fn deadline_subscription(userdata: u64, timeout: std::time::Duration) -> Subscription {
+    poll::Subscription {
+        userdata,
+        u: poll::SubscriptionU {
+            tag: poll::EVENTTYPE_CLOCK,
+            u: poll::SubscriptionUU {
+                clock: poll::SubscriptionClock {
+                    id: poll::CLOCKID_MONOTONIC,
+                    timeout: timeout.as_nanos() as u64,
+                    precision: 0,
+                    flags: 0,
+                },
+            },
+        },
+    }
+}
+
+fn budget_exceeded() -> io::Error {
+    io::Error::new(io::ErrorKind::TimedOut, "time budget exceeded")
+}
+
+/// Sent to an event loop from another thread, see `EventLoop::add_channel`.
+pub enum ChannelMessage {
+    Data(qjs::Serialized),
+    Error(String),
+    Exit(i32),
+}
+
+struct ChannelTask {
+    rx: Receiver<ChannelMessage>,
+    callback: qjs::JsFunction,
+    refed: bool,
+}
+
 enum PollTask {
     Timeout(TimeoutTask),
     FdRead(FdReadTask),
@@ -117,7 +164,32 @@ impl IoSelector {
         self.tasks.get_mut(id)?.take()
     }
 
-    pub fn poll(&mut self, ctx: &mut qjs::Context) -> io::Result<usize> {
+    /// How long `poll` would sleep if only timers are pending. `None` when
+    /// nothing is pending or an fd event could arrive at any time.
+    fn timer_wait(&self) -> Option<std::time::Duration> {
+        let mut earliest: Option<u128> = None;
+        for task in self.tasks.iter().flatten() {
+            match task {
+                PollTask::Timeout(task) => {
+                    earliest = Some(earliest.map_or(task.timeout, |t| t.min(task.timeout)));
+                }
+                _ => return None,
+            }
+        }
+        let now = std::time::SystemTime::now()
+            .duration_since(std::time::UNIX_EPOCH)
+            .ok()?
+            .as_nanos();
+        earliest.map(|t| std::time::Duration::from_nanos(t.saturating_sub(now) as u64))
+    }
+
+    pub fn poll(
+        &mut self,
+        ctx: &mut qjs::Context,
+        deadline: Option<std::time::Instant>,
+        wake: Option<bool>,
+        metrics: &mut LoopMetrics,
+    ) -> io::Result<usize> {
         let mut subscription_vec = Vec::with_capacity(self.tasks.len());
         for (i, timeout) in self.tasks.iter().enumerate() {
             if let Some(task) = timeout {
@@ -135,9 +207,29 @@ impl IoSelector {
             }
         }
 
-        if subscription_vec.is_empty() {
+        // `wake` asks for a wake up every CHANNEL_POLL_INTERVAL, true when
+        // that alone keeps the loop alive
+        if subscription_vec.is_empty() && wake != Some(true) {
             return Ok(0);
         }
+        if wake.is_some() {
+            subscription_vec.push(deadline_subscription(
+                CHANNEL_WAKE_USERDATA,
+                CHANNEL_POLL_INTERVAL,
+            ));
+        }
+        if let Some(deadline) = deadline {
+            let now = std::time::Instant::now();
+            if deadline <= now {
+                return Err(budget_exceeded());
+            }
+            subscription_vec.push(deadline_subscription(DEADLINE_USERDATA, deadline - now));
+        }
+        // wakes up for the next delay sample, but never keeps the loop alive
+        if let Some(next) = metrics.next_delay_check() {
+            let timeout = next.saturating_duration_since(std::time::Instant::now());
+            subscription_vec.push(deadline_subscription(DELAY_SAMPLE_USERDATA, timeout));
+        }
         let mut revent = vec![
             poll::Event {
                 userdata: 0,
@@ -151,16 +243,30 @@ impl IoSelector {
             subscription_vec.len()
         ];
 
-        let n = unsafe {
-            poll::poll_oneoff(
-                subscription_vec.as_ptr(),
-                revent.as_mut_ptr(),
-                subscription_vec.len(),
-            )
-        }?;
+        ctx.profile_mark(None);
+        let idle_start = std::time::Instant::now();
+        let n = {
+            let _span = qjs::trace::span("poll_oneoff", "loop");
+            unsafe {
+                poll::poll_oneoff(
+                    subscription_vec.as_ptr(),
+                    revent.as_mut_ptr(),
+                    subscription_vec.len(),
+                )
+            }?
+        };
+        metrics.add_idle(idle_start.elapsed());
+        metrics.check_delay();
+        ctx.profile_mark(Some("(idle)"));
 
         for i in 0..n {
             let event = revent[i];
+            if event.userdata == DEADLINE_USERDATA {
+                return Err(budget_exceeded());
+            }
+            if event.userdata == DELAY_SAMPLE_USERDATA || event.userdata == CHANNEL_WAKE_USERDATA {
+                continue;
+            }
             let index = event.userdata as usize;
             if let Some(task) = self.delete_task(index) {
                 match (task, event.type_) {
@@ -274,15 +380,316 @@ impl IoSelector {
 pub struct EventLoop {
     next_tick_queue: LinkedList<Box<dyn FnOnce(&mut qjs::Context)>>,
     io_selector: IoSelector,
+    trap_exit: bool,
+    exit_code: Option<i32>,
+    budget: Option<Budget>,
+    timed_out: bool,
+    profiler: Option<qjs::Profiler>,
+    metrics: LoopMetrics,
+    idle_gc: IdleGc,
+    channels: Vec<Option<ChannelTask>>,
+    terminate: Option<Arc<AtomicBool>>,
+    runtime_options: Option<qjs::RuntimeOptions>,
+}
+
+/// Per script limits checked from the QuickJS interrupt handler, which runs
+/// roughly every 10k bytecode branches or calls.
+struct Budget {
+    deadline: Option<std::time::Instant>,
+    ticks_left: Option<u64>,
+}
+
+const IDLE_GC_MIN_GROWTH: usize = 256 * 1024;
+const IDLE_GC_MARGIN: std::time::Duration = std::time::Duration::from_millis(1);
+// cost assumed before the first collection was measured, ~2ms per MiB
+const IDLE_GC_INITIAL_NS_PER_KIB: f64 = 2000.0;
+
+/// Runs a full GC while the loop is about to sleep on a timer, so bursts of
+/// work that follow don't pay for it. QuickJS has no incremental collector,
+/// so a collection only starts when twice its estimated cost, measured on
+/// the previous run, still fits before the next deadline.
+#[derive(Default)]
+struct IdleGc {
+    disabled: bool,
+    heap_after_gc: usize,
+    ns_per_kib: f64,
+}
+
+impl IdleGc {
+    fn maybe_collect(&mut self, ctx: &mut qjs::Context, wait: std::time::Duration) -> bool {
+        if self.disabled {
+            return false;
+        }
+        let ns_per_kib = if self.ns_per_kib > 0.0 {
+            self.ns_per_kib
+        } else {
+            IDLE_GC_INITIAL_NS_PER_KIB
+        };
+        let fits = |bytes: usize| {
+            let kib = (bytes / 1024).max(1);
+            let estimate = std::time::Duration::from_nanos((ns_per_kib * kib as f64) as u64);
+            estimate * 2 + IDLE_GC_MARGIN <= wait
+        };
+        // Measuring the heap walks it, so only do it when the smallest heap
+        // worth collecting could be collected in time anyway. The malloc
+        // accounting can't be used, with the wasi allocator it reports
+        // little more than the allocation count.
+        let growth = (self.heap_after_gc / 8).max(IDLE_GC_MIN_GROWTH);
+        if !fits(self.heap_after_gc + growth) {
+            return false;
+        }
+        let heap = ctx.memory_usage().memory_used_size as usize;
+        if heap < self.heap_after_gc + growth || !fits(heap) {
+            return false;
+        }
+        let kib = (heap / 1024).max(1);
+
+        ctx.profile_mark(None);
+        let start = std::time::Instant::now();
+        {
+            let _span = qjs::trace::span("idle gc", "gc");
+            ctx.run_gc();
+        }
+        let cost = start.elapsed();
+        ctx.profile_mark(Some("(garbage collector)"));
+        self.ns_per_kib = cost.as_nanos() as f64 / kib as f64;
+        self.heap_after_gc = ctx.memory_usage().memory_used_size as usize;
+        true
+    }
 }
 
 impl EventLoop {
+    /// Drops every pending tick, timer and fd task. Their callbacks hold
+    /// values of the current context, so this must run before it is freed.
+    /// Workers the script started are stopped with it.
+    pub fn reset(&mut self) {
+        self.next_tick_queue.clear();
+        self.io_selector.tasks.clear();
+        crate::modules_rs::worker_threads::terminate_all();
+        self.channels.clear();
+        self.exit_code = None;
+        self.budget = None;
+        self.timed_out = false;
+        self.metrics = LoopMetrics::default();
+    }
+
+    /// Limits the script about to run to `time` of wall clock and/or
+    /// `ticks` interrupt checks. Both count from now.
+    pub fn set_budget(&mut self, time: Option<std::time::Duration>, ticks: Option<u64>) {
+        self.timed_out = false;
+        self.budget = if time.is_none() && ticks.is_none() {
+            None
+        } else {
+            Some(Budget {
+                deadline: time.map(|t| std::time::Instant::now() + t),
+                ticks_left: ticks,
+            })
+        };
+    }
+
+    pub fn set_profiler(&mut self, profiler: Option<qjs::Profiler>) {
+        self.profiler = profiler;
+    }
+
+    pub fn profiler(&mut self) -> Option<&mut qjs::Profiler> {
+        self.profiler.as_mut()
+    }
+
+    /// Idle time, delay histogram and time origin behind `perf_hooks`.
+    pub fn metrics(&mut self) -> &mut LoopMetrics {
+        &mut self.metrics
+    }
+
+    pub fn set_runtime_options(&mut self, opts: qjs::RuntimeOptions) {
+        self.runtime_options = Some(opts);
+    }
+
+    /// The options the runtime was created with, when it went through
+    /// `Runtime::new_with_options`.
+    pub fn runtime_options(&self) -> Option<&qjs::RuntimeOptions> {
+        self.runtime_options.as_ref()
+    }
+
+    /// Collects garbage while waiting on timers, on by default.
+    pub fn set_idle_gc(&mut self, enabled: bool) {
+        self.idle_gc.disabled = !enabled;
+    }
+
+    pub fn timed_out(&self) -> bool {
+        self.timed_out
+    }
+
+    /// Lets another thread stop this loop, as `worker.terminate()` does.
+    pub fn set_terminate_flag(&mut self, flag: Option<Arc<AtomicBool>>) {
+        self.terminate = flag;
+    }
+
+    /// Once the terminate flag is raised, ends the script with exit code 1.
+    fn terminated(&mut self) -> bool {
+        let raised = self
+            .terminate
+            .as_ref()
+            .map_or(false, |t| t.load(Ordering::Relaxed));
+        if raised && self.exit_code.is_none() {
+            self.exit_code = Some(1);
+        }
+        raised
+    }
+
+    /// Called by the runtime interrupt handler, true aborts the running JS.
+    pub(crate) fn on_interrupt(&mut self) -> bool {
+        if self.timed_out || self.terminated() {
+            return true;
+        }
+        if let Some(budget) = &mut self.budget {
+            if let Some(ticks) = &mut budget.ticks_left {
+                if *ticks == 0 {
+                    self.timed_out = true;
+                    return true;
+                }
+                *ticks -= 1;
+            }
+            if let Some(deadline) = budget.deadline {
+                if std::time::Instant::now() >= deadline {
+                    self.timed_out = true;
+                }
+            }
+        }
+        self.timed_out
+    }
+
+    /// Makes `exit()` end the current script instead of the process.
+    pub fn set_trap_exit(&mut self, trap: bool) {
+        self.trap_exit = trap;
+    }
+
+    pub fn trap_exit(&self) -> bool {
+        self.trap_exit
+    }
+
+    pub fn set_exit_code(&mut self, code: i32) {
+        self.exit_code = Some(code);
+    }
+
+    pub fn exit_code(&self) -> Option<i32> {
+        self.exit_code
+    }
+
     pub fn run_once(&mut self, ctx: &mut qjs::Context) -> io::Result<usize> {
-        let n = self.run_tick_task(ctx);
+        if self.terminated() {
+            return Ok(0);
+        }
+        self.metrics.check_delay();
+        let n = self.run_tick_task(ctx) + self.run_channels(ctx);
         if n > 0 {
             Ok(n)
         } else {
-            self.io_selector.poll(ctx)
+            let deadline = self.budget.as_ref().and_then(|b| b.deadline);
+            let channels = self.channel_state();
+            if let (Some(wait), None) = (self.io_selector.timer_wait(), channels) {
+                let now = std::time::Instant::now();
+                let wait = [deadline, self.metrics.next_delay_check()]
+                    .iter()
+                    .flatten()
+                    .map(|t| t.saturating_duration_since(now))
+                    .fold(wait, std::time::Duration::min);
+                self.idle_gc.maybe_collect(ctx, wait);
+            }
+            // also wake up regularly to notice terminate() during long waits
+            let wake = match (channels, &self.terminate) {
+                (None, Some(_)) => Some(false),
+                (channels, _) => channels,
+            };
+            let r = self
+                .io_selector
+                .poll(ctx, deadline, wake, &mut self.metrics);
+            if let Err(e) = &r {
+                if e.kind() == io::ErrorKind::TimedOut {
+                    self.timed_out = true;
+                }
+            }
+            r
+        }
+    }
+
+    /// None without open channels, otherwise whether one is referenced.
+    fn channel_state(&self) -> Option<bool> {
+        self.channels
+            .iter()
+            .flatten()
+            .fold(None, |state, c| Some(state.unwrap_or(false) || c.refed))
+    }
+
+    /// Delivers everything received on the channels as
+    /// `callback("message" | "messageerror" | "error" | "exit", value)`.
+    fn run_channels(&mut self, ctx: &mut qjs::Context) -> usize {
+        let mut received = vec![];
+        for slot in self.channels.iter_mut() {
+            let mut closed = false;
+            if let Some(task) = slot {
+                loop {
+                    match task.rx.try_recv() {
+                        Ok(msg) => received.push((task.callback.clone(), msg)),
+                        Err(TryRecvError::Empty) => break,
+                        Err(TryRecvError::Disconnected) => {
+                            closed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if closed {
+                slot.take();
+            }
+        }
+        let n = received.len();
+        for (callback, msg) in received {
+            let (kind, value) = match msg {
+                ChannelMessage::Data(buf) => match ctx.deserialize(&buf) {
+                    Ok(value) => ("message", value),
+                    Err(e) => ("messageerror", e),
+                },
+                ChannelMessage::Error(e) => ("error", ctx.new_error(&e)),
+                ChannelMessage::Exit(code) => ("exit", JsValue::Int(code)),
+            };
+            callback.call(&[ctx.new_string(kind).into(), value]);
+        }
+        n
+    }
+
+    /// Calls `callback` for every message received on `rx`, see
+    /// `run_channels`. Open referenced channels keep the loop alive.
+    pub fn add_channel(
+        &mut self,
+        rx: Receiver<ChannelMessage>,
+        callback: qjs::JsFunction,
+    ) -> usize {
+        let task = ChannelTask {
+            rx,
+            callback,
+            refed: true,
+        };
+        match self.channels.iter().position(|c| c.is_none()) {
+            Some(id) => {
+                self.channels[id] = Some(task);
+                id
+            }
+            None => {
+                self.channels.push(Some(task));
+                self.channels.len() - 1
+            }
+        }
+    }
+
+    pub fn set_channel_ref(&mut self, id: usize, refed: bool) {
+        if let Some(Some(task)) = self.channels.get_mut(id) {
+            task.refed = refed;
+        }
+    }
+
+    pub fn close_channel(&mut self, id: usize) {
+        if let Some(slot) = self.channels.get_mut(id) {
+            slot.take();
         }
     }
 
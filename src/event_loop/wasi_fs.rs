@@ -838,6 +838,8 @@ mod wasi {
         /// Return `errno::isdir` if the path refers to a directory.
         /// Note: This is similar to `unlinkat(fd, path, 0)` in POSIX.
         pub fn path_unlink_file(arg0: i32, arg1: i32, arg2: i32) -> i32;
+        /// Write high-quality random data into a buffer.
+        pub fn random_get(arg0: i32, arg1: i32) -> i32;
     }
 }
 
@@ -1485,6 +1487,21 @@ pub unsafe fn path_unlink_file(fd: Fd, path: &str) -> Result<(), Errno> {
     }
 }
 
+/// Write high-quality random data into a buffer.
+/// This function blocks when the implementation is unable to immediately
+/// provide sufficient high-quality random data.
+///
+/// ## Parameters
+///
+/// * `buf` - The buffer to fill with random data.
+pub unsafe fn random_get(buf: &mut [u8]) -> Result<(), Errno> {
+    let ret = wasi::random_get(buf.as_mut_ptr() as i32, buf.len() as i32);
+    match ret {
+        0 => Ok(()),
+        _ => Err(Errno(ret as u16)),
+    }
+}
+
 /// Attempts to open a bare path `p`.
 ///
 /// WASI has no fundamental capability to do this. All syscalls and operations
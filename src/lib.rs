@@ -6,6 +6,6 @@ mod event_loop;
 mod modules_rs;
 pub mod quickjs_sys;
 
-pub use event_loop::EventLoop;
+pub use event_loop::{ChannelMessage, EventLoop};
 
 pub use quickjs_sys::*;
@@ -1,51 +1,379 @@
 #![allow(dead_code, unused_imports, unused_must_use)]
 
-use drop::{quickjs_sys::resolver, quickjs_sys::transpiler, Runtime, *};
+use drop::{
+    quickjs_sys::profiler::json_string, quickjs_sys::resolver, quickjs_sys::transpiler, Runtime, *,
+};
 
-fn args_parse() -> (String, Vec<String>) {
+struct Options {
+    file_path: String,
+    rest_args: Vec<String>,
+    allocator: String,
+    alloc_stats: bool,
+    max_heap: String,
+    gc_threshold: String,
+    max_stack: String,
+    expose_gc: bool,
+    idle_gc: bool,
+    serve: bool,
+    time_budget: String,
+    tick_budget: String,
+    cpu_prof: bool,
+    cpu_prof_name: String,
+    cpu_prof_interval: String,
+    trace_events: String,
+}
+
+/// Per script settings, applied again for every job in serve mode.
+struct ScriptOptions {
+    expose_gc: bool,
+    time_budget: Option<std::time::Duration>,
+    tick_budget: Option<u64>,
+}
+
+/// Parses a byte count with an optional k/m/g suffix, e.g. `512m`.
+fn parse_size(name: &str, s: &str) -> Option<usize> {
+    if s.is_empty() {
+        return None;
+    }
+    let lower = s.trim().to_ascii_lowercase();
+    let digits = lower.trim_end_matches('b');
+    let (digits, shift) = match digits.chars().last() {
+        Some('k') => (&digits[..digits.len() - 1], 10),
+        Some('m') => (&digits[..digits.len() - 1], 20),
+        Some('g') => (&digits[..digits.len() - 1], 30),
+        _ => (digits, 0),
+    };
+    let n = digits.parse::<usize>().ok();
+    // usize is 32 bits on wasm32, so 4g and up don't fit
+    match n.and_then(|n| n.checked_mul(1 << shift)) {
+        Some(n) => Some(n),
+        None => {
+            eprintln!("invalid size for {}: {}", name, s);
+            std::process::exit(2);
+        }
+    }
+}
+
+fn args_parse() -> Options {
     use argparse::ArgumentParser;
-    let mut file_path = String::new();
-    let mut rest_args: Vec<String> = vec![];
+    let mut opts = Options {
+        file_path: String::new(),
+        rest_args: vec![],
+        allocator: std::env::var("DROP_ALLOCATOR").unwrap_or_else(|_| "default".to_owned()),
+        alloc_stats: false,
+        max_heap: std::env::var("DROP_MAX_HEAP").unwrap_or_default(),
+        gc_threshold: std::env::var("DROP_GC_THRESHOLD").unwrap_or_default(),
+        max_stack: std::env::var("DROP_MAX_STACK").unwrap_or_default(),
+        expose_gc: false,
+        idle_gc: true,
+        serve: false,
+        time_budget: std::env::var("DROP_TIME_BUDGET").unwrap_or_default(),
+        tick_budget: std::env::var("DROP_TICK_BUDGET").unwrap_or_default(),
+        cpu_prof: false,
+        cpu_prof_name: "drop.cpuprofile".to_owned(),
+        cpu_prof_interval: String::new(),
+        trace_events: String::new(),
+    };
     {
         let mut arg_parser = ArgumentParser::new();
-        arg_parser
-            .refer(&mut file_path)
-            .add_argument(
-                "file",
-                argparse::Store,
-                "input script (*.[cm][ts|js][x] or *.zrc)",
-            )
-            .required();
-        arg_parser.refer(&mut rest_args).add_argument(
+        arg_parser.stop_on_first_argument(true);
+        arg_parser.refer(&mut opts.allocator).add_option(
+            &["--allocator"],
+            argparse::Store,
+            "QuickJS heap allocator: default, system or slab (env DROP_ALLOCATOR)",
+        );
+        arg_parser.refer(&mut opts.alloc_stats).add_option(
+            &["--alloc-stats"],
+            argparse::StoreTrue,
+            "print allocator counters to stderr on exit",
+        );
+        arg_parser.refer(&mut opts.max_heap).add_option(
+            &["--max-heap"],
+            argparse::Store,
+            "QuickJS heap limit in bytes, k/m/g suffixes allowed (env DROP_MAX_HEAP)",
+        );
+        arg_parser.refer(&mut opts.gc_threshold).add_option(
+            &["--gc-threshold"],
+            argparse::Store,
+            "heap growth between automatic GC runs (env DROP_GC_THRESHOLD)",
+        );
+        arg_parser.refer(&mut opts.max_stack).add_option(
+            &["--max-stack"],
+            argparse::Store,
+            "stack budget for JS recursion, 0 disables it (env DROP_MAX_STACK)",
+        );
+        arg_parser.refer(&mut opts.expose_gc).add_option(
+            &["--expose-gc"],
+            argparse::StoreTrue,
+            "define a global gc() function",
+        );
+        arg_parser.refer(&mut opts.idle_gc).add_option(
+            &["--no-idle-gc"],
+            argparse::StoreFalse,
+            "don't collect garbage while the event loop waits on timers",
+        );
+        arg_parser.refer(&mut opts.time_budget).add_option(
+            &["--time-budget"],
+            argparse::Store,
+            "abort a script after this many milliseconds (env DROP_TIME_BUDGET)",
+        );
+        arg_parser.refer(&mut opts.tick_budget).add_option(
+            &["--tick-budget"],
+            argparse::Store,
+            "abort a script after this many interrupt checks, ~10k branches each (env DROP_TICK_BUDGET)",
+        );
+        arg_parser.refer(&mut opts.cpu_prof).add_option(
+            &["--cpu-prof"],
+            argparse::StoreTrue,
+            "sample the JS stack and write a .cpuprofile plus collapsed stacks on exit",
+        );
+        arg_parser.refer(&mut opts.cpu_prof_name).add_option(
+            &["--cpu-prof-name"],
+            argparse::Store,
+            "output file of --cpu-prof, collapsed stacks go to <name>.folded",
+        );
+        arg_parser.refer(&mut opts.cpu_prof_interval).add_option(
+            &["--cpu-prof-interval"],
+            argparse::Store,
+            "sampling interval of --cpu-prof in microseconds (default 1000)",
+        );
+        arg_parser.refer(&mut opts.trace_events).add_option(
+            &["--trace-events"],
+            argparse::Store,
+            "write a Chrome trace-event timeline of runtime phases to this file",
+        );
+        arg_parser.refer(&mut opts.serve).add_option(
+            &["--serve"],
+            argparse::StoreTrue,
+            "run one job per stdin line (`file args...`) in a reused runtime",
+        );
+        arg_parser.refer(&mut opts.file_path).add_argument(
+            "file",
+            argparse::Store,
+            "input script (*.[cm][ts|js][x] or *.zrc)",
+        );
+        arg_parser.refer(&mut opts.rest_args).add_argument(
             "args",
             argparse::List,
             "additional arguments for runtime",
         );
         arg_parser.parse_args_or_exit();
     }
-    (file_path, rest_args)
+    if opts.file_path.is_empty() && !opts.serve {
+        eprintln!("drop: missing input script");
+        std::process::exit(2);
+    }
+    opts
+}
+
+fn parse_allocator(allocator: &str) -> AllocatorKind {
+    match allocator {
+        "default" => AllocatorKind::Default,
+        "system" => AllocatorKind::System,
+        "slab" => AllocatorKind::Slab,
+        _ => {
+            eprintln!("unknown allocator: {}", allocator);
+            std::process::exit(2);
+        }
+    }
+}
+
+fn print_alloc_stats(rt: &Runtime) {
+    match rt.allocator_stats() {
+        Some((name, stats)) => eprintln!(
+            "[alloc] {}: allocs={} frees={} reallocs={} live={} peak={} reserved={} wasm_pages={}",
+            name,
+            stats.alloc_count,
+            stats.free_count,
+            stats.realloc_count,
+            stats.live_bytes,
+            stats.peak_bytes,
+            stats.reserved_bytes,
+            core::arch::wasm32::memory_size::<0>()
+        ),
+        None => eprintln!(
+            "[alloc] default: no counters, wasm_pages={}",
+            core::arch::wasm32::memory_size::<0>()
+        ),
+    }
+}
+
+fn parse_number(name: &str, s: &str) -> Option<u64> {
+    if s.is_empty() {
+        return None;
+    }
+    match s.trim().parse::<u64>() {
+        Ok(n) => Some(n),
+        Err(_) => {
+            eprintln!("invalid number for {}: {}", name, s);
+            std::process::exit(2);
+        }
+    }
+}
+
+fn run_script(
+    ctx: &mut Context,
+    file_path: &str,
+    args: Vec<String>,
+    opts: &ScriptOptions,
+) -> Result<(), String> {
+    let _span = trace::span_with("run_script", "script", || file_path.to_owned());
+    if opts.expose_gc {
+        ctx.expose_gc();
+    }
+    if let Some(event_loop) = ctx.event_loop() {
+        event_loop.set_budget(opts.time_budget, opts.tick_budget);
+    }
+    ctx.run_entry_module(file_path, args)
+}
+
+/// Batch mode: every stdin line is `file args...` and runs in its own
+/// context on the same runtime, so the embedded modules are decompressed
+/// and compiled once. A JSON status line per job goes to stderr.
+fn serve(rt: &mut Runtime, opts: &ScriptOptions) {
+    use std::io::{BufRead, Write};
+    if let Some(event_loop) = rt.event_loop() {
+        event_loop.set_trap_exit(true);
+    }
+    let stdin = std::io::stdin();
+    for line in stdin.lock().lines() {
+        let line = match line {
+            Ok(line) => line,
+            Err(_) => break,
+        };
+        let mut parts = line.split_whitespace().map(|s| s.to_owned());
+        let file_path = match parts.next() {
+            Some(file_path) => file_path,
+            None => continue,
+        };
+        let args: Vec<String> = parts.collect();
+        let start = std::time::Instant::now();
+        let (result, exit_code, timed_out) = rt.run_with_context(|ctx| {
+            let result = run_script(ctx, &file_path, args.clone(), opts);
+            (result, ctx.exit_code(), ctx.timed_out())
+        });
+        rt.run_gc();
+        unsafe { libc::fflush(std::ptr::null_mut()) };
+        std::io::stdout().flush();
+        let status = match (&result, exit_code) {
+            (Err(_), _) if timed_out => "\"status\":\"timeout\"".to_owned(),
+            (Err(e), _) => format!("\"status\":\"error\",\"error\":{}", json_string(e)),
+            (Ok(_), Some(code)) => format!("\"status\":\"exit\",\"code\":{}", code),
+            (Ok(_), None) => "\"status\":\"ok\"".to_owned(),
+        };
+        eprintln!(
+            "{{\"file\":{},{},\"ms\":{}}}",
+            json_string(&file_path),
+            status,
+            start.elapsed().as_millis()
+        );
+    }
+}
+
+fn write_cpu_profile(rt: &mut Runtime, name: &str) {
+    let profiler = match rt.event_loop().and_then(|event_loop| event_loop.profiler()) {
+        Some(profiler) => profiler,
+        None => return,
+    };
+    let write = |path: &str, f: &dyn Fn(&mut std::io::BufWriter<std::fs::File>) -> std::io::Result<()>| {
+        let r = std::fs::File::create(path).and_then(|file| {
+            let mut w = std::io::BufWriter::new(file);
+            f(&mut w)
+        });
+        if let Err(e) = r {
+            eprintln!("failed to write {}: {}", path, e);
+        }
+    };
+    write(name, &|w| profiler.write_cpuprofile(w));
+    write(&format!("{}.folded", name), &|w| profiler.write_collapsed(w));
 }
 
 fn main() {
-    let mut rt = Runtime::new();
-    rt.run_with_context(|ctx| {
-        let (file_path, mut rest_arg) = args_parse();
-        let entrypoint =
-            resolver::import(&file_path).expect(format!("file not found: {}", &file_path).as_str());
-        let code = String::from_utf8(entrypoint)
-            .expect(format!("invalid format: {}", &file_path).as_str());
-        rest_arg.insert(0, file_path.clone());
-        ctx.put_args(rest_arg);
-        ctx.js_loop().unwrap();
-        let make_require_global = r#"
-        ;(async () => {
-            const { require } = await import("commonjs");
-            globalThis.require = require;
-        })();
-        "#;
-        ctx.eval_global_str(make_require_global.to_owned());
-        ctx.promise_loop_poll();
-        ctx.eval_module_str(code, &file_path);
-        ctx.js_loop().unwrap();
+    let Options {
+        file_path,
+        rest_args,
+        allocator,
+        alloc_stats,
+        max_heap,
+        gc_threshold,
+        max_stack,
+        expose_gc,
+        idle_gc,
+        serve: serve_mode,
+        time_budget,
+        tick_budget,
+        cpu_prof,
+        cpu_prof_name,
+        cpu_prof_interval,
+        trace_events,
+    } = args_parse();
+    if !trace_events.is_empty() {
+        trace::enable();
+    }
+    let main_span = trace::span("main", "startup");
+    let startup_span = trace::span("runtime init", "startup");
+    let script_opts = ScriptOptions {
+        expose_gc,
+        time_budget: parse_number("--time-budget", &time_budget)
+            .map(std::time::Duration::from_millis),
+        tick_budget: parse_number("--tick-budget", &tick_budget),
+    };
+    let mut rt = Runtime::new_with_options(&RuntimeOptions {
+        allocator: parse_allocator(&allocator),
+        memory_limit: parse_size("--max-heap", &max_heap),
+        gc_threshold: parse_size("--gc-threshold", &gc_threshold),
+        max_stack_size: parse_size("--max-stack", &max_stack),
+        idle_gc,
     });
+    if cpu_prof {
+        let interval = parse_number("--cpu-prof-interval", &cpu_prof_interval).unwrap_or(1000);
+        if let Some(event_loop) = rt.event_loop() {
+            event_loop.set_profiler(Some(Profiler::new(std::time::Duration::from_micros(
+                interval,
+            ))));
+            // let exit() unwind so the profile still gets written
+            event_loop.set_trap_exit(true);
+        }
+    }
+    if !trace_events.is_empty() {
+        if let Some(event_loop) = rt.event_loop() {
+            event_loop.set_trap_exit(true);
+        }
+    }
+    drop(startup_span);
+    let mut status = 0;
+    if serve_mode {
+        serve(&mut rt, &script_opts);
+    } else {
+        let (result, timed_out, exit_code) = rt.run_with_context(|ctx| {
+            let result = run_script(ctx, &file_path, rest_args.clone(), &script_opts);
+            (result, ctx.timed_out(), ctx.exit_code())
+        });
+        if let Err(e) = result {
+            eprintln!("{}", e);
+            // same status as timeout(1)
+            status = if timed_out { 124 } else { 1 };
+        } else if let Some(code) = exit_code {
+            status = code;
+        }
+    }
+    drop(main_span);
+    if cpu_prof {
+        write_cpu_profile(&mut rt, &cpu_prof_name);
+    }
+    if !trace_events.is_empty() {
+        let r = std::fs::File::create(&trace_events).and_then(|file| {
+            let mut w = std::io::BufWriter::new(file);
+            trace::write(&mut w)
+        });
+        if let Err(e) = r {
+            eprintln!("failed to write {}: {}", trace_events, e);
+        }
+    }
+    if alloc_stats {
+        print_alloc_stats(&rt);
+    }
+    if status != 0 {
+        std::process::exit(status);
+    }
 }
@@ -1,135 +1,25 @@
-var exports$3 = {},
-	_dewExec$2 = false;
-function dew$2() {
-	if (_dewExec$2) {
-		return exports$3;
-	}
-	_dewExec$2 = true;
-	exports$3.byteLength = byteLength;
-	exports$3.toByteArray = toByteArray;
-	exports$3.fromByteArray = fromByteArray;
-	var lookup = [];
-	var revLookup = [];
-	var Arr = typeof Uint8Array !== "undefined" ? Uint8Array : Array;
-	var code = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-	for (var i = 0, len = code.length; i < len; ++i) {
-		lookup[i] = code[i];
-		revLookup[code.charCodeAt(i)] = i;
-	} // Support decoding URL-safe base64 strings, as Node.js does.
-	// See: https://en.wikipedia.org/wiki/Base64#URL_applications
-
-	revLookup["-".charCodeAt(0)] = 62;
-	revLookup["_".charCodeAt(0)] = 63;
-
-	function getLens(b64) {
-		var len = b64.length;
-
-		if (len % 4 > 0) {
-			throw new Error("Invalid string. Length must be a multiple of 4");
-		} // Trim off extra bytes after placeholder bytes are found
-		// See: https://github.com/beatgammit/base64-js/issues/42
-
-		var validLen = b64.indexOf("=");
-		if (validLen === -1) {
-			validLen = len;
-		}
-		var placeHoldersLen = validLen === len ? 0 : 4 - (validLen % 4);
-		return [validLen, placeHoldersLen];
-	} // base64 is 4/3 + up to two characters of the original data
-
-	function byteLength(b64) {
-		var lens = getLens(b64);
-		var validLen = lens[0];
-		var placeHoldersLen = lens[1];
-		return ((validLen + placeHoldersLen) * 3) / 4 - placeHoldersLen;
-	}
-
-	function _byteLength(b64, validLen, placeHoldersLen) {
-		return ((validLen + placeHoldersLen) * 3) / 4 - placeHoldersLen;
-	}
-
-	function toByteArray(b64) {
-		var tmp;
-		var lens = getLens(b64);
-		var validLen = lens[0];
-		var placeHoldersLen = lens[1];
-		var arr = new Arr(_byteLength(b64, validLen, placeHoldersLen));
-		var curByte = 0; // if there are placeholders, only get up to the last complete 4 chars
-
-		var len = placeHoldersLen > 0 ? validLen - 4 : validLen;
-		var i;
-
-		for (i = 0; i < len; i += 4) {
-			tmp =
-				(revLookup[b64.charCodeAt(i)] << 18) |
-				(revLookup[b64.charCodeAt(i + 1)] << 12) |
-				(revLookup[b64.charCodeAt(i + 2)] << 6) |
-				revLookup[b64.charCodeAt(i + 3)];
-			arr[curByte++] = (tmp >> 16) & 255;
-			arr[curByte++] = (tmp >> 8) & 255;
-			arr[curByte++] = tmp & 255;
-		}
-
-		if (placeHoldersLen === 2) {
-			tmp = (revLookup[b64.charCodeAt(i)] << 2) | (revLookup[b64.charCodeAt(i + 1)] >> 4);
-			arr[curByte++] = tmp & 255;
-		}
-
-		if (placeHoldersLen === 1) {
-			tmp =
-				(revLookup[b64.charCodeAt(i)] << 10) |
-				(revLookup[b64.charCodeAt(i + 1)] << 4) |
-				(revLookup[b64.charCodeAt(i + 2)] >> 2);
-			arr[curByte++] = (tmp >> 8) & 255;
-			arr[curByte++] = tmp & 255;
-		}
-
-		return arr;
-	}
-
-	function tripletToBase64(num) {
-		return lookup[(num >> 18) & 63] + lookup[(num >> 12) & 63] + lookup[(num >> 6) & 63] + lookup[num & 63];
-	}
-
-	function encodeChunk(uint8, start, end) {
-		var tmp;
-		var output = [];
-
-		for (var i = start; i < end; i += 3) {
-			tmp = ((uint8[i] << 16) & 16711680) + ((uint8[i + 1] << 8) & 65280) + (uint8[i + 2] & 255);
-			output.push(tripletToBase64(tmp));
-		}
-
-		return output.join("");
-	}
-
-	function fromByteArray(uint8) {
-		var tmp;
-		var len = uint8.length;
-		var extraBytes = len % 3; // if we have 1 byte left, pad 2 bytes
-
-		var parts = [];
-		var maxChunkLength = 16383; // must be multiple of 3
-		// go through the array every three bytes, we'll deal with trailing stuff later
-
-		for (var i = 0, len2 = len - extraBytes; i < len2; i += maxChunkLength) {
-			parts.push(encodeChunk(uint8, i, i + maxChunkLength > len2 ? len2 : i + maxChunkLength));
-		} // pad the end with zeros, but make sure to not forget the extra bytes
-
-		if (extraBytes === 1) {
-			tmp = uint8[len - 1];
-			parts.push(lookup[tmp >> 2] + lookup[(tmp << 4) & 63] + "==");
-		} else if (extraBytes === 2) {
-			tmp = (uint8[len - 2] << 8) + uint8[len - 1];
-			parts.push(lookup[tmp >> 10] + lookup[(tmp >> 4) & 63] + lookup[(tmp << 2) & 63] + "=");
-		}
-
-		return parts.join("");
-	}
-
-	return exports$3;
-}
+import {
+	base64Slice as _base64Slice,
+	base64urlSlice as _base64urlSlice,
+	hexSlice as _hexSlice,
+	latin1Slice as _latin1Slice,
+	asciiSlice as _asciiSlice,
+	ucs2Slice as _ucs2Slice,
+	utf8Slice as _utf8Slice,
+	base64Write as _base64Write,
+	hexWrite as _hexWrite,
+	latin1Write as _latin1Write,
+	ucs2Write as _ucs2Write,
+	utf8Write as _utf8Write,
+	byteLengthUtf8,
+	byteLengthBase64,
+	indexOfNumber as _indexOfNumber,
+	indexOfBuffer as _indexOfBuffer,
+	indexOfString as _indexOfString,
+	compare as _compare,
+	copy as _copy,
+	fill as _fill,
+} from "_node:buffer";
 
 var exports$2 = {},
 	_dewExec$1 = false;
@@ -240,8 +130,6 @@ function dew() {
 	}
 	_dewExec = true;
 
-	var base64 = dew$2();
-
 	var ieee754 = dew$1();
 
 	var customInspectSymbol =
@@ -345,7 +233,42 @@ function dew() {
 		return from(arg, encodingOrOffset, length);
 	}
 
-	Buffer.poolSize = 8192; // not used by this implementation
+	Buffer.poolSize = 8192;
+
+	// Like node, allocations under half the pool size are carved out of a
+	// shared slab instead of getting an ArrayBuffer each. Their `.buffer` is
+	// the slab, so `byteOffset` has to be honoured.
+	var poolSize = 0;
+	var poolOffset = 0;
+	var allocPool = null;
+
+	function createPool() {
+		poolSize = Buffer.poolSize;
+		allocPool = new ArrayBuffer(poolSize);
+		poolOffset = 0;
+	}
+
+	function alignPool() {
+		// Keep slices 8-byte aligned so they can back any typed array
+		if (poolOffset & 0x7) {
+			poolOffset |= 0x7;
+			poolOffset++;
+		}
+	}
+
+	function allocate(size) {
+		if (size <= 0 || size >= Buffer.poolSize >>> 1) {
+			return createBuffer(size);
+		}
+		if (size > poolSize - poolOffset) {
+			createPool();
+		}
+		var buf = new Uint8Array(allocPool, poolOffset, size);
+		Object.setPrototypeOf(buf, Buffer.prototype);
+		poolOffset += size;
+		alignPool();
+		return buf;
+	}
 
 	function from(value, encodingOrOffset, length) {
 		if (typeof value === "string") {
@@ -456,7 +379,7 @@ function dew() {
 
 	function allocUnsafe(size) {
 		assertSize(size);
-		return createBuffer(size < 0 ? 0 : checked(size) | 0);
+		return allocate(size < 0 ? 0 : checked(size) | 0);
 	}
 	/**
 	 * Equivalent to Buffer(num), by default creates a non-zero-filled Buffer instance.
@@ -470,7 +393,8 @@ function dew() {
 	 */
 
 	Buffer.allocUnsafeSlow = function (size) {
-		return allocUnsafe(size);
+		assertSize(size);
+		return createBuffer(size < 0 ? 0 : checked(size) | 0);
 	};
 
 	function fromString(string, encoding) {
@@ -483,7 +407,7 @@ function dew() {
 		}
 
 		var length = byteLength(string, encoding) | 0;
-		var buf = createBuffer(length);
+		var buf = allocate(length);
 		var actual = buf.write(string, encoding);
 
 		if (actual !== length) {
@@ -498,7 +422,7 @@ function dew() {
 
 	function fromArrayLike(array) {
 		var length = array.length < 0 ? 0 : checked(array.length) | 0;
-		var buf = createBuffer(length);
+		var buf = allocate(length);
 
 		for (var i = 0; i < length; i += 1) {
 			buf[i] = array[i] & 255;
@@ -509,8 +433,9 @@ function dew() {
 
 	function fromArrayView(arrayView) {
 		if (isInstance(arrayView, Uint8Array)) {
-			var copy = new Uint8Array(arrayView);
-			return fromArrayBuffer(copy.buffer, copy.byteOffset, copy.byteLength);
+			var buf = allocate(arrayView.byteLength);
+			Uint8Array.prototype.set.call(buf, arrayView);
+			return buf;
 		}
 
 		return fromArrayLike(arrayView);
@@ -542,7 +467,7 @@ function dew() {
 	function fromObject(obj) {
 		if (Buffer.isBuffer(obj)) {
 			var len = checked(obj.length) | 0;
-			var buf = createBuffer(len);
+			var buf = allocate(len);
 
 			if (buf.length === 0) {
 				return buf;
@@ -591,38 +516,14 @@ function dew() {
 	};
 
 	Buffer.compare = function compare(a, b) {
-		if (isInstance(a, Uint8Array)) {
-			a = Buffer.from(a, a.offset, a.byteLength);
-		}
-		if (isInstance(b, Uint8Array)) {
-			b = Buffer.from(b, b.offset, b.byteLength);
-		}
-
-		if (!Buffer.isBuffer(a) || !Buffer.isBuffer(b)) {
+		if (!isInstance(a, Uint8Array) || !isInstance(b, Uint8Array)) {
 			throw new TypeError('The "buf1", "buf2" arguments must be one of type Buffer or Uint8Array');
 		}
 
 		if (a === b) {
 			return 0;
 		}
-		var x = a.length;
-		var y = b.length;
-
-		for (var i = 0, len = Math.min(x, y); i < len; ++i) {
-			if (a[i] !== b[i]) {
-				x = a[i];
-				y = b[i];
-				break;
-			}
-		}
-
-		if (x < y) {
-			return -1;
-		}
-		if (y < x) {
-			return 1;
-		}
-		return 0;
+		return _compare(a.buffer, a.byteOffset, a.byteLength, b.buffer, b.byteOffset, b.byteLength);
 	};
 
 	Buffer.isEncoding = function isEncoding(encoding) {
@@ -634,6 +535,7 @@ function dew() {
 			case "latin1":
 			case "binary":
 			case "base64":
+			case "base64url":
 			case "ucs2":
 			case "ucs-2":
 			case "utf16le":
@@ -723,7 +625,7 @@ function dew() {
 
 				case "utf8":
 				case "utf-8":
-					return utf8ToBytes(string).length;
+					return byteLengthUtf8(string);
 
 				case "ucs2":
 				case "ucs-2":
@@ -735,11 +637,12 @@ function dew() {
 					return len >>> 1;
 
 				case "base64":
-					return base64ToBytes(string).length;
+				case "base64url":
+					return byteLengthBase64(string);
 
 				default:
 					if (loweredCase) {
-						return mustMatch ? -1 : utf8ToBytes(string).length; // assume utf8
+						return mustMatch ? -1 : byteLengthUtf8(string); // assume utf8
 					}
 
 					encoding = ("" + encoding).toLowerCase();
@@ -805,6 +708,9 @@ function dew() {
 				case "base64":
 					return base64Slice(this, start, end);
 
+				case "base64url":
+					return base64urlSlice(this, start, end);
+
 				case "ucs2":
 				case "ucs-2":
 				case "utf16le":
@@ -900,6 +806,9 @@ function dew() {
 		if (this === b) {
 			return true;
 		}
+		if (this.length !== b.length) {
+			return false;
+		}
 		return Buffer.compare(this, b) === 0;
 	};
 
@@ -918,11 +827,7 @@ function dew() {
 	}
 
 	Buffer.prototype.compare = function compare(target, start, end, thisStart, thisEnd) {
-		if (isInstance(target, Uint8Array)) {
-			target = Buffer.from(target, target.offset, target.byteLength);
-		}
-
-		if (!Buffer.isBuffer(target)) {
+		if (!isInstance(target, Uint8Array)) {
 			throw new TypeError(
 				'The "target" argument must be one of type Buffer or Uint8Array. ' + "Received type " + typeof target,
 			);
@@ -964,30 +869,17 @@ function dew() {
 		end >>>= 0;
 		thisStart >>>= 0;
 		thisEnd >>>= 0;
-		if (this === target) {
+		if (this === target && start === thisStart && end === thisEnd) {
 			return 0;
 		}
-		var x = thisEnd - thisStart;
-		var y = end - start;
-		var len = Math.min(x, y);
-		var thisCopy = this.slice(thisStart, thisEnd);
-		var targetCopy = target.slice(start, end);
-
-		for (var i = 0; i < len; ++i) {
-			if (thisCopy[i] !== targetCopy[i]) {
-				x = thisCopy[i];
-				y = targetCopy[i];
-				break;
-			}
-		}
-
-		if (x < y) {
-			return -1;
-		}
-		if (y < x) {
-			return 1;
-		}
-		return 0;
+		return _compare(
+			this.buffer,
+			this.byteOffset + thisStart,
+			thisEnd - thisStart,
+			target.buffer,
+			target.byteOffset + start,
+			end - start,
+		);
 	}; // Finds either the first index of `val` in `buffer` at offset >= `byteOffset`,
 	// OR the last index of `val` in `buffer` at offset <= `byteOffset`.
 	//
@@ -1038,106 +930,48 @@ function dew() {
 			}
 		} // Normalize val
 
+		var ucs2 = false;
+		if (encoding !== undefined) {
+			encoding = String(encoding).toLowerCase();
+			ucs2 = encoding === "ucs2" || encoding === "ucs-2" || encoding === "utf16le" || encoding === "utf-16le";
+		} // Normalize val
+
 		if (typeof val === "string") {
+			if (encoding === undefined || encoding === "utf8" || encoding === "utf-8") {
+				// Special case: looking for empty string always fails
+				if (val.length === 0) {
+					return -1;
+				}
+				return _indexOfString(buffer.buffer, buffer.byteOffset, buffer.length, val, byteOffset, dir);
+			}
 			val = Buffer.from(val, encoding);
 		} // Finally, search either indexOf (if dir is true) or lastIndexOf
 
-		if (Buffer.isBuffer(val)) {
-			// Special case: looking for empty string/buffer always fails
+		if (isInstance(val, Uint8Array)) {
+			// Special case: looking for empty buffer always fails
 			if (val.length === 0) {
 				return -1;
 			}
 
-			return arrayIndexOf(buffer, val, byteOffset, encoding, dir);
+			return _indexOfBuffer(
+				buffer.buffer,
+				buffer.byteOffset,
+				buffer.length,
+				val.buffer,
+				val.byteOffset,
+				val.byteLength,
+				byteOffset,
+				dir,
+				ucs2,
+			);
 		} else if (typeof val === "number") {
-			val = val & 255; // Search for a byte value [0-255]
-
-			if (typeof Uint8Array.prototype.indexOf === "function") {
-				if (dir) {
-					return Uint8Array.prototype.indexOf.call(buffer, val, byteOffset);
-				} else {
-					return Uint8Array.prototype.lastIndexOf.call(buffer, val, byteOffset);
-				}
-			}
-
-			return arrayIndexOf(buffer, [val], byteOffset, encoding, dir);
+			// Search for a byte value [0-255]
+			return _indexOfNumber(buffer.buffer, buffer.byteOffset, buffer.length, val & 255, byteOffset, dir);
 		}
 
 		throw new TypeError("val must be string, number or Buffer");
 	}
 
-	function arrayIndexOf(arr, val, byteOffset, encoding, dir) {
-		var indexSize = 1;
-		var arrLength = arr.length;
-		var valLength = val.length;
-
-		if (encoding !== undefined) {
-			encoding = String(encoding).toLowerCase();
-
-			if (encoding === "ucs2" || encoding === "ucs-2" || encoding === "utf16le" || encoding === "utf-16le") {
-				if (arr.length < 2 || val.length < 2) {
-					return -1;
-				}
-
-				indexSize = 2;
-				arrLength /= 2;
-				valLength /= 2;
-				byteOffset /= 2;
-			}
-		}
-
-		function read(buf, i) {
-			if (indexSize === 1) {
-				return buf[i];
-			} else {
-				return buf.readUInt16BE(i * indexSize);
-			}
-		}
-
-		var i;
-
-		if (dir) {
-			var foundIndex = -1;
-
-			for (i = byteOffset; i < arrLength; i++) {
-				if (read(arr, i) === read(val, foundIndex === -1 ? 0 : i - foundIndex)) {
-					if (foundIndex === -1) {
-						foundIndex = i;
-					}
-					if (i - foundIndex + 1 === valLength) {
-						return foundIndex * indexSize;
-					}
-				} else {
-					if (foundIndex !== -1) {
-						i -= i - foundIndex;
-					}
-					foundIndex = -1;
-				}
-			}
-		} else {
-			if (byteOffset + valLength > arrLength) {
-				byteOffset = arrLength - valLength;
-			}
-
-			for (i = byteOffset; i >= 0; i--) {
-				var found = true;
-
-				for (var j = 0; j < valLength; j++) {
-					if (read(arr, i + j) !== read(val, j)) {
-						found = false;
-						break;
-					}
-				}
-
-				if (found) {
-					return i;
-				}
-			}
-		}
-
-		return -1;
-	}
-
 	Buffer.prototype.includes = function includes(val, byteOffset, encoding) {
 		return this.indexOf(val, byteOffset, encoding) !== -1;
 	};
@@ -1150,53 +984,26 @@ function dew() {
 		return bidirectionalIndexOf(this, val, byteOffset, encoding, false);
 	};
 
+	// The native writers take the backing ArrayBuffer, the absolute offset
+	// and the room left, and return the bytes written.
 	function hexWrite(buf, string, offset, length) {
-		offset = Number(offset) || 0;
-		var remaining = buf.length - offset;
-
-		if (!length) {
-			length = remaining;
-		} else {
-			length = Number(length);
-
-			if (length > remaining) {
-				length = remaining;
-			}
-		}
-
-		var strLen = string.length;
-
-		if (length > strLen / 2) {
-			length = strLen / 2;
-		}
-
-		var i;
-
-		for (i = 0; i < length; ++i) {
-			var parsed = parseInt(string.substr(i * 2, 2), 16);
-			if (numberIsNaN(parsed)) {
-				return i;
-			}
-			buf[offset + i] = parsed;
-		}
-
-		return i;
+		return _hexWrite(buf.buffer, buf.byteOffset + offset, length, string);
 	}
 
 	function utf8Write(buf, string, offset, length) {
-		return blitBuffer(utf8ToBytes(string, buf.length - offset), buf, offset, length);
+		return _utf8Write(buf.buffer, buf.byteOffset + offset, length, string);
 	}
 
 	function asciiWrite(buf, string, offset, length) {
-		return blitBuffer(asciiToBytes(string), buf, offset, length);
+		return _latin1Write(buf.buffer, buf.byteOffset + offset, length, string);
 	}
 
 	function base64Write(buf, string, offset, length) {
-		return blitBuffer(base64ToBytes(string), buf, offset, length);
+		return _base64Write(buf.buffer, buf.byteOffset + offset, length, string);
 	}
 
 	function ucs2Write(buf, string, offset, length) {
-		return blitBuffer(utf16leToBytes(string, buf.length - offset), buf, offset, length);
+		return _ucs2Write(buf.buffer, buf.byteOffset + offset, length, string);
 	}
 
 	Buffer.prototype.write = function write(string, offset, length, encoding) {
@@ -1254,7 +1061,7 @@ function dew() {
 					return asciiWrite(this, string, offset, length);
 
 				case "base64":
-					// Warning: maxLength not taken into account in base64Write
+				case "base64url":
 					return base64Write(this, string, offset, length);
 
 				case "ucs2":
@@ -1280,169 +1087,33 @@ function dew() {
 		};
 	};
 
+	// start and end are already clamped to the buffer by the callers.
 	function base64Slice(buf, start, end) {
-		if (start === 0 && end === buf.length) {
-			return base64.fromByteArray(buf);
-		} else {
-			return base64.fromByteArray(buf.slice(start, end));
-		}
+		return _base64Slice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
-	function utf8Slice(buf, start, end) {
-		end = Math.min(buf.length, end);
-		var res = [];
-		var i = start;
-
-		while (i < end) {
-			var firstByte = buf[i];
-			var codePoint = null;
-			var bytesPerSequence = firstByte > 239 ? 4 : firstByte > 223 ? 3 : firstByte > 191 ? 2 : 1;
-
-			if (i + bytesPerSequence <= end) {
-				var secondByte = void 0,
-					thirdByte = void 0,
-					fourthByte = void 0,
-					tempCodePoint = void 0;
-
-				switch (bytesPerSequence) {
-					case 1:
-						if (firstByte < 128) {
-							codePoint = firstByte;
-						}
-
-						break;
-
-					case 2:
-						secondByte = buf[i + 1];
-
-						if ((secondByte & 192) === 128) {
-							tempCodePoint = ((firstByte & 31) << 6) | (secondByte & 63);
-
-							if (tempCodePoint > 127) {
-								codePoint = tempCodePoint;
-							}
-						}
-
-						break;
-
-					case 3:
-						secondByte = buf[i + 1];
-						thirdByte = buf[i + 2];
-
-						if ((secondByte & 192) === 128 && (thirdByte & 192) === 128) {
-							tempCodePoint = ((firstByte & 15) << 12) | ((secondByte & 63) << 6) | (thirdByte & 63);
-
-							if (tempCodePoint > 2047 && (tempCodePoint < 55296 || tempCodePoint > 57343)) {
-								codePoint = tempCodePoint;
-							}
-						}
-
-						break;
-
-					case 4:
-						secondByte = buf[i + 1];
-						thirdByte = buf[i + 2];
-						fourthByte = buf[i + 3];
-
-						if ((secondByte & 192) === 128 && (thirdByte & 192) === 128 && (fourthByte & 192) === 128) {
-							tempCodePoint =
-								((firstByte & 15) << 18) | ((secondByte & 63) << 12) | ((thirdByte & 63) << 6) | (fourthByte & 63);
-
-							if (tempCodePoint > 65535 && tempCodePoint < 1114112) {
-								codePoint = tempCodePoint;
-							}
-						}
-				}
-			}
-
-			if (codePoint === null) {
-				// we did not generate a valid codePoint so insert a
-				// replacement char (U+FFFD) and advance only 1 byte
-				codePoint = 65533;
-				bytesPerSequence = 1;
-			} else if (codePoint > 65535) {
-				// encode to utf16 (surrogate pair dance)
-				codePoint -= 65536;
-				res.push(((codePoint >>> 10) & 1023) | 55296);
-				codePoint = 56320 | (codePoint & 1023);
-			}
-
-			res.push(codePoint);
-			i += bytesPerSequence;
-		}
-
-		return decodeCodePointsArray(res);
-	} // Based on http://stackoverflow.com/a/22747272/680742, the browser with
-	// the lowest limit is Chrome, with 0x10000 args.
-	// We go 1 magnitude less, for safety
-
-	var MAX_ARGUMENTS_LENGTH = 4096;
-
-	function decodeCodePointsArray(codePoints) {
-		var len = codePoints.length;
-
-		if (len <= MAX_ARGUMENTS_LENGTH) {
-			return String.fromCharCode.apply(String, codePoints); // avoid extra slice()
-		} // Decode in chunks to avoid "call stack size exceeded".
-
-		var res = "";
-		var i = 0;
-
-		while (i < len) {
-			res += String.fromCharCode.apply(String, codePoints.slice(i, (i += MAX_ARGUMENTS_LENGTH)));
-		}
+	function base64urlSlice(buf, start, end) {
+		return _base64urlSlice(buf.buffer, buf.byteOffset + start, end - start);
+	}
 
-		return res;
+	function utf8Slice(buf, start, end) {
+		return _utf8Slice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
 	function asciiSlice(buf, start, end) {
-		var ret = "";
-		end = Math.min(buf.length, end);
-
-		for (var i = start; i < end; ++i) {
-			ret += String.fromCharCode(buf[i] & 127);
-		}
-
-		return ret;
+		return _asciiSlice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
 	function latin1Slice(buf, start, end) {
-		var ret = "";
-		end = Math.min(buf.length, end);
-
-		for (var i = start; i < end; ++i) {
-			ret += String.fromCharCode(buf[i]);
-		}
-
-		return ret;
+		return _latin1Slice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
 	function hexSlice(buf, start, end) {
-		var len = buf.length;
-		if (!start || start < 0) {
-			start = 0;
-		}
-		if (!end || end < 0 || end > len) {
-			end = len;
-		}
-		var out = "";
-
-		for (var i = start; i < end; ++i) {
-			out += hexSliceLookupTable[buf[i]];
-		}
-
-		return out;
+		return _hexSlice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
 	function utf16leSlice(buf, start, end) {
-		var bytes = buf.slice(start, end);
-		var res = ""; // If bytes.length is odd, the last 8 bits must be ignored (same as node.js)
-
-		for (var i = 0; i < bytes.length - 1; i += 2) {
-			res += String.fromCharCode(bytes[i] + bytes[i + 1] * 256);
-		}
-
-		return res;
+		return _ucs2Slice(buf.buffer, buf.byteOffset + start, end - start);
 	}
 
 	Buffer.prototype.slice = function slice(start, end) {
@@ -2153,16 +1824,14 @@ function dew() {
 			end = target.length - targetStart + start;
 		}
 
-		var len = end - start;
-
-		if (this === target && typeof Uint8Array.prototype.copyWithin === "function") {
-			// Use built-in when available, missing from IE11
-			this.copyWithin(targetStart, start, end);
-		} else {
-			Uint8Array.prototype.set.call(target, this.subarray(start, end), targetStart);
-		}
-
-		return len;
+		return _copy(
+			this.buffer,
+			this.byteOffset + start,
+			end - start,
+			target.buffer,
+			target.byteOffset + targetStart,
+			target.length - targetStart,
+		);
 	}; // Usage:
 	//    buffer.fill(number[, offset[, end]])
 	//    buffer.fill(buffer[, offset[, end]])
@@ -2215,23 +1884,17 @@ function dew() {
 		if (!val) {
 			val = 0;
 		}
-		var i;
 
 		if (typeof val === "number") {
-			for (i = start; i < end; ++i) {
-				this[i] = val;
-			}
+			_fill(this.buffer, this.byteOffset + start, end - start, val & 255);
 		} else {
-			var bytes = Buffer.isBuffer(val) ? val : Buffer.from(val, encoding);
-			var len = bytes.length;
+			var bytes = isInstance(val, Uint8Array) ? val : Buffer.from(val, encoding);
 
-			if (len === 0) {
+			if (bytes.length === 0) {
 				throw new TypeError('The value "' + val + '" is invalid for argument "value"');
 			}
 
-			for (i = 0; i < end - start; ++i) {
-				this[i + start] = bytes[i % len];
-			}
+			_fill(this.buffer, this.byteOffset + start, end - start, bytes.buffer, bytes.byteOffset, bytes.byteLength);
 		}
 
 		return this;
@@ -2402,153 +2065,7 @@ function dew() {
 	} // HELPER FUNCTIONS
 	// ================
 
-	var INVALID_BASE64_RE = /[^+/0-9A-Za-z-_]/g;
-
-	function base64clean(str) {
-		// Node takes equal signs as end of the Base64 encoding
-		str = str.split("=")[0]; // Node strips out invalid characters like \n and \t from the string, base64-js does not
-
-		str = str.trim().replace(INVALID_BASE64_RE, ""); // Node converts strings with length < 2 to ''
-
-		if (str.length < 2) {
-			return "";
-		} // Node allows for non-padded base64 strings (missing trailing ===), base64-js does not
-
-		while (str.length % 4 !== 0) {
-			str = str + "=";
-		}
-
-		return str;
-	}
-
-	function utf8ToBytes(string, units) {
-		units = units || Infinity;
-		var codePoint;
-		var length = string.length;
-		var leadSurrogate = null;
-		var bytes = [];
-
-		for (var i = 0; i < length; ++i) {
-			codePoint = string.charCodeAt(i); // is surrogate component
-
-			if (codePoint > 55295 && codePoint < 57344) {
-				// last char was a lead
-				if (!leadSurrogate) {
-					// no lead yet
-					if (codePoint > 56319) {
-						// unexpected trail
-						if ((units -= 3) > -1) {
-							bytes.push(239, 191, 189);
-						}
-						continue;
-					} else if (i + 1 === length) {
-						// unpaired lead
-						if ((units -= 3) > -1) {
-							bytes.push(239, 191, 189);
-						}
-						continue;
-					} // valid lead
-
-					leadSurrogate = codePoint;
-					continue;
-				} // 2 leads in a row
-
-				if (codePoint < 56320) {
-					if ((units -= 3) > -1) {
-						bytes.push(239, 191, 189);
-					}
-					leadSurrogate = codePoint;
-					continue;
-				} // valid surrogate pair
-
-				codePoint = (((leadSurrogate - 55296) << 10) | (codePoint - 56320)) + 65536;
-			} else if (leadSurrogate) {
-				// valid bmp char, but last char was a lead
-				if ((units -= 3) > -1) {
-					bytes.push(239, 191, 189);
-				}
-			}
-
-			leadSurrogate = null; // encode utf8
-
-			if (codePoint < 128) {
-				if ((units -= 1) < 0) {
-					break;
-				}
-				bytes.push(codePoint);
-			} else if (codePoint < 2048) {
-				if ((units -= 2) < 0) {
-					break;
-				}
-				bytes.push((codePoint >> 6) | 192, (codePoint & 63) | 128);
-			} else if (codePoint < 65536) {
-				if ((units -= 3) < 0) {
-					break;
-				}
-				bytes.push((codePoint >> 12) | 224, ((codePoint >> 6) & 63) | 128, (codePoint & 63) | 128);
-			} else if (codePoint < 1114112) {
-				if ((units -= 4) < 0) {
-					break;
-				}
-				bytes.push(
-					(codePoint >> 18) | 240,
-					((codePoint >> 12) & 63) | 128,
-					((codePoint >> 6) & 63) | 128,
-					(codePoint & 63) | 128,
-				);
-			} else {
-				throw new Error("Invalid code point");
-			}
-		}
-
-		return bytes;
-	}
-
-	function asciiToBytes(str) {
-		var byteArray = [];
-
-		for (var i = 0; i < str.length; ++i) {
-			// Node's code seems to be doing this and not & 0x7F..
-			byteArray.push(str.charCodeAt(i) & 255);
-		}
-
-		return byteArray;
-	}
-
-	function utf16leToBytes(str, units) {
-		var c, hi, lo;
-		var byteArray = [];
-
-		for (var i = 0; i < str.length; ++i) {
-			if ((units -= 2) < 0) {
-				break;
-			}
-			c = str.charCodeAt(i);
-			hi = c >> 8;
-			lo = c % 256;
-			byteArray.push(lo);
-			byteArray.push(hi);
-		}
-
-		return byteArray;
-	}
-
-	function base64ToBytes(str) {
-		return base64.toByteArray(base64clean(str));
-	}
-
-	function blitBuffer(src, dst, offset, length) {
-		var i;
-
-		for (i = 0; i < length; ++i) {
-			if (i + offset >= dst.length || i >= src.length) {
-				break;
-			}
-			dst[i + offset] = src[i];
-		}
-
-		return i;
-	} // ArrayBuffer or Uint8Array objects from other contexts (i.e. iframes) do not pass
+	// ArrayBuffer or Uint8Array objects from other contexts (i.e. iframes) do not pass
 	// the `instanceof` check but they should be treated as of that type.
 	// See: https://github.com/feross/buffer/issues/166
 
@@ -2562,23 +2079,7 @@ function dew() {
 	function numberIsNaN(obj) {
 		// For IE11 support
 		return obj !== obj; // eslint-disable-line no-self-compare
-	} // Create lookup table for `toString('hex')`
-	// See: https://github.com/feross/buffer/issues/219
-
-	var hexSliceLookupTable = (function () {
-		var alphabet = "0123456789abcdef";
-		var table = new Array(256);
-
-		for (var i = 0; i < 16; ++i) {
-			var i16 = i * 16;
-
-			for (var j = 0; j < 16; ++j) {
-				table[i16 + j] = alphabet[i] + alphabet[j];
-			}
-		}
-
-		return table;
-	})(); // Return not function with Error if BigInt not supported
+	} // Return not function with Error if BigInt not supported
 
 	function defineBigIntMethod(fn) {
 		return typeof BigInt === "undefined" ? BufferBigIntNotDefined : fn;
@@ -0,0 +1,108 @@
+import { JsonParser as NativeParser } from "_drop:json";
+import { Buffer } from "buffer";
+import fs from "fs";
+
+// Values are emitted from the path given by `options.path`, keys joined by
+// "." or a list of them, where "*" matches any key or index. A number
+// `options.depth` emits every value at that depth, and no path emits the
+// whole document. `ndjson` reads a sequence of documents, newline separated
+// or not, and `keys` emits [key, value] pairs. Only the emitted values are
+// built, the rest of the input is scanned past.
+
+function argError(name, types, value) {
+	const err = new TypeError(`The "${name}" argument must be ${types}. Received ${typeof value}`);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	return err;
+}
+
+function pathOf(options) {
+	const { path, depth } = options;
+	if (path !== undefined) {
+		const keys = typeof path === "string" ? (path === "" ? [] : path.split(".")) : path;
+		if (!Array.isArray(keys)) throw argError("options.path", "a string or an array", path);
+		return keys.map((key) => (key === "*" ? null : String(key)));
+	}
+	if (depth !== undefined) {
+		if (!Number.isInteger(depth) || depth < 0) throw argError("options.depth", "a non-negative integer", depth);
+		return new Array(depth).fill(null);
+	}
+	return [];
+}
+
+function newNative(options = {}) {
+	return new NativeParser(pathOf(options), !!options.ndjson, !!options.keys);
+}
+
+export class JsonParser {
+	#native;
+
+	constructor(options) {
+		this.#native = newNative(options);
+	}
+
+	// The values completed by `chunk`, a string or bytes.
+	write(chunk) {
+		if (typeof chunk === "string") {
+			chunk = Buffer.from(chunk);
+		} else if (chunk instanceof ArrayBuffer) {
+			chunk = new Uint8Array(chunk);
+		} else if (!ArrayBuffer.isView(chunk)) {
+			throw argError("chunk", "a string, an ArrayBuffer or a view", chunk);
+		}
+		return this.#native.write(chunk.buffer, chunk.byteOffset, chunk.byteLength);
+	}
+
+	// The last values, throws when the input stopped short.
+	end() {
+		return this.#native.end();
+	}
+}
+
+function openFile(file) {
+	if (typeof file === "string") return fs.openSync(file, "r");
+	if (Number.isInteger(file) && file >= 0) return file;
+	throw argError("file", "a path or a file descriptor", file);
+}
+
+// Reads the file natively, chunk by chunk, yielding the values as they
+// complete. An fd passed in is left open.
+export function* parseFileSync(file, options) {
+	const native = newNative(options);
+	const fd = openFile(file);
+	try {
+		let values;
+		while ((values = native.readFd(fd)) !== null) {
+			yield* values;
+		}
+		yield* native.end();
+	} finally {
+		if (fd !== file) fs.closeSync(fd);
+	}
+}
+
+// Like parseFileSync, letting the event loop run between chunks.
+export async function* parseFile(file, options) {
+	const native = newNative(options);
+	const fd = openFile(file);
+	try {
+		let values;
+		while ((values = native.readFd(fd)) !== null) {
+			yield* values;
+			await new Promise((resolve) => setImmediate(resolve));
+		}
+		yield* native.end();
+	} finally {
+		if (fd !== file) fs.closeSync(fd);
+	}
+}
+
+// Parses a readable stream, or any async iterable of chunks.
+export async function* parseStream(stream, options) {
+	const parser = new JsonParser(options);
+	for await (const chunk of stream) {
+		yield* parser.write(chunk);
+	}
+	yield* parser.end();
+}
+
+export default { JsonParser, parseFile, parseFileSync, parseStream };
@@ -0,0 +1,58 @@
+import { extract as nativeExtract, pack as nativePack, list as nativeList } from "_drop:tar";
+
+// Archives are a path or an open fd, gzipped ones are recognized when read.
+// Every call runs to the end of the archive before it returns.
+// Filters get the entry path and its header, {path, type, size, mode,
+// mtime, linkpath}, and keep the entry when they return true.
+
+function argError(name, types, value) {
+	const err = new TypeError(`The "${name}" argument must be ${types}. Received ${typeof value}`);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	return err;
+}
+
+function checkArchive(archive) {
+	if (typeof archive === "string") return archive;
+	if (Number.isInteger(archive) && archive >= 0) return archive;
+	throw argError("archive", "a path or a file descriptor", archive);
+}
+
+function checkFilter(filter) {
+	if (filter === undefined) return undefined;
+	if (typeof filter !== "function") throw argError("options.filter", "of type function", filter);
+	return (info) => filter(info.path, info) === true;
+}
+
+function gzipLevel(gzip) {
+	if (gzip === undefined || gzip === false) return -1;
+	if (gzip === true) return 6;
+	const level = typeof gzip === "object" && gzip !== null ? gzip.level : gzip;
+	if (level === undefined) return 6;
+	if (!Number.isInteger(level) || level < 0 || level > 9) {
+		const err = new RangeError(
+			`The value of "options.gzip" is out of range. It must be >= 0 && <= 9. Received ${level}`,
+		);
+		err.code = "ERR_OUT_OF_RANGE";
+		throw err;
+	}
+	return level;
+}
+
+export function extractSync(archive, options = {}) {
+	const { cwd = ".", strip = 0, filter } = options;
+	if (!Number.isInteger(strip) || strip < 0) throw argError("options.strip", "a non-negative integer", strip);
+	return nativeExtract(checkArchive(archive), String(cwd), strip, checkFilter(filter));
+}
+
+export function packSync(archive, paths, options = {}) {
+	const { cwd = ".", gzip, filter } = options;
+	if (typeof paths === "string") paths = [paths];
+	if (!Array.isArray(paths)) throw argError("paths", "an array of strings", paths);
+	return nativePack(checkArchive(archive), String(cwd), paths, gzipLevel(gzip), checkFilter(filter));
+}
+
+export function listSync(archive, options = {}) {
+	return nativeList(checkArchive(archive), checkFilter(options.filter));
+}
+
+export default { extractSync, packSync, listSync };
@@ -28,7 +28,7 @@ export class TextEncoder {
 
 	encodeInto(src, dest) {
 		if (dest instanceof Uint8Array) {
-			return text_encode_into(src, "utf8", dest.buffer, dest.byteOffset);
+			return text_encode_into(src, "utf8", dest.buffer, dest.byteOffset, dest.byteLength);
 		} else {
 			throw new TypeError('The "dest" argument must be an instance of Uint8Array.');
 		}
@@ -43,7 +43,7 @@ export class TextDecoder {
 	constructor(encoding, options) {
 		let { fatal, ignoreBOM } = options || {};
 		this.#fatal = fatal ? true : false;
-		this.#ignoreBOM = ignoreBOM;
+		this.#ignoreBOM = ignoreBOM ? true : false;
 		encoding = encoding || "utf-8";
 
 		let exist = [
@@ -100,13 +100,24 @@ export class TextDecoder {
 		return this.#fatal;
 	}
 
+	get ignoreBOM() {
+		return this.#ignoreBOM;
+	}
+
 	decode(input) {
 		if (typeof input != "undefined") {
 			let ret;
-			if (input.buffer instanceof ArrayBuffer) {
-				ret = text_decode(input.buffer, this.encoding, this.fatal);
-			} else if (input instanceof ArrayBuffer) {
-				ret = text_decode(input, this.encoding, this.fatal);
+			if (ArrayBuffer.isView(input)) {
+				ret = text_decode(
+					input.buffer,
+					this.encoding,
+					this.fatal,
+					input.byteOffset,
+					input.byteLength,
+					this.ignoreBOM,
+				);
+			} else if (input instanceof ArrayBuffer || input instanceof SharedArrayBuffer) {
+				ret = text_decode(input, this.encoding, this.fatal, 0, input.byteLength, this.ignoreBOM);
 			}
 			if (isError(ret)) {
 				throw new TypeError(`The encoded data was not valid for encoding ${this.encoding}`);
@@ -0,0 +1,141 @@
+import { Buffer } from "buffer";
+import { Transform } from "stream";
+import { StringDecoder } from "string_decoder";
+import { Cipher as NativeCipher, getCiphers } from "_node:crypto";
+
+const nativeCiphers = getCiphers();
+
+export function hasNativeCipher(algorithm) {
+	return typeof algorithm === "string" && nativeCiphers.includes(algorithm.toLowerCase());
+}
+
+export { nativeCiphers };
+
+function stateError(message) {
+	const err = new Error(message);
+	err.code = "ERR_CRYPTO_INVALID_STATE";
+	return err;
+}
+
+function invalidState(operation) {
+	return stateError(`Invalid state for operation ${operation}`);
+}
+
+function toView(value, name, encoding) {
+	if (typeof value === "string") return Buffer.from(value, encoding);
+	if (ArrayBuffer.isView(value)) return value;
+	if (value instanceof ArrayBuffer) return new Uint8Array(value);
+	const err = new TypeError(
+		`The "${name}" argument must be of type string or an instance of ArrayBuffer, Buffer, TypedArray, or DataView`,
+	);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	throw err;
+}
+
+// Cipheriv and Decipheriv share everything but the direction. Like in
+// node, both have the auth tag accessors and throw from the one that
+// doesn't apply.
+class CipherBase extends Transform {
+	#state;
+	#decrypt;
+	#decoder;
+	#finished = false;
+
+	constructor(algorithm, key, iv, options, decrypt) {
+		super(options);
+		key = toView(key, "key");
+		iv = toView(iv, "iv");
+		this.#decrypt = decrypt;
+		const tagLength = options && options.authTagLength !== undefined ? options.authTagLength : 0;
+		this.#state = new NativeCipher(
+			algorithm.toLowerCase(),
+			decrypt,
+			key.buffer,
+			key.byteOffset,
+			key.byteLength,
+			iv.buffer,
+			iv.byteOffset,
+			iv.byteLength,
+			tagLength,
+		);
+	}
+
+	#output(arrayBuffer, encoding) {
+		const buf = Buffer.from(arrayBuffer);
+		if (encoding === undefined || encoding === "buffer") return buf;
+		// keeps characters split across calls together
+		if (this.#decoder === undefined) this.#decoder = new StringDecoder(encoding);
+		return this.#decoder.write(buf);
+	}
+
+	update(data, inputEncoding, outputEncoding) {
+		if (this.#finished) throw stateError("Trying to add data in unsupported state");
+		const view = toView(data, "data", inputEncoding);
+		return this.#output(this.#state.update(view.buffer, view.byteOffset, view.byteLength), outputEncoding);
+	}
+
+	final(outputEncoding) {
+		if (this.#finished) throw stateError("Unsupported state");
+		this.#finished = true;
+		const out = this.#output(this.#state.final(), outputEncoding);
+		return this.#decoder === undefined ? out : out + this.#decoder.end();
+	}
+
+	setAutoPadding(autoPadding = true) {
+		this.#state.setAutoPadding(!!autoPadding);
+		return this;
+	}
+
+	setAAD(buffer, options) {
+		const view = toView(buffer, "buffer");
+		if (!this.#state.setAAD(view.buffer, view.byteOffset, view.byteLength)) throw invalidState("setAAD");
+		return this;
+	}
+
+	getAuthTag() {
+		const tag = this.#state.getAuthTag();
+		if (tag === undefined) throw invalidState("getAuthTag");
+		return Buffer.from(tag);
+	}
+
+	setAuthTag(tag, encoding) {
+		if (!this.#decrypt) throw invalidState("setAuthTag");
+		const view = toView(tag, "buffer", encoding);
+		if (!this.#state.setAuthTag(view.buffer, view.byteOffset, view.byteLength)) {
+			const err = new TypeError(`Invalid authentication tag length: ${view.byteLength}`);
+			err.code = "ERR_CRYPTO_INVALID_AUTH_TAG";
+			throw err;
+		}
+		return this;
+	}
+
+	_transform(chunk, encoding, callback) {
+		try {
+			this.push(this.update(chunk, encoding));
+		} catch (err) {
+			return callback(err);
+		}
+		callback();
+	}
+
+	_flush(callback) {
+		try {
+			this.push(this.final());
+		} catch (err) {
+			return callback(err);
+		}
+		callback();
+	}
+}
+
+export class Cipheriv extends CipherBase {
+	constructor(algorithm, key, iv, options) {
+		super(algorithm, key, iv, options, false);
+	}
+}
+
+export class Decipheriv extends CipherBase {
+	constructor(algorithm, key, iv, options) {
+		super(algorithm, key, iv, options, true);
+	}
+}
@@ -0,0 +1,121 @@
+import { Buffer } from "buffer";
+import { Transform } from "stream";
+import { Hash as NativeHash, Hmac as NativeHmac, getHashes } from "_node:crypto";
+
+const nativeHashes = getHashes();
+
+export function hasNativeHash(algorithm) {
+	return typeof algorithm === "string" && nativeHashes.includes(algorithm.toLowerCase());
+}
+
+export { nativeHashes };
+
+function cryptoError(code, message) {
+	const err = new Error(message);
+	err.code = code;
+	return err;
+}
+
+// Strings other than UTF-8 go through a Buffer, UTF-8 ones are encoded by
+// the native side as they are hashed.
+function update(state, data, encoding) {
+	if (typeof data === "string") {
+		if (encoding === undefined || encoding === "utf8" || encoding === "utf-8") {
+			state.update(data);
+			return;
+		}
+		data = Buffer.from(data, encoding);
+	} else if (!ArrayBuffer.isView(data)) {
+		const err = new TypeError(
+			'The "data" argument must be of type string or an instance of Buffer, TypedArray, or DataView',
+		);
+		err.code = "ERR_INVALID_ARG_TYPE";
+		throw err;
+	}
+	state.update(data.buffer, data.byteOffset, data.byteLength);
+}
+
+function output(arrayBuffer, encoding) {
+	const buf = Buffer.from(arrayBuffer);
+	return encoding === undefined || encoding === "buffer" ? buf : buf.toString(encoding);
+}
+
+export class Hash extends Transform {
+	#state;
+	#finalized = false;
+
+	constructor(algorithm, options) {
+		super(options);
+		this.#state = algorithm instanceof NativeHash ? algorithm : new NativeHash(algorithm.toLowerCase());
+	}
+
+	copy(options) {
+		if (this.#finalized) throw cryptoError("ERR_CRYPTO_HASH_FINALIZED", "Digest already called");
+		return new Hash(this.#state.copy(), options);
+	}
+
+	update(data, encoding) {
+		if (this.#finalized) throw cryptoError("ERR_CRYPTO_HASH_FINALIZED", "Digest already called");
+		update(this.#state, data, encoding);
+		return this;
+	}
+
+	digest(encoding) {
+		if (this.#finalized) throw cryptoError("ERR_CRYPTO_HASH_FINALIZED", "Digest already called");
+		this.#finalized = true;
+		return output(this.#state.digest(), encoding);
+	}
+
+	_transform(chunk, encoding, callback) {
+		this.update(chunk, encoding);
+		callback();
+	}
+
+	_flush(callback) {
+		this.push(this.digest());
+		callback();
+	}
+}
+
+export class Hmac extends Transform {
+	#state;
+	#finalized = false;
+
+	constructor(algorithm, key, options) {
+		super(options);
+		if (typeof key === "string") {
+			key = Buffer.from(key, options && options.encoding);
+		} else if (!ArrayBuffer.isView(key)) {
+			const err = new TypeError(
+				'The "key" argument must be of type string or an instance of Buffer, TypedArray, or DataView',
+			);
+			err.code = "ERR_INVALID_ARG_TYPE";
+			throw err;
+		}
+		this.#state = new NativeHmac(algorithm.toLowerCase(), key.buffer, key.byteOffset, key.byteLength);
+	}
+
+	update(data, encoding) {
+		if (this.#finalized) throw cryptoError("ERR_CRYPTO_HASH_FINALIZED", "Digest already called");
+		update(this.#state, data, encoding);
+		return this;
+	}
+
+	// Like node, a second digest() returns an empty result instead of
+	// throwing.
+	digest(encoding) {
+		if (this.#finalized) return output(new ArrayBuffer(0), encoding);
+		this.#finalized = true;
+		return output(this.#state.digest(), encoding);
+	}
+
+	_transform(chunk, encoding, callback) {
+		this.update(chunk, encoding);
+		callback();
+	}
+
+	_flush(callback) {
+		this.push(this.digest());
+		callback();
+	}
+}
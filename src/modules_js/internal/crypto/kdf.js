@@ -0,0 +1,162 @@
+import { Buffer } from "buffer";
+import process from "process";
+import { pbkdf2 as nativePbkdf2, scrypt as nativeScrypt, hkdf as nativeHkdf } from "_node:crypto";
+
+// Time an async job may hold the loop before the next slice is queued
+// behind the other pending tasks.
+const SLICE_MS = 4;
+
+function argError(name, types) {
+	const err = new TypeError(`The "${name}" argument must be ${types}`);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	return err;
+}
+
+function rangeError(code, message) {
+	const err = new RangeError(message);
+	err.code = code;
+	return err;
+}
+
+function toView(value, name) {
+	if (typeof value === "string") return Buffer.from(value);
+	if (ArrayBuffer.isView(value)) return value;
+	if (value instanceof ArrayBuffer) return new Uint8Array(value);
+	throw argError(name, "of type string or an instance of ArrayBuffer, Buffer, TypedArray, or DataView");
+}
+
+function checkInt(value, name, min, max = 2 ** 31 - 1) {
+	if (typeof value !== "number") throw argError(name, "of type number");
+	if (!Number.isInteger(value) || value < min || value > max) {
+		throw rangeError(
+			"ERR_OUT_OF_RANGE",
+			`The value of "${name}" is out of range. It must be >= ${min} && <= ${max}. Received ${value}`,
+		);
+	}
+	return value;
+}
+
+function checkCallback(callback) {
+	if (typeof callback !== "function") throw argError("callback", "of type function");
+}
+
+function runSync(job) {
+	job.step(0);
+	return Buffer.from(job.result());
+}
+
+function runAsync(job, callback) {
+	const slice = () => {
+		let done;
+		try {
+			done = job.step(SLICE_MS);
+		} catch (err) {
+			return callback(err);
+		}
+		if (done) callback(null, Buffer.from(job.result()));
+		else setImmediate(slice);
+	};
+	setImmediate(slice);
+}
+
+function args(...views) {
+	return views.flatMap((v) => [v.buffer, v.byteOffset, v.byteLength]);
+}
+
+function pbkdf2Job(password, salt, iterations, keylen, digest) {
+	password = toView(password, "password");
+	salt = toView(salt, "salt");
+	checkInt(iterations, "iterations", 1);
+	checkInt(keylen, "keylen", 0);
+	if (typeof digest !== "string") throw argError("digest", "of type string");
+	const job = nativePbkdf2(digest.toLowerCase(), ...args(password, salt), iterations, keylen);
+	if (job === null) {
+		const err = new TypeError(`Invalid digest: ${digest}`);
+		err.code = "ERR_CRYPTO_INVALID_DIGEST";
+		throw err;
+	}
+	return job;
+}
+
+export function pbkdf2Sync(password, salt, iterations, keylen, digest) {
+	return runSync(pbkdf2Job(password, salt, iterations, keylen, digest));
+}
+
+export function pbkdf2(password, salt, iterations, keylen, digest, callback) {
+	checkCallback(callback);
+	runAsync(pbkdf2Job(password, salt, iterations, keylen, digest), callback);
+}
+
+function scryptParam(options, name, alias, fallback) {
+	const a = options[name];
+	const b = options[alias];
+	if (a !== undefined && b !== undefined) {
+		const err = new TypeError(`Option "${name}" cannot be used in combination with option "${alias}"`);
+		err.code = "ERR_INCOMPATIBLE_OPTION_PAIR";
+		throw err;
+	}
+	return a !== undefined ? a : b !== undefined ? b : fallback;
+}
+
+function scryptJob(password, salt, keylen, options) {
+	password = toView(password, "password");
+	salt = toView(salt, "salt");
+	checkInt(keylen, "keylen", 0);
+	options = options || {};
+	const N = checkInt(scryptParam(options, "N", "cost", 16384), "N", 2);
+	const r = checkInt(scryptParam(options, "r", "blockSize", 8), "r", 1);
+	const p = checkInt(scryptParam(options, "p", "parallelization", 1), "p", 1);
+	const maxmem = options.maxmem !== undefined ? options.maxmem : 32 << 20;
+	if ((N & (N - 1)) !== 0) {
+		throw rangeError("ERR_CRYPTO_INVALID_SCRYPT_PARAMS", "Invalid scrypt params: N must be a power of two");
+	}
+	if (p * r >= 2 ** 30) {
+		throw rangeError("ERR_CRYPTO_INVALID_SCRYPT_PARAMS", "Invalid scrypt params: p * r must be < 2^30");
+	}
+	// the p lanes of B and the N blocks of V, 128 * r bytes each
+	if (128 * r * (N + p) > maxmem) {
+		throw rangeError("ERR_CRYPTO_INVALID_SCRYPT_PARAMS", "Invalid scrypt params: memory limit exceeded");
+	}
+	return nativeScrypt(...args(password, salt), keylen, N, r, p);
+}
+
+export function scryptSync(password, salt, keylen, options) {
+	return runSync(scryptJob(password, salt, keylen, options));
+}
+
+export function scrypt(password, salt, keylen, options, callback) {
+	if (typeof options === "function") {
+		callback = options;
+		options = undefined;
+	}
+	checkCallback(callback);
+	runAsync(scryptJob(password, salt, keylen, options), callback);
+}
+
+export function hkdfSync(digest, ikm, salt, info, keylen) {
+	if (typeof digest !== "string") throw argError("digest", "of type string");
+	ikm = toView(ikm, "ikm");
+	salt = toView(salt, "salt");
+	info = toView(info, "info");
+	checkInt(keylen, "keylen", 0);
+	if (info.byteLength > 1024) {
+		throw rangeError(
+			"ERR_OUT_OF_RANGE",
+			`The value of "info" is out of range. It must be <= 1024 bytes. Received ${info.byteLength}`,
+		);
+	}
+	const key = nativeHkdf(digest.toLowerCase(), ...args(ikm, salt, info), keylen);
+	if (key === null) {
+		const err = new TypeError(`Invalid digest: ${digest}`);
+		err.code = "ERR_CRYPTO_INVALID_DIGEST";
+		throw err;
+	}
+	return key;
+}
+
+// HKDF is only a few HMACs long, the callback just comes a tick later.
+export function hkdf(digest, ikm, salt, info, keylen, callback) {
+	checkCallback(callback);
+	const key = hkdfSync(digest, ikm, salt, info, keylen);
+	process.nextTick(() => callback(null, key));
+}
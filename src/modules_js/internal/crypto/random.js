@@ -0,0 +1,149 @@
+import { Buffer } from "buffer";
+import process from "process";
+import { randomFill as nativeRandomFill, randomUUID as nativeRandomUUID } from "_node:crypto";
+
+const MAX_SIZE = 2 ** 31 - 1;
+// randomInt draws 48 bits at a time
+const RAND_MAX = 2 ** 48 - 1;
+
+function argError(name, types, value) {
+	const err = new TypeError(`The "${name}" argument must be ${types}. Received ${typeof value}`);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	return err;
+}
+
+function rangeError(name, range, value) {
+	const err = new RangeError(`The value of "${name}" is out of range. It must be ${range}. Received ${value}`);
+	err.code = "ERR_OUT_OF_RANGE";
+	return err;
+}
+
+function checkNumber(value, name, min, max) {
+	if (typeof value !== "number") throw argError(name, "of type number", value);
+	if (!Number.isInteger(value) || value < min || value > max) {
+		throw rangeError(name, `>= ${min} && <= ${max}`, value);
+	}
+	return value;
+}
+
+function checkCallback(callback) {
+	if (typeof callback !== "function") throw argError("callback", "of type function", callback);
+}
+
+function fillView(view, byteOffset, byteLength) {
+	nativeRandomFill(view.buffer || view, (view.byteOffset || 0) + byteOffset, byteLength);
+}
+
+export function randomBytes(size, callback) {
+	checkNumber(size, "size", 0, MAX_SIZE);
+	if (callback !== undefined) checkCallback(callback);
+	const buf = Buffer.allocUnsafe(size);
+	fillView(buf, 0, size);
+	if (callback === undefined) return buf;
+	process.nextTick(() => callback(null, buf));
+}
+
+// Offset and size count elements of the view, like in node.
+function fillRange(buf, offset, size) {
+	if (!ArrayBuffer.isView(buf) && !(buf instanceof ArrayBuffer)) {
+		throw argError("buf", "an instance of ArrayBuffer or ArrayBufferView", buf);
+	}
+	const elementSize = buf.BYTES_PER_ELEMENT || 1;
+	const byteLength = buf.byteLength;
+	const start = checkNumber(offset, "offset", 0, byteLength / elementSize) * elementSize;
+	const max = byteLength - start;
+	const n = size === undefined ? max : checkNumber(size, "size", 0, max / elementSize) * elementSize;
+	return [start, n];
+}
+
+export function randomFillSync(buf, offset = 0, size) {
+	const [start, n] = fillRange(buf, offset, size);
+	fillView(buf, start, n);
+	return buf;
+}
+
+export function randomFill(buf, offset, size, callback) {
+	if (typeof offset === "function") {
+		callback = offset;
+		offset = 0;
+		size = undefined;
+	} else if (typeof size === "function") {
+		callback = size;
+		size = undefined;
+	}
+	checkCallback(callback);
+	const [start, n] = fillRange(buf, offset, size);
+	fillView(buf, start, n);
+	process.nextTick(() => callback(null, buf));
+}
+
+export function randomInt(min, max, callback) {
+	if (max === undefined || typeof max === "function") {
+		callback = max;
+		max = min;
+		min = 0;
+	}
+	if (callback !== undefined) checkCallback(callback);
+	if (!Number.isSafeInteger(min)) throw argError("min", "a safe integer", min);
+	if (!Number.isSafeInteger(max)) throw argError("max", "a safe integer", max);
+	if (max <= min) {
+		throw rangeError("max", `greater than the value of "min" (${min})`, max);
+	}
+	const range = max - min;
+	if (range > RAND_MAX) {
+		throw rangeError("max - min", `<= ${RAND_MAX}`, range);
+	}
+	// rejection sampling keeps every value equally likely
+	const limit = RAND_MAX - (RAND_MAX % range);
+	const bytes = new Uint8Array(6);
+	let x;
+	do {
+		fillView(bytes, 0, 6);
+		x = bytes.reduce((acc, b) => acc * 256 + b, 0);
+	} while (x >= limit);
+	const n = min + (x % range);
+	if (callback === undefined) return n;
+	process.nextTick(() => callback(null, n));
+}
+
+export function randomUUID(options) {
+	if (options !== undefined && (typeof options !== "object" || options === null)) {
+		throw argError("options", "of type object", options);
+	}
+	return nativeRandomUUID();
+}
+
+const INTEGER_ARRAYS = [
+	Int8Array,
+	Uint8Array,
+	Uint8ClampedArray,
+	Int16Array,
+	Uint16Array,
+	Int32Array,
+	Uint32Array,
+	BigInt64Array,
+	BigUint64Array,
+];
+
+// Web Crypto's getRandomValues, also the entropy source crypto-browserify
+// looks for on the global crypto object.
+export function getRandomValues(array) {
+	if (!INTEGER_ARRAYS.some((type) => array instanceof type)) {
+		const err = new TypeError("The data argument must be an integer-type TypedArray");
+		err.name = "TypeMismatchError";
+		throw err;
+	}
+	if (array.byteLength > 65536) {
+		const err = new RangeError(
+			`The ArrayBufferView's byte length (${array.byteLength}) exceeds the number of bytes of entropy available via this API (65536)`,
+		);
+		err.name = "QuotaExceededError";
+		throw err;
+	}
+	fillView(array, 0, array.byteLength);
+	return array;
+}
+
+if (globalThis.crypto === undefined) {
+	globalThis.crypto = { getRandomValues, randomUUID };
+}
@@ -1982,7 +1982,7 @@ function write(fd, buffer, offset, length, position, callback) {
 	position = position ?? -1;
 
 	if (isArrayBufferView(buffer) && !(buffer instanceof Buffer)) {
-		buffer = Buffer.from(buffer.buffer);
+		buffer = Buffer.from(buffer.buffer, buffer.byteOffset, buffer.byteLength);
 	}
 
 	if (typeof buffer !== "string" && !(buffer instanceof Buffer)) {
@@ -1996,7 +1996,7 @@ function write(fd, buffer, offset, length, position, callback) {
 	validateInteger(fd, "fd");
 	validateInteger(offset + length, "length + offset", 0, buffer.byteLength);
 
-	fwrite(fd, position, buffer.buffer.slice(offset, offset + length))
+	fwrite(fd, position, buffer.buffer.slice(buffer.byteOffset + offset, buffer.byteOffset + offset + length))
 		.then((len) => {
 			callback(null, len, buffer);
 		})
@@ -2047,7 +2047,7 @@ function writeSync(fd, buffer, offset, length, position) {
 	validateInteger(length + offset, "length + offset", 0, buffer.byteLength);
 
 	try {
-		let len = binding.fwriteSync(fd, position, buffer.buffer.slice(offset, offset + length));
+		let len = binding.fwriteSync(fd, position, buffer.buffer.slice(buffer.byteOffset + offset, buffer.byteOffset + offset + length));
 		return len;
 	} catch (e) {
 		throw wasiFsSyscallErrorMap(e, "write");
@@ -2305,6 +2305,11 @@ function isArrayBufferView(value) {
 	return value && value.buffer instanceof ArrayBuffer && value.byteLength !== undefined;
 }
 
+// The bytes of a view as their own ArrayBuffer; small Buffers share a pool.
+function toArrayBuffer(view) {
+	return view.buffer.slice(view.byteOffset, view.byteOffset + view.byteLength);
+}
+
 function writev(fd, buffer, position, callback) {
 	if (typeof position === "function") {
 		callback = position;
@@ -2327,7 +2332,7 @@ function writev(fd, buffer, position, callback) {
 		length += buf.byteLength;
 	}
 
-	fwrite(fd, position, Buffer.concat(buffer).buffer)
+	fwrite(fd, position, toArrayBuffer(Buffer.concat(buffer)))
 		.then((len) => {
 			callback(null, len, buffer);
 		})
@@ -2354,7 +2359,7 @@ function writevSync(fd, buffer, position = -1) {
 	}
 
 	try {
-		let len = binding.fwriteSync(fd, position, Buffer.concat(buffer).buffer);
+		let len = binding.fwriteSync(fd, position, toArrayBuffer(Buffer.concat(buffer)));
 		return len;
 	} catch (err) {
 		throw wasiFsSyscallErrorMap(err, "write");
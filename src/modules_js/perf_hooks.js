@@ -0,0 +1,135 @@
+import {
+	now,
+	timeOrigin,
+	elu,
+	eldEnable,
+	eldDisable,
+	eldReset,
+	eldStats,
+	eldPercentile,
+} from "_node:perf_hooks";
+
+// Idle time is what the event loop spent blocked in poll_oneoff, everything
+// else (including synchronous fs calls) counts as active.
+function eventLoopUtilization(util1, util2) {
+	const [idle, active] = elu();
+	if (util1 === undefined) {
+		return { idle, active, utilization: active / (idle + active || 1) };
+	}
+	const end = util2 === undefined ? { idle, active } : util1;
+	const start = util2 === undefined ? util1 : util2;
+	const idleDelta = end.idle - start.idle;
+	const activeDelta = end.active - start.active;
+	return {
+		idle: idleDelta,
+		active: activeDelta,
+		utilization: activeDelta / (idleDelta + activeDelta || 1),
+	};
+}
+
+const performance = {
+	now,
+	get timeOrigin() {
+		return timeOrigin();
+	},
+	eventLoopUtilization,
+	toJSON() {
+		return {
+			timeOrigin: this.timeOrigin,
+			eventLoopUtilization: eventLoopUtilization(),
+		};
+	},
+};
+
+// The histogram lives in the event loop, so there is a single monitor:
+// every IntervalHistogram observes the same samples.
+class IntervalHistogram {
+	#resolution;
+	#enabled = false;
+
+	constructor(resolution) {
+		this.#resolution = resolution;
+	}
+
+	enable() {
+		if (this.#enabled) return false;
+		eldEnable(this.#resolution);
+		this.#enabled = true;
+		return true;
+	}
+
+	disable() {
+		if (!this.#enabled) return false;
+		eldDisable();
+		this.#enabled = false;
+		return true;
+	}
+
+	reset() {
+		eldReset();
+	}
+
+	get min() {
+		return eldStats().min;
+	}
+
+	get max() {
+		return eldStats().max;
+	}
+
+	get mean() {
+		return eldStats().mean;
+	}
+
+	get stddev() {
+		return eldStats().stddev;
+	}
+
+	get count() {
+		return eldStats().count;
+	}
+
+	get exceeds() {
+		return 0;
+	}
+
+	percentile(percentile) {
+		if (typeof percentile !== "number") {
+			throw new TypeError('The "percentile" argument must be of type number');
+		}
+		return eldPercentile(percentile);
+	}
+
+	get percentiles() {
+		const map = new Map();
+		if (this.count === 0) return map;
+		for (const p of [50, 75, 90, 99, 99.9, 100]) {
+			map.set(p, eldPercentile(p));
+		}
+		return map;
+	}
+
+	toJSON() {
+		return {
+			...eldStats(),
+			exceeds: 0,
+			percentiles: Object.fromEntries(this.percentiles),
+		};
+	}
+}
+
+function monitorEventLoopDelay(options = {}) {
+	const { resolution = 10 } = options;
+	if (typeof resolution !== "number" || !(resolution >= 1)) {
+		throw new RangeError('The "options.resolution" must be >= 1');
+	}
+	return new IntervalHistogram(resolution);
+}
+
+export { performance, monitorEventLoopDelay, eventLoopUtilization };
+
+export default {
+	performance,
+	monitorEventLoopDelay,
+	eventLoopUtilization,
+};
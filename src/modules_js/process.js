@@ -1,3 +1,6 @@
+import { _memoryUsage, _rss } from "_node:process";
+import { now as _now } from "_node:perf_hooks";
+
 function unimplemented(name) {
 	throw new Error("Node.js process " + name + " is not supported");
 }
@@ -62,7 +65,10 @@ var cpuUsage = function () {
 	return {};
 };
 var resourceUsage = cpuUsage;
-var memoryUsage = cpuUsage;
+var memoryUsage = function () {
+	return _memoryUsage();
+};
+memoryUsage.rss = _rss;
 var kill = noop;
 var exit = globalThis.exit;
 var openStdin = noop;
@@ -106,19 +112,8 @@ var _preload_modules = [];
 var setSourceMapsEnabled = noop;
 
 var _performance = {
-	now: undefined,
-	timing: undefined,
+	now: _now,
 };
-if (_performance.now === undefined) {
-	var nowOffset = Date.now();
-
-	if (_performance.timing && _performance.timing.navigationStart) {
-		nowOffset = _performance.timing.navigationStart;
-	}
-	_performance.now = function () {
-		return Date.now() - nowOffset;
-	};
-}
 
 function uptime() {
 	return _performance.now() / 1000;
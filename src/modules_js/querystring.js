@@ -1,82 +1,113 @@
-function e(e, n) {
-	return Object.prototype.hasOwnProperty.call(e, n);
+import {
+	parse as nativeParse,
+	stringify as nativeStringify,
+	escape as nativeEscape,
+	unescape as nativeUnescape,
+} from "_node:querystring";
+
+function stringifyPrimitive(v) {
+	switch (typeof v) {
+		case "string":
+			return v;
+		case "number":
+			return isFinite(v) ? "" + v : "";
+		case "bigint":
+			return "" + v;
+		case "boolean":
+			return v ? "true" : "false";
+		default:
+			return "";
+	}
 }
-var n = function (n, r, t, o) {
-		(r = r || "&"), (t = t || "=");
-		var a = {};
-		if ("string" != typeof n || 0 === n.length) {
-			return a;
-		}
-		var u = /\+/g;
-		n = n.split(r);
-		var c = 1e3;
-		o && "number" == typeof o.maxKeys && (c = o.maxKeys);
-		var i = n.length;
-		c > 0 && i > c && (i = c);
-		for (var s = 0; s < i; ++s) {
-			var p,
-				f,
-				d,
-				y,
-				m = n[s].replace(u, "%20"),
-				l = m.indexOf(t);
-			l >= 0 ? ((p = m.substr(0, l)), (f = m.substr(l + 1))) : ((p = m), (f = "")),
-				(d = decodeURIComponent(p)),
-				(y = decodeURIComponent(f)),
-				e(a, d) ? (Array.isArray(a[d]) ? a[d].push(y) : (a[d] = [a[d], y])) : (a[d] = y);
+
+export function escape(str) {
+	return nativeEscape(typeof str === "string" ? str : String(str), false);
+}
+
+export function unescape(s, decodeSpaces) {
+	return nativeUnescape(String(s), !!decodeSpaces);
+}
+
+// The key, value list of an object, arrays giving one pair per element.
+function pairsOf(obj) {
+	const list = [];
+	for (const key of Object.keys(obj)) {
+		const k = stringifyPrimitive(key);
+		const v = obj[key];
+		if (Array.isArray(v)) {
+			for (const item of v) {
+				list.push(k, stringifyPrimitive(item));
+			}
+		} else {
+			list.push(k, stringifyPrimitive(v));
 		}
-		return a;
-	},
-	r = function (e) {
-		switch (typeof e) {
-			case "string":
-				return e;
-			case "boolean":
-				return e ? "true" : "false";
-			case "number":
-				return isFinite(e) ? e : "";
-			default:
-				return "";
+	}
+	return list;
+}
+
+export function stringify(obj, sep, eq, options) {
+	sep = sep || "&";
+	eq = eq || "=";
+	if (obj === null || typeof obj !== "object") {
+		return "";
+	}
+	const list = pairsOf(obj);
+	const encode = options && options.encodeURIComponent;
+	if (typeof encode === "function" && encode !== escape) {
+		let out = "";
+		for (let i = 0; i < list.length; i += 2) {
+			out += (i > 0 ? sep : "") + encode(list[i]) + eq + encode(list[i + 1]);
 		}
-	},
-	t = function (e, n, t, o) {
-		return (
-			(n = n || "&"),
-			(t = t || "="),
-			null === e && (e = void 0),
-			"object" == typeof e
-				? Object.keys(e)
-						.map(function (o) {
-							var a = encodeURIComponent(r(o)) + t;
-							return Array.isArray(e[o])
-								? e[o]
-										.map(function (e) {
-											return a + encodeURIComponent(r(e));
-										})
-										.join(n)
-								: a + encodeURIComponent(r(e[o]));
-						})
-						.join(n)
-				: o
-				? encodeURIComponent(r(o)) + t + encodeURIComponent(r(e))
-				: ""
-		);
-	},
-	o = {};
-(o.decode = o.parse = n), (o.encode = o.stringify = t);
-o.decode;
-o.encode;
-o.parse;
-o.stringify;
+		return out;
+	}
+	return nativeStringify(list, String(sep), String(eq), false);
+}
+
+function decodeWith(decode, s) {
+	s = s.replace(/\+/g, " ");
+	try {
+		return decode(s);
+	} catch {
+		return unescape(s);
+	}
+}
 
-o.decode;
-o.encode;
-o.parse;
-o.stringify;
+export function parse(qs, sep, eq, options) {
+	const obj = Object.create(null);
+	if (typeof qs !== "string" || qs.length === 0) {
+		return obj;
+	}
+	sep = sep ? String(sep) : "&";
+	eq = eq ? String(eq) : "=";
+	const maxKeys = options && typeof options.maxKeys === "number" ? options.maxKeys : 1000;
+	const decode = options && options.decodeURIComponent;
+	if (typeof decode !== "function" || decode === unescape) {
+		return nativeParse(qs, sep, eq, maxKeys > 0 ? maxKeys : 0, obj);
+	}
+	let pieces = qs.split(sep);
+	if (maxKeys > 0) {
+		pieces = pieces.slice(0, maxKeys);
+	}
+	for (const piece of pieces) {
+		if (piece.length === 0) {
+			continue;
+		}
+		const i = piece.indexOf(eq);
+		const key = decodeWith(decode, i >= 0 ? piece.slice(0, i) : piece);
+		const value = i >= 0 ? decodeWith(decode, piece.slice(i + eq.length)) : "";
+		const prev = obj[key];
+		if (prev === undefined) {
+			obj[key] = value;
+		} else if (Array.isArray(prev)) {
+			prev.push(value);
+		} else {
+			obj[key] = [prev, value];
+		}
+	}
+	return obj;
+}
 
-var decode = o.decode;
-var encode = o.encode;
-var parse = o.parse;
-var stringify = o.stringify;
+export const decode = parse;
+export const encode = stringify;
 
-export { decode, o as default, encode, parse, stringify };
+export default { decode, encode, escape, parse, stringify, unescape };
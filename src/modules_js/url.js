@@ -3,6 +3,7 @@ import * as o$1 from "querystring";
 import process from "process";
 import * as exports$1 from "path";
 import { URL } from "whatwg_url";
+import { domainToASCII, domainToUnicode } from "_node:url";
 
 var h = {};
 var e = p$1;
@@ -1143,6 +1144,8 @@ var processPlatform = "wasi";
 h.URL = typeof URL !== "undefined" ? URL : null;
 h.pathToFileURL = pathToFileURL;
 h.fileURLToPath = fileURLToPath;
+h.domainToASCII = domainToASCII;
+h.domainToUnicode = domainToUnicode;
 
 var Url = h.Url;
 var format = h.format;
@@ -1260,4 +1263,16 @@ function pathToFileURL(filepath) {
 	return outURL;
 }
 
-export { _URL as URL, Url, h as default, fileURLToPath, format, parse, pathToFileURL, resolve, resolveObject };
+export {
+	_URL as URL,
+	Url,
+	h as default,
+	domainToASCII,
+	domainToUnicode,
+	fileURLToPath,
+	format,
+	parse,
+	pathToFileURL,
+	resolve,
+	resolveObject,
+};
@@ -0,0 +1,108 @@
+import EventEmitter from "events";
+import {
+	spawn,
+	postMessage,
+	terminate,
+	setRef,
+	release,
+	workerInfo,
+	parentPortListen,
+	parentPortRef,
+	postToParent,
+} from "_node:worker_threads";
+
+const info = workerInfo();
+
+const isMainThread = info === null;
+const threadId = isMainThread ? 0 : info.threadId;
+const workerData = isMainThread ? null : info.workerData;
+const resourceLimits = {};
+
+// Messages from the parent are only received, and keep the worker alive,
+// while someone listens for them.
+class ParentPort extends EventEmitter {
+	#listening = false;
+
+	constructor() {
+		super();
+		this.on("newListener", (name) => {
+			if (name !== "message") return;
+			if (!this.#listening) {
+				this.#listening = true;
+				parentPortListen((kind, value) => this.emit(kind, value));
+			} else {
+				parentPortRef(true);
+			}
+		});
+		this.on("removeListener", (name) => {
+			if (name === "message" && this.listenerCount("message") === 0) {
+				parentPortRef(false);
+			}
+		});
+	}
+
+	postMessage(value) {
+		postToParent(value);
+	}
+
+	ref() {
+		parentPortRef(true);
+	}
+
+	unref() {
+		parentPortRef(false);
+	}
+}
+
+const parentPort = isMainThread ? null : new ParentPort();
+
+class Worker extends EventEmitter {
+	#id;
+
+	constructor(filename, options = {}) {
+		super();
+		if (typeof filename === "object" && filename !== null && filename.href !== undefined) {
+			filename = decodeURIComponent(filename.pathname);
+		}
+		if (typeof filename !== "string") {
+			throw new TypeError('The "filename" argument must be of type string or an instance of URL');
+		}
+		const argv = (options.argv || []).map(String);
+		this.#id = spawn(filename, options.workerData, argv, (kind, value) => {
+			if (kind === "exit") release(this.#id);
+			this.emit(kind, value);
+		});
+		this.threadId = this.#id;
+		Promise.resolve().then(() => this.emit("online"));
+	}
+
+	postMessage(value) {
+		postMessage(this.#id, value);
+	}
+
+	terminate() {
+		return new Promise((resolve) => {
+			this.once("exit", resolve);
+			terminate(this.#id);
+		});
+	}
+
+	ref() {
+		setRef(this.#id, true);
+	}
+
+	unref() {
+		setRef(this.#id, false);
+	}
+}
+
+export { Worker, isMainThread, parentPort, threadId, workerData, resourceLimits };
+
+export default {
+	Worker,
+	isMainThread,
+	parentPort,
+	threadId,
+	workerData,
+	resourceLimits,
+};
@@ -0,0 +1,351 @@
+import { Buffer } from "buffer";
+import process from "process";
+import { Transform } from "stream";
+import { Zlib as NativeZlib } from "_node:zlib";
+
+const constants = {
+	Z_NO_FLUSH: 0,
+	Z_PARTIAL_FLUSH: 1,
+	Z_SYNC_FLUSH: 2,
+	Z_FULL_FLUSH: 3,
+	Z_FINISH: 4,
+	Z_BLOCK: 5,
+	Z_OK: 0,
+	Z_STREAM_END: 1,
+	Z_NEED_DICT: 2,
+	Z_ERRNO: -1,
+	Z_STREAM_ERROR: -2,
+	Z_DATA_ERROR: -3,
+	Z_MEM_ERROR: -4,
+	Z_BUF_ERROR: -5,
+	Z_VERSION_ERROR: -6,
+	Z_NO_COMPRESSION: 0,
+	Z_BEST_SPEED: 1,
+	Z_BEST_COMPRESSION: 9,
+	Z_DEFAULT_COMPRESSION: -1,
+	Z_FILTERED: 1,
+	Z_HUFFMAN_ONLY: 2,
+	Z_RLE: 3,
+	Z_FIXED: 4,
+	Z_DEFAULT_STRATEGY: 0,
+	ZLIB_VERNUM: 4784,
+	DEFLATE: 1,
+	INFLATE: 2,
+	GZIP: 3,
+	GUNZIP: 4,
+	DEFLATERAW: 5,
+	INFLATERAW: 6,
+	UNZIP: 7,
+	Z_MIN_WINDOWBITS: 8,
+	Z_MAX_WINDOWBITS: 15,
+	Z_DEFAULT_WINDOWBITS: 15,
+	Z_MIN_CHUNK: 64,
+	Z_MAX_CHUNK: Infinity,
+	Z_DEFAULT_CHUNK: 16 * 1024,
+	Z_MIN_MEMLEVEL: 1,
+	Z_MAX_MEMLEVEL: 9,
+	Z_DEFAULT_MEMLEVEL: 8,
+	Z_MIN_LEVEL: -1,
+	Z_MAX_LEVEL: 9,
+	Z_DEFAULT_LEVEL: -1,
+};
+Object.freeze(constants);
+
+const codes = {
+	Z_OK: 0,
+	Z_STREAM_END: 1,
+	Z_NEED_DICT: 2,
+	Z_ERRNO: -1,
+	Z_STREAM_ERROR: -2,
+	Z_DATA_ERROR: -3,
+	Z_MEM_ERROR: -4,
+	Z_BUF_ERROR: -5,
+	Z_VERSION_ERROR: -6,
+};
+for (const name of Object.keys(codes)) {
+	codes[codes[name]] = name;
+}
+Object.freeze(codes);
+
+function toView(buffer) {
+	if (typeof buffer === "string") return Buffer.from(buffer);
+	if (ArrayBuffer.isView(buffer)) return buffer;
+	if (buffer instanceof ArrayBuffer) return new Uint8Array(buffer);
+	const err = new TypeError(
+		'The "buffer" argument must be of type string or an instance of Buffer, TypedArray, DataView, or ArrayBuffer',
+	);
+	err.code = "ERR_INVALID_ARG_TYPE";
+	throw err;
+}
+
+function outOfRange(name, range, value) {
+	const err = new RangeError(`The value of "${name}" is out of range. It must be ${range}. Received ${value}`);
+	err.code = "ERR_OUT_OF_RANGE";
+	return err;
+}
+
+// Like node, undefined and NaN take the default.
+function checkRange(value, name, lower, upper, def) {
+	if (value === undefined || Number.isNaN(value)) return def;
+	if (typeof value !== "number") {
+		const err = new TypeError(`The "${name}" argument must be of type number. Received ${typeof value}`);
+		err.code = "ERR_INVALID_ARG_TYPE";
+		throw err;
+	}
+	if (!Number.isFinite(value)) throw outOfRange(name, "a finite number", value);
+	if (value < lower || value > upper) throw outOfRange(name, `>= ${lower} and <= ${upper}`, value);
+	return value;
+}
+
+function checkLevel(level, name) {
+	return checkRange(level, name, constants.Z_MIN_LEVEL, constants.Z_MAX_LEVEL, constants.Z_DEFAULT_COMPRESSION);
+}
+
+// Checks the options node checks, though only the level reaches flate2,
+// whose window and memory use are fixed.
+function levelOf(mode, opts) {
+	if (!opts) return constants.Z_DEFAULT_COMPRESSION;
+	const { windowBits, memLevel, strategy } = opts;
+	const decompress = mode === constants.INFLATE || mode === constants.GUNZIP || mode === constants.UNZIP;
+	// 0 lets a decompressor take the window size from the header
+	if (!(decompress && windowBits === 0)) {
+		checkRange(windowBits, "options.windowBits", constants.Z_MIN_WINDOWBITS, constants.Z_MAX_WINDOWBITS);
+	}
+	checkRange(memLevel, "options.memLevel", constants.Z_MIN_MEMLEVEL, constants.Z_MAX_MEMLEVEL);
+	checkRange(strategy, "options.strategy", constants.Z_DEFAULT_STRATEGY, constants.Z_FIXED);
+	return checkLevel(opts.level, "options.level");
+}
+
+// The whole stream runs in the native context, which hands back whatever
+// output each call produced.
+class ZlibBase extends Transform {
+	#mode;
+	#level;
+
+	constructor(mode, opts) {
+		super({ autoDestroy: true, ...opts });
+		this.#mode = mode;
+		this.#level = levelOf(mode, opts);
+		this._handle = new NativeZlib(mode, this.#level);
+		this.bytesWritten = 0;
+	}
+
+	#push(out) {
+		if (out.byteLength > 0) this.push(Buffer.from(out));
+	}
+
+	_transform(chunk, encoding, callback) {
+		try {
+			this.#push(this._handle.write(chunk.buffer, chunk.byteOffset, chunk.byteLength));
+		} catch (err) {
+			return callback(err);
+		}
+		this.bytesWritten += chunk.byteLength;
+		callback();
+	}
+
+	_flush(callback) {
+		try {
+			this.#push(this._handle.finish());
+		} catch (err) {
+			return callback(err);
+		}
+		callback();
+	}
+
+	// Flushes once everything written before has been compressed.
+	flush(kind, callback) {
+		if (typeof kind === "function") callback = kind;
+		if (this.writableFinished) {
+			if (callback) process.nextTick(callback);
+			return;
+		}
+		this.write(Buffer.alloc(0), () => {
+			try {
+				this.#push(this._handle.flush());
+			} catch (err) {
+				this.destroy(err);
+			}
+			if (callback) callback();
+		});
+	}
+
+	// flate2 can't change the level of a running stream, so the new one
+	// applies from the next reset().
+	params(level, strategy, callback) {
+		this.#level = checkLevel(level, "level");
+		checkRange(strategy, "strategy", constants.Z_DEFAULT_STRATEGY, constants.Z_FIXED);
+		this.flush(constants.Z_SYNC_FLUSH, callback);
+	}
+
+	reset() {
+		this._handle = new NativeZlib(this.#mode, this.#level);
+	}
+
+	close(callback) {
+		if (callback) process.nextTick(callback);
+		this.destroy();
+	}
+}
+
+class Deflate extends ZlibBase {
+	constructor(opts) {
+		super(constants.DEFLATE, opts);
+	}
+}
+
+class Inflate extends ZlibBase {
+	constructor(opts) {
+		super(constants.INFLATE, opts);
+	}
+}
+
+class Gzip extends ZlibBase {
+	constructor(opts) {
+		super(constants.GZIP, opts);
+	}
+}
+
+class Gunzip extends ZlibBase {
+	constructor(opts) {
+		super(constants.GUNZIP, opts);
+	}
+}
+
+class DeflateRaw extends ZlibBase {
+	constructor(opts) {
+		super(constants.DEFLATERAW, opts);
+	}
+}
+
+class InflateRaw extends ZlibBase {
+	constructor(opts) {
+		super(constants.INFLATERAW, opts);
+	}
+}
+
+class Unzip extends ZlibBase {
+	constructor(opts) {
+		super(constants.UNZIP, opts);
+	}
+}
+
+function zlibBufferSync(mode, buffer, opts) {
+	const view = toView(buffer);
+	const handle = new NativeZlib(mode, levelOf(mode, opts));
+	return Buffer.from(handle.finish(view.buffer, view.byteOffset, view.byteLength));
+}
+
+// node compresses on its thread pool, here the work runs on the next tick
+function zlibBuffer(mode, buffer, opts, callback) {
+	if (typeof opts === "function") {
+		callback = opts;
+		opts = {};
+	}
+	if (typeof callback !== "function") {
+		const err = new TypeError('The "callback" argument must be of type function');
+		err.code = "ERR_INVALID_ARG_TYPE";
+		throw err;
+	}
+	process.nextTick(() => {
+		let result;
+		try {
+			result = zlibBufferSync(mode, buffer, opts);
+		} catch (err) {
+			return callback(err);
+		}
+		callback(null, result);
+	});
+}
+
+const deflate = (buffer, opts, callback) => zlibBuffer(constants.DEFLATE, buffer, opts, callback);
+const inflate = (buffer, opts, callback) => zlibBuffer(constants.INFLATE, buffer, opts, callback);
+const gzip = (buffer, opts, callback) => zlibBuffer(constants.GZIP, buffer, opts, callback);
+const gunzip = (buffer, opts, callback) => zlibBuffer(constants.GUNZIP, buffer, opts, callback);
+const deflateRaw = (buffer, opts, callback) => zlibBuffer(constants.DEFLATERAW, buffer, opts, callback);
+const inflateRaw = (buffer, opts, callback) => zlibBuffer(constants.INFLATERAW, buffer, opts, callback);
+const unzip = (buffer, opts, callback) => zlibBuffer(constants.UNZIP, buffer, opts, callback);
+
+const deflateSync = (buffer, opts) => zlibBufferSync(constants.DEFLATE, buffer, opts);
+const inflateSync = (buffer, opts) => zlibBufferSync(constants.INFLATE, buffer, opts);
+const gzipSync = (buffer, opts) => zlibBufferSync(constants.GZIP, buffer, opts);
+const gunzipSync = (buffer, opts) => zlibBufferSync(constants.GUNZIP, buffer, opts);
+const deflateRawSync = (buffer, opts) => zlibBufferSync(constants.DEFLATERAW, buffer, opts);
+const inflateRawSync = (buffer, opts) => zlibBufferSync(constants.INFLATERAW, buffer, opts);
+const unzipSync = (buffer, opts) => zlibBufferSync(constants.UNZIP, buffer, opts);
+
+const createDeflate = (opts) => new Deflate(opts);
+const createInflate = (opts) => new Inflate(opts);
+const createGzip = (opts) => new Gzip(opts);
+const createGunzip = (opts) => new Gunzip(opts);
+const createDeflateRaw = (opts) => new DeflateRaw(opts);
+const createInflateRaw = (opts) => new InflateRaw(opts);
+const createUnzip = (opts) => new Unzip(opts);
+
+export {
+	constants,
+	codes,
+	Deflate,
+	Inflate,
+	Gzip,
+	Gunzip,
+	DeflateRaw,
+	InflateRaw,
+	Unzip,
+	deflate,
+	inflate,
+	gzip,
+	gunzip,
+	deflateRaw,
+	inflateRaw,
+	unzip,
+	deflateSync,
+	inflateSync,
+	gzipSync,
+	gunzipSync,
+	deflateRawSync,
+	inflateRawSync,
+	unzipSync,
+	createDeflate,
+	createInflate,
+	createGzip,
+	createGunzip,
+	createDeflateRaw,
+	createInflateRaw,
+	createUnzip,
+};
+
+export default {
+	// the legacy top level Z_* constants
+	...constants,
+	constants,
+	codes,
+	Deflate,
+	Inflate,
+	Gzip,
+	Gunzip,
+	DeflateRaw,
+	InflateRaw,
+	Unzip,
+	deflate,
+	inflate,
+	gzip,
+	gunzip,
+	deflateRaw,
+	inflateRaw,
+	unzip,
+	deflateSync,
+	inflateSync,
+	gzipSync,
+	gunzipSync,
+	deflateRawSync,
+	inflateRawSync,
+	unzipSync,
+	createDeflate,
+	createInflate,
+	createGzip,
+	createGunzip,
+	createDeflateRaw,
+	createInflateRaw,
+	createUnzip,
+};
@@ -0,0 +1,637 @@
+// Codecs behind buffer.js. Every function takes the Buffer's backing
+// ArrayBuffer plus byteOffset/byteLength, so it works in place on any
+// view, and strings are read from and created in QuickJS's own Latin1 or
+// UTF-16 storage.
+
+use super::utf8;
+use crate::quickjs_sys::*;
+use memchr::memmem;
+use std::borrow::Cow;
+
+const BASE64: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const BASE64_URL: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+const HEX: &[u8; 16] = b"0123456789abcdef";
+const INVALID: u8 = 0xFF;
+
+/// Sextet of a base64 character, both alphabets accepted like node does.
+const BASE64_DECODE: [u8; 256] = {
+    let mut table = [INVALID; 256];
+    let mut i = 0;
+    while i < 64 {
+        table[BASE64[i] as usize] = i as u8;
+        table[BASE64_URL[i] as usize] = i as u8;
+        i += 1;
+    }
+    table
+};
+
+const HEX_DECODE: [u8; 256] = {
+    let mut table = [INVALID; 256];
+    let mut i = 0;
+    while i < 16 {
+        table[HEX[i] as usize] = i as u8;
+        table[HEX[i].to_ascii_uppercase() as usize] = i as u8;
+        i += 1;
+    }
+    table
+};
+
+/// A code unit of a JS string, Latin1 or UTF-16.
+trait Unit: Copy {
+    fn code(self) -> u32;
+
+    /// Entry of a byte indexed table, `INVALID` outside of Latin1.
+    #[inline]
+    fn lookup(self, table: &[u8; 256]) -> u8 {
+        match self.code() {
+            c @ 0..=0xFF => table[c as usize],
+            _ => INVALID,
+        }
+    }
+}
+
+impl Unit for u8 {
+    #[inline]
+    fn code(self) -> u32 {
+        self as u32
+    }
+}
+
+impl Unit for u16 {
+    #[inline]
+    fn code(self) -> u32 {
+        self as u32
+    }
+}
+
+pub fn base64_encoded_len(len: usize, url: bool) -> usize {
+    if url {
+        (len * 4 + 2) / 3
+    } else {
+        (len + 2) / 3 * 4
+    }
+}
+
+/// Encodes `src` into `dst`, which is `base64_encoded_len` long. The url
+/// alphabet goes without padding, as in node.
+pub fn base64_encode(src: &[u8], dst: &mut [u8], url: bool) {
+    let alphabet = if url { BASE64_URL } else { BASE64 };
+    let mut chunks = src.chunks_exact(3);
+    for (s, d) in (&mut chunks).zip(dst.chunks_exact_mut(4)) {
+        let n = (s[0] as u32) << 16 | (s[1] as u32) << 8 | s[2] as u32;
+        d[0] = alphabet[(n >> 18) as usize & 63];
+        d[1] = alphabet[(n >> 12) as usize & 63];
+        d[2] = alphabet[(n >> 6) as usize & 63];
+        d[3] = alphabet[n as usize & 63];
+    }
+    let rest = chunks.remainder();
+    if rest.is_empty() {
+        return;
+    }
+    let d = &mut dst[src.len() / 3 * 4..];
+    let n = (rest[0] as u32) << 16 | (*rest.get(1).unwrap_or(&0) as u32) << 8;
+    d[0] = alphabet[(n >> 18) as usize & 63];
+    d[1] = alphabet[(n >> 12) as usize & 63];
+    if rest.len() == 2 {
+        d[2] = alphabet[(n >> 6) as usize & 63];
+    } else if !url {
+        d[2] = b'=';
+    }
+    if !url {
+        d[3] = b'=';
+    }
+}
+
+/// Bytes `base64_decode` produces for `src`: characters outside the
+/// alphabet are skipped and the first '=' ends the data.
+fn base64_decoded_len<T: Unit>(src: &[T]) -> usize {
+    let mut n = 0;
+    for &u in src {
+        if u.code() == b'=' as u32 {
+            break;
+        }
+        if u.lookup(&BASE64_DECODE) != INVALID {
+            n += 1;
+        }
+    }
+    n * 6 / 8
+}
+
+/// Decodes as much of `src` as fits in `dst`, returns the bytes written.
+/// Whole quads of alphabet characters take the fast path, whitespace and
+/// other junk drop to a per character loop until the next quad boundary.
+fn base64_decode<T: Unit>(src: &[T], dst: &mut [u8]) -> usize {
+    let (mut i, mut written) = (0, 0);
+    let (mut acc, mut bits) = (0u32, 0u32);
+    loop {
+        if bits == 0 {
+            while i + 4 <= src.len() && written + 3 <= dst.len() {
+                let a = src[i].lookup(&BASE64_DECODE);
+                let b = src[i + 1].lookup(&BASE64_DECODE);
+                let c = src[i + 2].lookup(&BASE64_DECODE);
+                let d = src[i + 3].lookup(&BASE64_DECODE);
+                if (a | b | c | d) & 0x80 != 0 {
+                    break;
+                }
+                let n = (a as u32) << 18 | (b as u32) << 12 | (c as u32) << 6 | d as u32;
+                dst[written] = (n >> 16) as u8;
+                dst[written + 1] = (n >> 8) as u8;
+                dst[written + 2] = n as u8;
+                i += 4;
+                written += 3;
+            }
+        }
+        if i == src.len() || written == dst.len() {
+            break;
+        }
+        let u = src[i];
+        i += 1;
+        if u.code() == b'=' as u32 {
+            break;
+        }
+        let v = u.lookup(&BASE64_DECODE);
+        if v == INVALID {
+            continue;
+        }
+        acc = acc << 6 | v as u32;
+        bits += 6;
+        if bits >= 8 {
+            bits -= 8;
+            dst[written] = (acc >> bits) as u8;
+            written += 1;
+            acc &= (1 << bits) - 1;
+        }
+    }
+    written
+}
+
+#[cfg(target_feature = "simd128")]
+fn hex_encode(src: &[u8], dst: &mut [u8]) {
+    use core::arch::wasm32::*;
+    let mut i = 0;
+    unsafe {
+        let table = v128_load(HEX.as_ptr() as *const v128);
+        let low = u8x16_splat(0x0F);
+        while i + 16 <= src.len() {
+            let v = v128_load(src.as_ptr().add(i) as *const v128);
+            let hi = u8x16_swizzle(table, u8x16_shr(v, 4));
+            let lo = u8x16_swizzle(table, v128_and(v, low));
+            let first =
+                i8x16_shuffle::<0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23>(hi, lo);
+            let second =
+                i8x16_shuffle::<8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31>(
+                    hi, lo,
+                );
+            v128_store(dst.as_mut_ptr().add(i * 2) as *mut v128, first);
+            v128_store(dst.as_mut_ptr().add(i * 2 + 16) as *mut v128, second);
+            i += 16;
+        }
+    }
+    hex_encode_scalar(&src[i..], &mut dst[i * 2..]);
+}
+
+#[cfg(not(target_feature = "simd128"))]
+fn hex_encode(src: &[u8], dst: &mut [u8]) {
+    hex_encode_scalar(src, dst)
+}
+
+fn hex_encode_scalar(src: &[u8], dst: &mut [u8]) {
+    for (b, d) in src.iter().zip(dst.chunks_exact_mut(2)) {
+        d[0] = HEX[(b >> 4) as usize];
+        d[1] = HEX[(b & 0x0F) as usize];
+    }
+}
+
+/// Decodes hex pairs into `dst` up to the first invalid one, returns the
+/// bytes written.
+fn hex_decode<T: Unit>(src: &[T], dst: &mut [u8]) -> usize {
+    let mut written = 0;
+    for (pair, d) in src.chunks_exact(2).zip(dst.iter_mut()) {
+        let hi = pair[0].lookup(&HEX_DECODE);
+        let lo = pair[1].lookup(&HEX_DECODE);
+        if (hi | lo) & 0x80 != 0 {
+            break;
+        }
+        *d = hi << 4 | lo;
+        written += 1;
+    }
+    written
+}
+
+fn usize_arg(argv: &[JsValue], i: usize) -> usize {
+    match argv.get(i) {
+        Some(JsValue::Int(n)) => (*n).max(0) as usize,
+        Some(JsValue::Float(n)) if *n > 0.0 => *n as usize,
+        _ => 0,
+    }
+}
+
+/// The `(arrayBuffer, byteOffset, byteLength)` arguments starting at `i`,
+/// clamped to the buffer.
+fn raw_bytes_arg(argv: &[JsValue], i: usize) -> (*mut u8, usize) {
+    let (ptr, len) = match argv.get(i) {
+        Some(JsValue::ArrayBuffer(buf)) => buf.get_mut_ptr(),
+        _ => return (std::ptr::NonNull::dangling().as_ptr(), 0),
+    };
+    if ptr.is_null() {
+        // detached
+        return (std::ptr::NonNull::dangling().as_ptr(), 0);
+    }
+    let start = usize_arg(argv, i + 1).min(len);
+    let n = usize_arg(argv, i + 2).min(len - start);
+    unsafe { (ptr.add(start), n) }
+}
+
+pub(crate) fn bytes_arg(argv: &[JsValue], i: usize) -> &mut [u8] {
+    let (ptr, len) = raw_bytes_arg(argv, i);
+    unsafe { std::slice::from_raw_parts_mut(ptr, len) }
+}
+
+/// Like `bytes_arg`, for views that may alias each other.
+pub(crate) fn bytes_ref_arg(argv: &[JsValue], i: usize) -> &[u8] {
+    let (ptr, len) = raw_bytes_arg(argv, i);
+    unsafe { std::slice::from_raw_parts(ptr, len) }
+}
+
+fn string_arg(ctx: &mut Context, argv: &[JsValue], i: usize) -> Option<JsString> {
+    match argv.get(i).map(|v| ctx.value_to_string(v)) {
+        Some(JsValue::String(s)) => Some(s),
+        _ => None,
+    }
+}
+
+fn base64_slice(ctx: &mut Context, argv: &[JsValue], url: bool) -> JsValue {
+    let src = bytes_arg(argv, 0);
+    let mut out = vec![0; base64_encoded_len(src.len(), url)];
+    base64_encode(src, &mut out, url);
+    ctx.new_string_latin1(&out)
+}
+
+fn base64_slice_fn(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    base64_slice(ctx, argv, false)
+}
+
+fn base64url_slice_fn(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    base64_slice(ctx, argv, true)
+}
+
+fn hex_slice(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let src = bytes_arg(argv, 0);
+    let mut out = vec![0; src.len() * 2];
+    hex_encode(src, &mut out);
+    ctx.new_string_latin1(&out)
+}
+
+fn latin1_slice(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    ctx.new_string_latin1(bytes_arg(argv, 0))
+}
+
+fn ascii_slice(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let src = bytes_arg(argv, 0);
+    if utf8::ascii_prefix(src) == src.len() {
+        return ctx.new_string_latin1(src);
+    }
+    let out: Vec<u8> = src.iter().map(|b| b & 0x7F).collect();
+    ctx.new_string_latin1(&out)
+}
+
+fn ucs2_slice(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    // an odd trailing byte is dropped
+    let units: Vec<u16> = bytes_arg(argv, 0)
+        .chunks_exact(2)
+        .map(|c| u16::from_le_bytes([c[0], c[1]]))
+        .collect();
+    ctx.new_string_utf16(&units)
+}
+
+fn utf8_slice(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    super::encoding::decode_utf8(ctx, bytes_arg(argv, 0), false, true)
+}
+
+/// `xxxWrite(arrayBuffer, byteOffset, maxLength, string)`, returns the
+/// number of bytes written.
+fn write_with(
+    ctx: &mut Context,
+    argv: &[JsValue],
+    f: impl FnOnce(JsStringData, &mut [u8]) -> usize,
+) -> JsValue {
+    let s = match string_arg(ctx, argv, 3) {
+        Some(s) => s,
+        None => return ctx.throw_type_error("argument must be a string").into(),
+    };
+    let written = f(s.data(), bytes_arg(argv, 0));
+    JsValue::Int(written as i32)
+}
+
+fn base64_write(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    write_with(ctx, argv, |s, dst| match s {
+        JsStringData::Latin1(src) => base64_decode(src, dst),
+        JsStringData::Utf16(src) => base64_decode(src, dst),
+    })
+}
+
+fn hex_write(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    write_with(ctx, argv, |s, dst| match s {
+        JsStringData::Latin1(src) => hex_decode(src, dst),
+        JsStringData::Utf16(src) => hex_decode(src, dst),
+    })
+}
+
+/// latin1, binary and ascii writes alike keep the low byte of each unit.
+fn latin1_write(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    write_with(ctx, argv, |s, dst| match s {
+        JsStringData::Latin1(src) => {
+            let n = src.len().min(dst.len());
+            dst[..n].copy_from_slice(&src[..n]);
+            n
+        }
+        JsStringData::Utf16(src) => {
+            let n = src.len().min(dst.len());
+            for (d, u) in dst.iter_mut().zip(src) {
+                *d = *u as u8;
+            }
+            n
+        }
+    })
+}
+
+fn ucs2_write(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    write_with(ctx, argv, |s, dst| {
+        let mut written = 0;
+        let mut put = |u: u16, d: &mut [u8]| {
+            d.copy_from_slice(&u.to_le_bytes());
+            written += 2;
+        };
+        match s {
+            JsStringData::Latin1(src) => {
+                for (u, d) in src.iter().zip(dst.chunks_exact_mut(2)) {
+                    put(*u as u16, d);
+                }
+            }
+            JsStringData::Utf16(src) => {
+                for (u, d) in src.iter().zip(dst.chunks_exact_mut(2)) {
+                    put(*u, d);
+                }
+            }
+        }
+        written
+    })
+}
+
+/// Never splits a character, like node.
+fn utf8_write(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    write_with(ctx, argv, |s, dst| match s {
+        JsStringData::Latin1(src) => utf8::latin1_to_utf8(src, dst).1,
+        JsStringData::Utf16(src) => utf8::utf16_to_utf8(src, dst).1,
+    })
+}
+
+fn byte_length_utf8(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let len = match string_arg(ctx, argv, 0) {
+        Some(s) => match s.data() {
+            JsStringData::Latin1(src) => utf8::latin1_utf8_len(src),
+            JsStringData::Utf16(src) => utf8::utf16_utf8_len(src),
+        },
+        None => 0,
+    };
+    JsValue::Int(len as i32)
+}
+
+fn byte_length_base64(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let len = match string_arg(ctx, argv, 0) {
+        Some(s) => match s.data() {
+            JsStringData::Latin1(src) => base64_decoded_len(src),
+            JsStringData::Utf16(src) => base64_decoded_len(src),
+        },
+        None => 0,
+    };
+    JsValue::Int(len as i32)
+}
+
+fn index_result(i: Option<usize>) -> JsValue {
+    match i {
+        Some(i) => JsValue::Int(i as i32),
+        None => JsValue::Int(-1),
+    }
+}
+
+fn dir_arg(argv: &[JsValue], i: usize) -> bool {
+    !matches!(argv.get(i), Some(JsValue::Bool(false)))
+}
+
+/// First match at or after `from` (`forward`), or last match starting at
+/// or before it. ucs2 searches only accept matches on code unit
+/// boundaries.
+fn search(hay: &[u8], needle: &[u8], from: usize, forward: bool, ucs2: bool) -> Option<usize> {
+    if needle.is_empty() || needle.len() > hay.len() || (ucs2 && needle.len() < 2) {
+        return None;
+    }
+    if needle.len() == 1 && !ucs2 {
+        return if forward {
+            memchr::memchr(needle[0], hay.get(from..)?).map(|i| i + from)
+        } else {
+            memchr::memrchr(needle[0], &hay[..hay.len().min(from + 1)])
+        };
+    }
+    if forward {
+        let finder = memmem::Finder::new(needle);
+        let mut pos = from;
+        while let Some(i) = finder.find(hay.get(pos..)?) {
+            let at = pos + i;
+            if !ucs2 || at % 2 == 0 {
+                return Some(at);
+            }
+            pos = at + 1;
+        }
+        None
+    } else {
+        let finder = memmem::FinderRev::new(needle);
+        let mut end = hay.len().min(from.saturating_add(needle.len()));
+        while let Some(at) = finder.rfind(&hay[..end]) {
+            if !ucs2 || at % 2 == 0 {
+                return Some(at);
+            }
+            end = at + needle.len() - 1;
+        }
+        None
+    }
+}
+
+/// `indexOfNumber(arrayBuffer, byteOffset, length, byte, from, forward)`
+fn index_of_number(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let needle = [usize_arg(argv, 3) as u8];
+    let from = usize_arg(argv, 4);
+    index_result(search(
+        bytes_ref_arg(argv, 0),
+        &needle,
+        from,
+        dir_arg(argv, 5),
+        false,
+    ))
+}
+
+/// `indexOfBuffer(arrayBuffer, byteOffset, length, needleBuffer,
+/// needleOffset, needleLength, from, forward, ucs2)`
+fn index_of_buffer(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let hay = bytes_ref_arg(argv, 0);
+    let needle = bytes_ref_arg(argv, 3);
+    let ucs2 = matches!(argv.get(8), Some(JsValue::Bool(true)));
+    index_result(search(
+        hay,
+        needle,
+        usize_arg(argv, 6),
+        dir_arg(argv, 7),
+        ucs2,
+    ))
+}
+
+/// `indexOfString(arrayBuffer, byteOffset, length, string, from, forward)`
+/// searches for the UTF-8 form of `string`, ASCII strings are used as is.
+fn index_of_string(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let s = match string_arg(ctx, argv, 3) {
+        Some(s) => s,
+        None => return ctx.throw_type_error("argument must be a string").into(),
+    };
+    let needle: Cow<[u8]> = match s.data() {
+        JsStringData::Latin1(src) if utf8::ascii_prefix(src) == src.len() => Cow::Borrowed(src),
+        JsStringData::Latin1(src) => {
+            let mut out = vec![0; utf8::latin1_utf8_len(src)];
+            utf8::latin1_to_utf8(src, &mut out);
+            Cow::Owned(out)
+        }
+        JsStringData::Utf16(src) => {
+            let mut out = vec![0; utf8::utf16_utf8_len(src)];
+            utf8::utf16_to_utf8(src, &mut out);
+            Cow::Owned(out)
+        }
+    };
+    let hay = bytes_ref_arg(argv, 0);
+    index_result(search(
+        hay,
+        &needle,
+        usize_arg(argv, 4),
+        dir_arg(argv, 5),
+        false,
+    ))
+}
+
+/// `compare(a, aOffset, aLength, b, bOffset, bLength)`, -1, 0 or 1 in
+/// memcmp order.
+fn compare(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let a = bytes_ref_arg(argv, 0);
+    let b = bytes_ref_arg(argv, 3);
+    JsValue::Int(a.cmp(b) as i32)
+}
+
+/// `copy(source, sourceOffset, sourceLength, target, targetOffset,
+/// targetLength)`, a memmove of as much as fits, returns the bytes copied.
+fn copy(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (src, src_len) = raw_bytes_arg(argv, 0);
+    let (dst, dst_len) = raw_bytes_arg(argv, 3);
+    let n = src_len.min(dst_len);
+    // source and target may be views of the same memory
+    unsafe { std::ptr::copy(src, dst, n) };
+    JsValue::Int(n as i32)
+}
+
+/// `fill(arrayBuffer, byteOffset, length, byte)` or
+/// `fill(arrayBuffer, byteOffset, length, pattern, patternOffset,
+/// patternLength)`.
+fn fill(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    if let Some(JsValue::ArrayBuffer(_)) = argv.get(3) {
+        // the pattern may be a view of the target
+        let pattern = bytes_ref_arg(argv, 3).to_vec();
+        let dst = bytes_arg(argv, 0);
+        if pattern.is_empty() || dst.is_empty() {
+            return JsValue::UnDefined;
+        }
+        let first = pattern.len().min(dst.len());
+        dst[..first].copy_from_slice(&pattern[..first]);
+        // double the filled prefix until the target is full
+        let mut filled = first;
+        while filled < dst.len() {
+            let n = filled.min(dst.len() - filled);
+            dst.copy_within(..n, filled);
+            filled += n;
+        }
+    } else {
+        bytes_arg(argv, 0).fill(usize_arg(argv, 3) as u8);
+    }
+    JsValue::UnDefined
+}
+
+struct BufferModule;
+
+impl ModuleInit for BufferModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("base64Slice", base64_slice_fn);
+        m.add_export("base64Slice\0", f.into());
+        let f = ctx.wrap_function("base64urlSlice", base64url_slice_fn);
+        m.add_export("base64urlSlice\0", f.into());
+        let f = ctx.wrap_function("hexSlice", hex_slice);
+        m.add_export("hexSlice\0", f.into());
+        let f = ctx.wrap_function("latin1Slice", latin1_slice);
+        m.add_export("latin1Slice\0", f.into());
+        let f = ctx.wrap_function("asciiSlice", ascii_slice);
+        m.add_export("asciiSlice\0", f.into());
+        let f = ctx.wrap_function("ucs2Slice", ucs2_slice);
+        m.add_export("ucs2Slice\0", f.into());
+        let f = ctx.wrap_function("utf8Slice", utf8_slice);
+        m.add_export("utf8Slice\0", f.into());
+        let f = ctx.wrap_function("base64Write", base64_write);
+        m.add_export("base64Write\0", f.into());
+        let f = ctx.wrap_function("hexWrite", hex_write);
+        m.add_export("hexWrite\0", f.into());
+        let f = ctx.wrap_function("latin1Write", latin1_write);
+        m.add_export("latin1Write\0", f.into());
+        let f = ctx.wrap_function("ucs2Write", ucs2_write);
+        m.add_export("ucs2Write\0", f.into());
+        let f = ctx.wrap_function("utf8Write", utf8_write);
+        m.add_export("utf8Write\0", f.into());
+        let f = ctx.wrap_function("byteLengthUtf8", byte_length_utf8);
+        m.add_export("byteLengthUtf8\0", f.into());
+        let f = ctx.wrap_function("byteLengthBase64", byte_length_base64);
+        m.add_export("byteLengthBase64\0", f.into());
+        let f = ctx.wrap_function("indexOfNumber", index_of_number);
+        m.add_export("indexOfNumber\0", f.into());
+        let f = ctx.wrap_function("indexOfBuffer", index_of_buffer);
+        m.add_export("indexOfBuffer\0", f.into());
+        let f = ctx.wrap_function("indexOfString", index_of_string);
+        m.add_export("indexOfString\0", f.into());
+        let f = ctx.wrap_function("compare", compare);
+        m.add_export("compare\0", f.into());
+        let f = ctx.wrap_function("copy", copy);
+        m.add_export("copy\0", f.into());
+        let f = ctx.wrap_function("fill", fill);
+        m.add_export("fill\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:buffer\0",
+        BufferModule,
+        &[
+            "base64Slice\0",
+            "base64urlSlice\0",
+            "hexSlice\0",
+            "latin1Slice\0",
+            "asciiSlice\0",
+            "ucs2Slice\0",
+            "utf8Slice\0",
+            "base64Write\0",
+            "hexWrite\0",
+            "latin1Write\0",
+            "ucs2Write\0",
+            "utf8Write\0",
+            "byteLengthUtf8\0",
+            "byteLengthBase64\0",
+            "indexOfNumber\0",
+            "indexOfBuffer\0",
+            "indexOfString\0",
+            "compare\0",
+            "copy\0",
+            "fill\0",
+        ],
+    )
+}
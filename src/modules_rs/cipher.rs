@@ -0,0 +1,640 @@
+// Symmetric ciphers behind crypto.createCipheriv and
+// crypto.createDecipheriv, exported by `_node:crypto`. A Cipher object
+// streams its input through one of the modes below and hands back the
+// output of every call in a new ArrayBuffer. GCM and ChaCha20-Poly1305
+// are put together from their stream cipher and universal hash so that
+// `update` can return output as it goes, like OpenSSL does. The RustCrypto
+// AES and ChaCha20 used here have no secret dependent branches or lookups.
+
+use super::buffer::bytes_ref_arg;
+use crate::quickjs_sys::*;
+use aes::{Aes128, Aes192, Aes256};
+use chacha20::ChaCha20;
+use cipher::consts::U16;
+use cipher::generic_array::GenericArray;
+use cipher::{
+    BlockCipher, BlockDecryptMut, BlockEncrypt, BlockEncryptMut, BlockSizeUser, InnerIvInit,
+    KeyInit, KeyIvInit, StreamCipher, StreamCipherSeek,
+};
+use ghash::GHash;
+use poly1305::universal_hash::UniversalHash;
+use poly1305::Poly1305;
+
+/// Algorithms with a native implementation, by their OpenSSL names.
+pub const CIPHERS: &[&str] = &[
+    "aes-128-cbc",
+    "aes-192-cbc",
+    "aes-256-cbc",
+    "aes-128-ctr",
+    "aes-192-ctr",
+    "aes-256-ctr",
+    "aes-128-gcm",
+    "aes-192-gcm",
+    "aes-256-gcm",
+    "chacha20-poly1305",
+];
+
+enum CipherError {
+    KeyLength,
+    Iv,
+    TagLength,
+}
+
+trait Mode {
+    fn update(&mut self, input: &[u8], out: &mut Vec<u8>);
+    /// Appends the last of the output, an error means a bad final block
+    /// or a failed authentication.
+    fn finish(&mut self, out: &mut Vec<u8>) -> Result<(), &'static str>;
+
+    fn set_auto_padding(&mut self, _padding: bool) -> bool {
+        false
+    }
+
+    fn set_aad(&mut self, _aad: &[u8]) -> bool {
+        false
+    }
+
+    fn auth_tag(&self) -> Option<&[u8]> {
+        None
+    }
+
+    fn set_auth_tag(&mut self, _tag: &[u8]) -> bool {
+        false
+    }
+}
+
+/// CTR, the keystream applied over a copy of the input.
+struct Stream<S: StreamCipher>(S);
+
+impl<S: StreamCipher> Mode for Stream<S> {
+    fn update(&mut self, input: &[u8], out: &mut Vec<u8>) {
+        let start = out.len();
+        out.extend_from_slice(input);
+        self.0.apply_keystream(&mut out[start..]);
+    }
+
+    fn finish(&mut self, _out: &mut Vec<u8>) -> Result<(), &'static str> {
+        Ok(())
+    }
+}
+
+/// One direction of a 16 byte block mode.
+trait Blocks {
+    const DECRYPT: bool;
+    fn process(&mut self, blocks: &mut [u8]);
+}
+
+struct Encrypt<M>(M);
+struct Decrypt<M>(M);
+
+impl<M: BlockEncryptMut + BlockSizeUser<BlockSize = U16>> Blocks for Encrypt<M> {
+    const DECRYPT: bool = false;
+
+    fn process(&mut self, blocks: &mut [u8]) {
+        for block in blocks.chunks_exact_mut(16) {
+            self.0
+                .encrypt_block_mut(GenericArray::from_mut_slice(block));
+        }
+    }
+}
+
+impl<M: BlockDecryptMut + BlockSizeUser<BlockSize = U16>> Blocks for Decrypt<M> {
+    const DECRYPT: bool = true;
+
+    fn process(&mut self, blocks: &mut [u8]) {
+        for block in blocks.chunks_exact_mut(16) {
+            self.0
+                .decrypt_block_mut(GenericArray::from_mut_slice(block));
+        }
+    }
+}
+
+/// CBC with PKCS#7 padding unless turned off. Decryption holds the last
+/// full block back until `finish`, where its padding is stripped.
+struct Cbc<B: Blocks> {
+    blocks: B,
+    padding: bool,
+    pending: Vec<u8>,
+}
+
+impl<B: Blocks> Cbc<B> {
+    fn new(blocks: B) -> Self {
+        Cbc {
+            blocks,
+            padding: true,
+            pending: Vec::with_capacity(16),
+        }
+    }
+}
+
+/// Length of the PKCS#7 padding ending `block`, or 0 when it is not valid.
+/// Looks at every byte whatever their values.
+fn pkcs7_len(block: &[u8]) -> usize {
+    if block.len() != 16 {
+        return 0;
+    }
+    let n = block[15];
+    let mut bad = (n == 0 || n > 16) as u8;
+    for (i, b) in block.iter().enumerate() {
+        let in_pad = ((16 - i) as u8 <= n) as u8;
+        bad |= in_pad & (*b != n) as u8;
+    }
+    if bad == 0 {
+        n as usize
+    } else {
+        0
+    }
+}
+
+impl<B: Blocks> Mode for Cbc<B> {
+    fn update(&mut self, input: &[u8], out: &mut Vec<u8>) {
+        let total = self.pending.len() + input.len();
+        let mut n = total / 16 * 16;
+        if B::DECRYPT && self.padding && n == total {
+            n = n.saturating_sub(16);
+        }
+        if n == 0 {
+            self.pending.extend_from_slice(input);
+            return;
+        }
+        let start = out.len();
+        let taken = n - self.pending.len();
+        out.extend_from_slice(&self.pending);
+        out.extend_from_slice(&input[..taken]);
+        self.blocks.process(&mut out[start..]);
+        self.pending.clear();
+        self.pending.extend_from_slice(&input[taken..]);
+    }
+
+    fn finish(&mut self, out: &mut Vec<u8>) -> Result<(), &'static str> {
+        let mut last = std::mem::take(&mut self.pending);
+        if !B::DECRYPT && self.padding {
+            let pad = 16 - last.len();
+            last.resize(16, pad as u8);
+        }
+        // decryption with padding always holds back one whole block
+        let padded = B::DECRYPT && self.padding;
+        if last.len() % 16 != 0 || (padded && last.len() != 16) {
+            return Err("wrong final block length");
+        }
+        self.blocks.process(&mut last);
+        if padded {
+            match pkcs7_len(&last) {
+                0 => return Err("bad decrypt"),
+                pad => last.truncate(16 - pad),
+            }
+        }
+        out.append(&mut last);
+        Ok(())
+    }
+
+    fn set_auto_padding(&mut self, padding: bool) -> bool {
+        self.padding = padding;
+        true
+    }
+}
+
+/// A universal hash fed bytes at a time, zero padded to the block where
+/// the AEAD construction asks for it.
+struct MacStream<U: UniversalHash<BlockSize = U16>> {
+    mac: U,
+    buf: [u8; 16],
+    len: usize,
+}
+
+impl<U: UniversalHash<BlockSize = U16>> MacStream<U> {
+    fn new(mac: U) -> Self {
+        MacStream {
+            mac,
+            buf: [0; 16],
+            len: 0,
+        }
+    }
+
+    fn feed(&mut self, mut data: &[u8]) {
+        if self.len > 0 {
+            let n = data.len().min(16 - self.len);
+            self.buf[self.len..self.len + n].copy_from_slice(&data[..n]);
+            self.len += n;
+            data = &data[n..];
+            if self.len < 16 {
+                return;
+            }
+            self.mac.update_padded(&self.buf);
+            self.len = 0;
+        }
+        let whole = data.len() / 16 * 16;
+        self.mac.update_padded(&data[..whole]);
+        let rest = &data[whole..];
+        self.buf[..rest.len()].copy_from_slice(rest);
+        self.len = rest.len();
+    }
+
+    fn pad(&mut self) {
+        self.mac.update_padded(&self.buf[..self.len]);
+        self.len = 0;
+    }
+}
+
+/// GCM (SP 800-38D) and ChaCha20-Poly1305 (RFC 8439): a stream cipher for
+/// the data and a universal hash over AAD and ciphertext.
+struct Aead<S: StreamCipher, U: UniversalHash<BlockSize = U16>> {
+    stream: S,
+    mac: Option<MacStream<U>>,
+    decrypt: bool,
+    // XORed into the hash for GCM's tag, zeros for Poly1305
+    tag_mask: [u8; 16],
+    lengths: fn(u64, u64) -> [u8; 16],
+    started: bool,
+    aad_len: u64,
+    text_len: u64,
+    tag_len: usize,
+    tag: Option<Vec<u8>>,
+}
+
+impl<S: StreamCipher, U: UniversalHash<BlockSize = U16>> Aead<S, U> {
+    /// Pads the AAD before the first of the data.
+    fn start_text(&mut self) {
+        if let (Some(mac), false) = (&mut self.mac, self.started) {
+            mac.pad();
+        }
+        self.started = true;
+    }
+}
+
+impl<S: StreamCipher, U: UniversalHash<BlockSize = U16>> Mode for Aead<S, U> {
+    fn update(&mut self, input: &[u8], out: &mut Vec<u8>) {
+        self.start_text();
+        let mac = match &mut self.mac {
+            Some(mac) => mac,
+            None => return,
+        };
+        let start = out.len();
+        out.extend_from_slice(input);
+        if self.decrypt {
+            mac.feed(input);
+            self.stream.apply_keystream(&mut out[start..]);
+        } else {
+            self.stream.apply_keystream(&mut out[start..]);
+            mac.feed(&out[start..]);
+        }
+        self.text_len += input.len() as u64;
+    }
+
+    fn finish(&mut self, _out: &mut Vec<u8>) -> Result<(), &'static str> {
+        self.start_text();
+        let mut mac = match self.mac.take() {
+            Some(mac) => mac,
+            None => return Err("Unsupported state"),
+        };
+        mac.pad();
+        mac.feed(&(self.lengths)(self.aad_len, self.text_len));
+        let mut tag = mac.mac.finalize();
+        for (t, m) in tag.iter_mut().zip(&self.tag_mask) {
+            *t ^= m;
+        }
+        if !self.decrypt {
+            self.tag = Some(tag[..self.tag_len].to_vec());
+            return Ok(());
+        }
+        let expected = match &self.tag {
+            Some(expected) => expected,
+            None => return Err("Unsupported state or unable to authenticate data"),
+        };
+        let diff = expected
+            .iter()
+            .zip(tag.iter())
+            .fold(0, |d, (a, b)| d | (a ^ b));
+        if diff == 0 {
+            Ok(())
+        } else {
+            Err("Unsupported state or unable to authenticate data")
+        }
+    }
+
+    fn set_aad(&mut self, aad: &[u8]) -> bool {
+        match &mut self.mac {
+            Some(mac) if !self.started => {
+                mac.feed(aad);
+                self.aad_len += aad.len() as u64;
+                true
+            }
+            _ => false,
+        }
+    }
+
+    fn auth_tag(&self) -> Option<&[u8]> {
+        match (&self.tag, self.decrypt) {
+            (Some(tag), false) => Some(tag),
+            _ => None,
+        }
+    }
+
+    fn set_auth_tag(&mut self, tag: &[u8]) -> bool {
+        if !self.decrypt || self.mac.is_none() || !valid_tag_len(tag.len()) {
+            return false;
+        }
+        self.tag = Some(tag.to_vec());
+        true
+    }
+}
+
+/// Tag lengths OpenSSL accepts for GCM, Poly1305 takes the same ones here.
+fn valid_tag_len(len: usize) -> bool {
+    matches!(len, 4 | 8 | 12..=16)
+}
+
+fn gcm_lengths(aad_len: u64, text_len: u64) -> [u8; 16] {
+    let mut block = [0; 16];
+    block[..8].copy_from_slice(&(aad_len * 8).to_be_bytes());
+    block[8..].copy_from_slice(&(text_len * 8).to_be_bytes());
+    block
+}
+
+fn poly1305_lengths(aad_len: u64, text_len: u64) -> [u8; 16] {
+    let mut block = [0; 16];
+    block[..8].copy_from_slice(&aad_len.to_le_bytes());
+    block[8..].copy_from_slice(&text_len.to_le_bytes());
+    block
+}
+
+type Ctr32<C> = ctr::Ctr32BE<C>;
+
+fn aes_gcm<C>(
+    key: &[u8],
+    iv: &[u8],
+    decrypt: bool,
+    tag_len: usize,
+) -> Result<Box<dyn Mode>, CipherError>
+where
+    C: KeyInit + BlockEncrypt + BlockCipher + BlockSizeUser<BlockSize = U16> + 'static,
+{
+    let c = C::new_from_slice(key).map_err(|_| CipherError::KeyLength)?;
+    if iv.is_empty() {
+        return Err(CipherError::Iv);
+    }
+    let mut h = GenericArray::default();
+    c.encrypt_block(&mut h);
+    let mut j0 = [0; 16];
+    if iv.len() == 12 {
+        j0[..12].copy_from_slice(iv);
+        j0[15] = 1;
+    } else {
+        let mut ghash = MacStream::new(GHash::new(&h));
+        ghash.feed(iv);
+        ghash.pad();
+        ghash.feed(&gcm_lengths(0, iv.len() as u64));
+        j0.copy_from_slice(&ghash.mac.finalize());
+    }
+    let mut stream = Ctr32::<C>::inner_iv_init(c, GenericArray::from_slice(&j0));
+    // the block at J0 masks the tag, the data starts at the one after
+    let mut tag_mask = [0; 16];
+    stream.apply_keystream(&mut tag_mask);
+    Ok(Box::new(Aead {
+        stream,
+        mac: Some(MacStream::new(GHash::new(&h))),
+        decrypt,
+        tag_mask,
+        lengths: gcm_lengths,
+        started: false,
+        aad_len: 0,
+        text_len: 0,
+        tag_len,
+        tag: None,
+    }))
+}
+
+fn chacha20_poly1305(
+    key: &[u8],
+    iv: &[u8],
+    decrypt: bool,
+    tag_len: usize,
+) -> Result<Box<dyn Mode>, CipherError> {
+    if key.len() != 32 {
+        return Err(CipherError::KeyLength);
+    }
+    if iv.len() != 12 {
+        return Err(CipherError::Iv);
+    }
+    let mut stream = ChaCha20::new(key.into(), iv.into());
+    // block 0 keys Poly1305, the data starts at block 1
+    let mut mac_key = [0; 32];
+    stream.apply_keystream(&mut mac_key);
+    stream.seek(64u64);
+    Ok(Box::new(Aead {
+        stream,
+        mac: Some(MacStream::new(Poly1305::new((&mac_key).into()))),
+        decrypt,
+        tag_mask: [0; 16],
+        lengths: poly1305_lengths,
+        started: false,
+        aad_len: 0,
+        text_len: 0,
+        tag_len,
+        tag: None,
+    }))
+}
+
+fn aes_ctr<C>(key: &[u8], iv: &[u8]) -> Result<Box<dyn Mode>, CipherError>
+where
+    C: KeyInit + BlockEncryptMut + BlockCipher + BlockSizeUser<BlockSize = U16> + 'static,
+{
+    let c = C::new_from_slice(key).map_err(|_| CipherError::KeyLength)?;
+    if iv.len() != 16 {
+        return Err(CipherError::Iv);
+    }
+    let stream = ctr::Ctr128BE::<C>::inner_iv_init(c, GenericArray::from_slice(iv));
+    Ok(Box::new(Stream(stream)))
+}
+
+fn aes_cbc<C>(key: &[u8], iv: &[u8], decrypt: bool) -> Result<Box<dyn Mode>, CipherError>
+where
+    C: KeyInit
+        + BlockEncryptMut
+        + BlockDecryptMut
+        + BlockCipher
+        + BlockSizeUser<BlockSize = U16>
+        + 'static,
+{
+    let c = C::new_from_slice(key).map_err(|_| CipherError::KeyLength)?;
+    if iv.len() != 16 {
+        return Err(CipherError::Iv);
+    }
+    let iv = GenericArray::from_slice(iv);
+    Ok(if decrypt {
+        Box::new(Cbc::new(Decrypt(cbc::Decryptor::<C>::inner_iv_init(c, iv))))
+    } else {
+        Box::new(Cbc::new(Encrypt(cbc::Encryptor::<C>::inner_iv_init(c, iv))))
+    })
+}
+
+fn new_mode(
+    algorithm: &str,
+    key: &[u8],
+    iv: &[u8],
+    decrypt: bool,
+    tag_len: usize,
+) -> Option<Result<Box<dyn Mode>, CipherError>> {
+    if !valid_tag_len(tag_len) {
+        return Some(Err(CipherError::TagLength));
+    }
+    let mode = match algorithm {
+        "aes-128-cbc" => aes_cbc::<Aes128>(key, iv, decrypt),
+        "aes-192-cbc" => aes_cbc::<Aes192>(key, iv, decrypt),
+        "aes-256-cbc" => aes_cbc::<Aes256>(key, iv, decrypt),
+        "aes-128-ctr" => aes_ctr::<Aes128>(key, iv),
+        "aes-192-ctr" => aes_ctr::<Aes192>(key, iv),
+        "aes-256-ctr" => aes_ctr::<Aes256>(key, iv),
+        "aes-128-gcm" => aes_gcm::<Aes128>(key, iv, decrypt, tag_len),
+        "aes-192-gcm" => aes_gcm::<Aes192>(key, iv, decrypt, tag_len),
+        "aes-256-gcm" => aes_gcm::<Aes256>(key, iv, decrypt, tag_len),
+        "chacha20-poly1305" => chacha20_poly1305(key, iv, decrypt, tag_len),
+        _ => return None,
+    };
+    Some(mode)
+}
+
+pub struct Cipher(Box<dyn Mode>);
+
+fn output(ctx: &mut Context, out: Vec<u8>) -> JsValue {
+    ctx.new_array_buffer(&out).into()
+}
+
+/// `update(arrayBuffer, byteOffset, byteLength)`
+fn update(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let input = bytes_ref_arg(argv, 0);
+    let mut out = Vec::with_capacity(input.len() + 16);
+    this.0.update(input, &mut out);
+    output(ctx, out)
+}
+
+fn finish(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    let mut out = vec![];
+    match this.0.finish(&mut out) {
+        Ok(()) => output(ctx, out),
+        Err(msg) => {
+            let e = ctx.new_error(msg);
+            ctx.throw_error(e).into()
+        }
+    }
+}
+
+fn set_auto_padding(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    _ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let padding = !matches!(argv.get(0), Some(JsValue::Bool(false)));
+    JsValue::Bool(this.0.set_auto_padding(padding))
+}
+
+/// `setAAD(arrayBuffer, byteOffset, byteLength)`, false once data went in
+/// or for a mode without AAD.
+fn set_aad(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    _ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    JsValue::Bool(this.0.set_aad(bytes_ref_arg(argv, 0)))
+}
+
+fn get_auth_tag(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    match this.0.auth_tag() {
+        Some(tag) => ctx.new_array_buffer(tag).into(),
+        None => JsValue::UnDefined,
+    }
+}
+
+fn set_auth_tag(
+    this: &mut Cipher,
+    _this_obj: &mut JsObject,
+    _ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    JsValue::Bool(this.0.set_auth_tag(bytes_ref_arg(argv, 0)))
+}
+
+fn int_arg(argv: &[JsValue], i: usize) -> usize {
+    match argv.get(i) {
+        Some(JsValue::Int(n)) if *n > 0 => *n as usize,
+        Some(JsValue::Float(n)) if *n > 0.0 => *n as usize,
+        _ => 0,
+    }
+}
+
+impl JsClassDef for Cipher {
+    type RefType = Cipher;
+
+    const CLASS_NAME: &'static str = "Cipher";
+    const CONSTRUCTOR_ARGC: u8 = 9;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] = &[
+        ("update", 3, update),
+        ("final", 0, finish),
+        ("setAutoPadding", 1, set_auto_padding),
+        ("setAAD", 3, set_aad),
+        ("getAuthTag", 0, get_auth_tag),
+        ("setAuthTag", 3, set_auth_tag),
+    ];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// `new Cipher(algorithm, decrypt, key..., iv..., authTagLength)`, the
+    /// algorithm lower cased and the key and IV as (arrayBuffer,
+    /// byteOffset, byteLength).
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let algorithm = match argv.get(0) {
+            Some(JsValue::String(s)) => s.to_string(),
+            _ => return Err(ctx.throw_type_error("algorithm must be a string").into()),
+        };
+        let decrypt = matches!(argv.get(1), Some(JsValue::Bool(true)));
+        let (key, iv) = (bytes_ref_arg(argv, 2), bytes_ref_arg(argv, 5));
+        let tag_len = match int_arg(argv, 8) {
+            0 => 16,
+            n => n,
+        };
+        match new_mode(&algorithm, key, iv, decrypt, tag_len) {
+            Some(Ok(mode)) => Ok(Cipher(mode)),
+            Some(Err(CipherError::KeyLength)) => {
+                Err(ctx.throw_range_error("Invalid key length").into())
+            }
+            Some(Err(CipherError::Iv)) => Err(ctx
+                .throw_range_error("Invalid initialization vector")
+                .into()),
+            Some(Err(CipherError::TagLength)) => Err(ctx
+                .throw_range_error("Invalid authentication tag length")
+                .into()),
+            None => Err(ctx.throw_type_error("Unknown cipher").into()),
+        }
+    }
+}
+
+pub fn get_ciphers(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let mut arr = ctx.new_array();
+    for (i, name) in CIPHERS.iter().enumerate() {
+        arr.put(i, ctx.new_string(name).into());
+    }
+    arr.into()
+}
@@ -47,14 +47,20 @@ fn next_tick(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue
     JsValue::UnDefined
 }
 
-fn os_exit(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+fn os_exit(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
     let code = if let Some(JsValue::Int(c)) = argv.get(0) {
         *c
     } else {
         0
     };
 
-    std::process::exit(code)
+    match ctx.event_loop() {
+        Some(event_loop) if event_loop.trap_exit() => {
+            event_loop.set_exit_code(code);
+            JsValue::Exception(ctx.throw_uncatchable_error("exit"))
+        }
+        _ => std::process::exit(code),
+    }
 }
 
 struct ClearTimeout;
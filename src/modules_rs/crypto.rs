@@ -0,0 +1,856 @@
+// Message digests and HMACs behind crypto.createHash and
+// crypto.createHmac. Each Hash/Hmac object owns a streaming RustCrypto
+// context: `update` feeds it straight from a Buffer's memory, or from a
+// string's own storage, and `digest` returns the result in a new
+// ArrayBuffer. `hashFile`/`hashFiles` read and digest whole files without
+// their contents ever reaching JS. PBKDF2, scrypt and HKDF derive keys
+// over the same HMACs. The ciphers live in cipher.rs, random bytes in
+// random.rs.
+
+use super::buffer::bytes_ref_arg;
+use super::cipher::{get_ciphers, Cipher};
+use super::fs::{err_to_js_object, errno_to_js_object};
+use super::random::{random_fill, random_uuid};
+use super::utf8;
+use crate::event_loop::wasi_fs;
+use crate::quickjs_sys::*;
+use blake2::{Blake2b512, Blake2s256};
+use digest::{DynDigest, KeyInit, Mac, OutputSizeUser};
+use hmac::{Hmac, SimpleHmac};
+use md5::Md5;
+use sha1::Sha1;
+use sha2::{Sha224, Sha256, Sha384, Sha512, Sha512_224, Sha512_256};
+use sha3::{Sha3_224, Sha3_256, Sha3_384, Sha3_512};
+use std::time::{Duration, Instant};
+
+/// Algorithms with a native implementation, by their OpenSSL names.
+const HASHES: &[&str] = &[
+    "md5",
+    "sha1",
+    "sha224",
+    "sha256",
+    "sha384",
+    "sha512",
+    "sha512-224",
+    "sha512-256",
+    "sha3-224",
+    "sha3-256",
+    "sha3-384",
+    "sha3-512",
+    "blake2b512",
+    "blake2s256",
+];
+
+fn new_digest(algorithm: &str) -> Option<Box<dyn DynDigest>> {
+    let d: Box<dyn DynDigest> = match algorithm {
+        "md5" => Box::new(Md5::default()),
+        "sha1" => Box::new(Sha1::default()),
+        "sha224" => Box::new(Sha224::default()),
+        "sha256" => Box::new(Sha256::default()),
+        "sha384" => Box::new(Sha384::default()),
+        "sha512" => Box::new(Sha512::default()),
+        "sha512-224" => Box::new(Sha512_224::default()),
+        "sha512-256" => Box::new(Sha512_256::default()),
+        "sha3-224" => Box::new(Sha3_224::default()),
+        "sha3-256" => Box::new(Sha3_256::default()),
+        "sha3-384" => Box::new(Sha3_384::default()),
+        "sha3-512" => Box::new(Sha3_512::default()),
+        "blake2b512" => Box::new(Blake2b512::default()),
+        "blake2s256" => Box::new(Blake2s256::default()),
+        _ => return None,
+    };
+    Some(d)
+}
+
+/// Object safe part of `Mac`.
+trait MacState {
+    fn update(&mut self, data: &[u8]);
+    fn finalize(self: Box<Self>) -> Vec<u8>;
+}
+
+impl<M: Mac + 'static> MacState for M {
+    fn update(&mut self, data: &[u8]) {
+        Mac::update(self, data)
+    }
+
+    fn finalize(self: Box<Self>) -> Vec<u8> {
+        Mac::finalize(*self).into_bytes().to_vec()
+    }
+}
+
+/// Expands to `Some($f::<M>(args))` with `M` the HMAC type of `$algorithm`,
+/// or `None` when there is no native one.
+macro_rules! with_hmac {
+    ($algorithm:expr, $f:ident($($arg:expr),*)) => {
+        match $algorithm {
+            "md5" => Some($f::<Hmac<Md5>>($($arg),*)),
+            "sha1" => Some($f::<Hmac<Sha1>>($($arg),*)),
+            "sha224" => Some($f::<Hmac<Sha224>>($($arg),*)),
+            "sha256" => Some($f::<Hmac<Sha256>>($($arg),*)),
+            "sha384" => Some($f::<Hmac<Sha384>>($($arg),*)),
+            "sha512" => Some($f::<Hmac<Sha512>>($($arg),*)),
+            "sha512-224" => Some($f::<Hmac<Sha512_224>>($($arg),*)),
+            "sha512-256" => Some($f::<Hmac<Sha512_256>>($($arg),*)),
+            "sha3-224" => Some($f::<Hmac<Sha3_224>>($($arg),*)),
+            "sha3-256" => Some($f::<Hmac<Sha3_256>>($($arg),*)),
+            "sha3-384" => Some($f::<Hmac<Sha3_384>>($($arg),*)),
+            "sha3-512" => Some($f::<Hmac<Sha3_512>>($($arg),*)),
+            // BLAKE2 has no block level API for `Hmac`
+            "blake2b512" => Some($f::<SimpleHmac<Blake2b512>>($($arg),*)),
+            "blake2s256" => Some($f::<SimpleHmac<Blake2s256>>($($arg),*)),
+            _ => None,
+        }
+    };
+}
+
+fn new_hmac(algorithm: &str, key: &[u8]) -> Option<Box<dyn MacState>> {
+    fn mac<M: MacState + KeyInit + 'static>(key: &[u8]) -> Box<dyn MacState> {
+        Box::new(<M as KeyInit>::new_from_slice(key).expect("HMAC takes keys of any length"))
+    }
+    with_hmac!(algorithm, mac(key))
+}
+
+/// Feeds the UTF-8 encoding of a string to `f`, a chunk at a time. ASCII
+/// strings are passed as they are stored.
+fn with_utf8(s: &JsString, mut f: impl FnMut(&[u8])) {
+    let mut chunk = [0; 4096];
+    match s.data() {
+        JsStringData::Latin1(mut src) => {
+            if utf8::ascii_prefix(src) == src.len() {
+                return f(src);
+            }
+            while !src.is_empty() {
+                let (read, written) = utf8::latin1_to_utf8(src, &mut chunk);
+                f(&chunk[..written]);
+                src = &src[read..];
+            }
+        }
+        JsStringData::Utf16(mut src) => {
+            while !src.is_empty() {
+                let (read, written) = utf8::utf16_to_utf8(src, &mut chunk);
+                f(&chunk[..written]);
+                src = &src[read..];
+            }
+        }
+    }
+}
+
+/// `update(string)` or `update(arrayBuffer, byteOffset, byteLength)`.
+fn update_with(argv: &[JsValue], mut f: impl FnMut(&[u8])) {
+    match argv.get(0) {
+        Some(JsValue::String(s)) => with_utf8(s, f),
+        _ => f(bytes_ref_arg(argv, 0)),
+    }
+}
+
+fn algorithm_arg(ctx: &mut Context, argv: &[JsValue]) -> Result<String, JsValue> {
+    match argv.get(0) {
+        Some(JsValue::String(s)) => Ok(s.to_string()),
+        _ => Err(ctx.throw_type_error("algorithm must be a string").into()),
+    }
+}
+
+fn throw(ctx: &mut Context, msg: &str) -> JsValue {
+    let e = ctx.new_error(msg);
+    ctx.throw_error(e).into()
+}
+
+fn finalized(ctx: &mut Context) -> JsValue {
+    throw(ctx, "Digest already called")
+}
+
+pub struct Hash(Option<Box<dyn DynDigest>>);
+
+fn hash_update(
+    this: &mut Hash,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    match &mut this.0 {
+        Some(d) => {
+            update_with(argv, |data| d.update(data));
+            JsValue::UnDefined
+        }
+        None => finalized(ctx),
+    }
+}
+
+fn hash_digest(
+    this: &mut Hash,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    match this.0.take() {
+        Some(d) => ctx.new_array_buffer(&d.finalize()).into(),
+        None => finalized(ctx),
+    }
+}
+
+fn hash_copy(
+    this: &mut Hash,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    match &this.0 {
+        Some(d) => Hash::wrap_obj(ctx, Hash(Some(d.box_clone()))),
+        None => finalized(ctx),
+    }
+}
+
+impl JsClassDef for Hash {
+    type RefType = Hash;
+
+    const CLASS_NAME: &'static str = "Hash";
+    const CONSTRUCTOR_ARGC: u8 = 1;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] = &[
+        ("update", 3, hash_update),
+        ("digest", 0, hash_digest),
+        ("copy", 0, hash_copy),
+    ];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// `new Hash(algorithm)`, the name already lower cased.
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let algorithm = algorithm_arg(ctx, argv)?;
+        match new_digest(&algorithm) {
+            Some(d) => Ok(Hash(Some(d))),
+            None => Err(throw(ctx, "Digest method not supported")),
+        }
+    }
+}
+
+pub struct HmacState(Option<Box<dyn MacState>>);
+
+fn hmac_update(
+    this: &mut HmacState,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    match &mut this.0 {
+        Some(m) => {
+            update_with(argv, |data| m.update(data));
+            JsValue::UnDefined
+        }
+        None => finalized(ctx),
+    }
+}
+
+fn hmac_digest(
+    this: &mut HmacState,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    match this.0.take() {
+        Some(m) => ctx.new_array_buffer(&m.finalize()).into(),
+        None => finalized(ctx),
+    }
+}
+
+impl JsClassDef for HmacState {
+    type RefType = HmacState;
+
+    const CLASS_NAME: &'static str = "Hmac";
+    const CONSTRUCTOR_ARGC: u8 = 4;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] =
+        &[("update", 3, hmac_update), ("digest", 0, hmac_digest)];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// `new Hmac(algorithm, keyArrayBuffer, byteOffset, byteLength)`
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let algorithm = algorithm_arg(ctx, argv)?;
+        match new_hmac(&algorithm, bytes_ref_arg(argv, 1)) {
+            Some(m) => Ok(HmacState(Some(m))),
+            None => Err(throw(ctx, "Invalid digest")),
+        }
+    }
+}
+
+/// Read size of `hashFile`, one buffer is reused for every file of a batch.
+const FILE_CHUNK: usize = 1 << 20;
+
+fn file_error(ctx: &mut Context, mut err: JsValue, path: &str) -> JsValue {
+    if let JsValue::Object(o) = &mut err {
+        o.set("path", ctx.new_string(path).into());
+    }
+    ctx.throw_error(err).into()
+}
+
+fn digest_file(
+    ctx: &mut Context,
+    algorithm: &str,
+    path: &str,
+    buf: &mut Vec<u8>,
+) -> Result<JsValue, JsValue> {
+    let mut d = match new_digest(algorithm) {
+        Some(d) => d,
+        None => return Err(throw(ctx, "Digest method not supported")),
+    };
+    let (dir, file) = match wasi_fs::open_parent(path) {
+        Ok(ok) => ok,
+        Err(e) => {
+            // no preopened directory holds the path, so it can't be found
+            let err = match e.raw_os_error() {
+                Some(_) => err_to_js_object(ctx, e),
+                None => errno_to_js_object(ctx, wasi_fs::ERRNO_NOENT),
+            };
+            return Err(file_error(ctx, err, path));
+        }
+    };
+    let rights = wasi_fs::RIGHTS_FD_READ | wasi_fs::RIGHTS_FD_SEEK;
+    let fd = match unsafe {
+        wasi_fs::path_open(
+            dir,
+            wasi_fs::LOOKUPFLAGS_SYMLINK_FOLLOW,
+            &file,
+            0,
+            rights,
+            0,
+            0,
+        )
+    } {
+        Ok(fd) => fd,
+        Err(e) => {
+            let err = errno_to_js_object(ctx, e);
+            return Err(file_error(ctx, err, path));
+        }
+    };
+    if buf.is_empty() {
+        buf.resize(FILE_CHUNK, 0);
+    }
+    let mut position = 0;
+    let res = loop {
+        let iovs = [wasi_fs::Iovec {
+            buf: buf.as_mut_ptr(),
+            buf_len: buf.len(),
+        }];
+        match unsafe { wasi_fs::fd_pread(fd, &iovs, position) } {
+            Ok(0) => break Ok(()),
+            Ok(n) => {
+                d.update(&buf[..n]);
+                position += n as u64;
+            }
+            Err(e) => break Err(e),
+        }
+    };
+    unsafe { wasi_fs::fd_close(fd) }.ok();
+    match res {
+        Ok(()) => Ok(ctx.new_array_buffer(&d.finalize()).into()),
+        Err(e) => {
+            let err = errno_to_js_object(ctx, e);
+            Err(file_error(ctx, err, path))
+        }
+    }
+}
+
+/// `hashFile(path, algorithm)`, the digest as an ArrayBuffer.
+fn hash_file(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (path, algorithm) = match (argv.get(0), argv.get(1)) {
+        (Some(JsValue::String(p)), Some(JsValue::String(a))) => (p.to_string(), a.to_string()),
+        _ => {
+            return ctx
+                .throw_type_error("path and algorithm must be strings")
+                .into()
+        }
+    };
+    let mut buf = vec![];
+    digest_file(ctx, &algorithm, &path, &mut buf).unwrap_or_else(|e| e)
+}
+
+/// `hashFiles(paths, algorithm)`, an array of digests in the order of
+/// `paths`. The first file that can't be read throws.
+fn hash_files(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (paths, algorithm) = match (argv.get(0), argv.get(1)) {
+        (Some(JsValue::Array(p)), Some(JsValue::String(a))) => (p.clone(), a.to_string()),
+        _ => {
+            return ctx
+                .throw_type_error("paths must be an array and algorithm a string")
+                .into()
+        }
+    };
+    let mut buf = vec![];
+    let mut digests = ctx.new_array();
+    for i in 0..paths.get_length() {
+        let path = match paths.take(i) {
+            JsValue::String(p) => p.to_string(),
+            _ => return ctx.throw_type_error("paths must be strings").into(),
+        };
+        match digest_file(ctx, &algorithm, &path, &mut buf) {
+            Ok(d) => digests.put(i, d),
+            Err(e) => return e,
+        }
+    }
+    digests.into()
+}
+
+// Key derivation. PBKDF2 and scrypt run as `Kdf` jobs that JS advances a
+// time slice at a time, so the async variants let other tasks in between
+// slices; the sync ones run a job in one go. HKDF is two HMAC passes and
+// is computed right away.
+
+/// HMAC keyed once and cloned for every message.
+trait Prf: Clone {
+    fn keyed(key: &[u8]) -> Self;
+    fn output_len() -> usize;
+    fn mac_into(&self, parts: &[&[u8]], out: &mut [u8]);
+}
+
+impl<M: Mac + KeyInit + Clone> Prf for M {
+    fn keyed(key: &[u8]) -> Self {
+        <M as KeyInit>::new_from_slice(key).expect("HMAC takes keys of any length")
+    }
+
+    fn output_len() -> usize {
+        <M as OutputSizeUser>::output_size()
+    }
+
+    fn mac_into(&self, parts: &[&[u8]], out: &mut [u8]) {
+        let mut m = self.clone();
+        for part in parts {
+            Mac::update(&mut m, part);
+        }
+        out.copy_from_slice(&Mac::finalize(m).into_bytes());
+    }
+}
+
+/// Units of work between two looks at the clock.
+const KDF_CHECK_EVERY: u32 = 256;
+
+trait KdfJob {
+    /// Works until the job is done, returning true, or past `deadline`.
+    fn step(&mut self, deadline: Option<Instant>) -> bool;
+    fn take_output(&mut self) -> Vec<u8>;
+}
+
+fn past(deadline: Option<Instant>) -> bool {
+    matches!(deadline, Some(d) if Instant::now() >= d)
+}
+
+struct Pbkdf2<P: Prf> {
+    prf: P,
+    salt: Vec<u8>,
+    iterations: u32,
+    out: Vec<u8>,
+    // bytes of `out` derived so far, and rounds into the next block
+    done: usize,
+    round: u32,
+    u: Vec<u8>,
+    next: Vec<u8>,
+    t: Vec<u8>,
+}
+
+impl<P: Prf> Pbkdf2<P> {
+    fn new(password: &[u8], salt: &[u8], iterations: u32, keylen: usize) -> Self {
+        let hlen = P::output_len();
+        Pbkdf2 {
+            prf: P::keyed(password),
+            salt: salt.to_vec(),
+            iterations,
+            out: vec![0; keylen],
+            done: 0,
+            round: 0,
+            u: vec![0; hlen],
+            next: vec![0; hlen],
+            t: vec![0; hlen],
+        }
+    }
+}
+
+impl<P: Prf> KdfJob for Pbkdf2<P> {
+    fn step(&mut self, deadline: Option<Instant>) -> bool {
+        let hlen = self.u.len();
+        while self.done < self.out.len() {
+            if self.round == 0 {
+                let block = (self.done / hlen + 1) as u32;
+                self.prf
+                    .mac_into(&[&self.salt, &block.to_be_bytes()], &mut self.u);
+                self.t.copy_from_slice(&self.u);
+                self.round = 1;
+            }
+            while self.round < self.iterations {
+                self.prf.mac_into(&[&self.u], &mut self.next);
+                std::mem::swap(&mut self.u, &mut self.next);
+                for (t, u) in self.t.iter_mut().zip(&self.u) {
+                    *t ^= u;
+                }
+                self.round += 1;
+                if self.round % KDF_CHECK_EVERY == 0 && past(deadline) {
+                    return false;
+                }
+            }
+            let n = hlen.min(self.out.len() - self.done);
+            self.out[self.done..self.done + n].copy_from_slice(&self.t[..n]);
+            self.done += n;
+            self.round = 0;
+        }
+        true
+    }
+
+    fn take_output(&mut self) -> Vec<u8> {
+        std::mem::take(&mut self.out)
+    }
+}
+
+fn pbkdf2_job<P: Prf + 'static>(
+    password: &[u8],
+    salt: &[u8],
+    iterations: u32,
+    keylen: usize,
+) -> Box<dyn KdfJob> {
+    Box::new(Pbkdf2::<P>::new(password, salt, iterations, keylen))
+}
+
+fn pbkdf2_sha256_once(password: &[u8], salt: &[u8], keylen: usize) -> Vec<u8> {
+    let mut job = Pbkdf2::<Hmac<Sha256>>::new(password, salt, 1, keylen);
+    job.step(None);
+    job.take_output()
+}
+
+fn salsa20_8(b: &mut [u32; 16]) {
+    fn quarter(x: &mut [u32; 16], a: usize, b: usize, c: usize, d: usize) {
+        x[b] ^= x[a].wrapping_add(x[d]).rotate_left(7);
+        x[c] ^= x[b].wrapping_add(x[a]).rotate_left(9);
+        x[d] ^= x[c].wrapping_add(x[b]).rotate_left(13);
+        x[a] ^= x[d].wrapping_add(x[c]).rotate_left(18);
+    }
+    let mut x = *b;
+    for _ in 0..4 {
+        quarter(&mut x, 0, 4, 8, 12);
+        quarter(&mut x, 5, 9, 13, 1);
+        quarter(&mut x, 10, 14, 2, 6);
+        quarter(&mut x, 15, 3, 7, 11);
+        quarter(&mut x, 0, 1, 2, 3);
+        quarter(&mut x, 5, 6, 7, 4);
+        quarter(&mut x, 10, 11, 8, 9);
+        quarter(&mut x, 15, 12, 13, 14);
+    }
+    for (b, x) in b.iter_mut().zip(&x) {
+        *b = b.wrapping_add(*x);
+    }
+}
+
+/// scryptBlockMix of RFC 7914 over the 2r 64 byte blocks of `x`, `y` is
+/// scratch space of the same size.
+fn block_mix(x: &mut [u32], y: &mut [u32], r: usize) {
+    let mut t = [0; 16];
+    t.copy_from_slice(&x[(2 * r - 1) * 16..]);
+    for (i, block) in x.chunks_exact(16).enumerate() {
+        for (t, b) in t.iter_mut().zip(block) {
+            *t ^= b;
+        }
+        salsa20_8(&mut t);
+        // even blocks go to the first half, odd ones to the second
+        let dst = (i / 2 + (i % 2) * r) * 16;
+        y[dst..dst + 16].copy_from_slice(&t);
+    }
+    x.copy_from_slice(y);
+}
+
+struct Scrypt {
+    password: Vec<u8>,
+    keylen: usize,
+    n: usize,
+    r: usize,
+    // p lanes of 32r words each, mixed one after the other
+    b: Vec<u32>,
+    v: Vec<u32>,
+    x: Vec<u32>,
+    y: Vec<u32>,
+    lane: usize,
+    // position in the 2N BlockMix calls of the current lane
+    i: usize,
+    out: Option<Vec<u8>>,
+}
+
+impl Scrypt {
+    /// None when B or V would not fit the address space.
+    fn new(
+        password: &[u8],
+        salt: &[u8],
+        keylen: usize,
+        n: usize,
+        r: usize,
+        p: usize,
+    ) -> Option<Self> {
+        let words = r.checked_mul(32)?;
+        let b_bytes = words.checked_mul(4)?.checked_mul(p)?;
+        let v_words = words.checked_mul(n)?;
+        v_words.checked_mul(4)?;
+        let b = pbkdf2_sha256_once(password, salt, b_bytes)
+            .chunks_exact(4)
+            .map(|w| u32::from_le_bytes([w[0], w[1], w[2], w[3]]))
+            .collect();
+        Some(Scrypt {
+            password: password.to_vec(),
+            keylen,
+            n,
+            r,
+            b,
+            v: vec![0; v_words],
+            x: vec![0; words],
+            y: vec![0; words],
+            lane: 0,
+            i: 0,
+            out: None,
+        })
+    }
+}
+
+impl KdfJob for Scrypt {
+    fn step(&mut self, deadline: Option<Instant>) -> bool {
+        let words = self.x.len();
+        let (n, r) = (self.n, self.r);
+        while self.lane * words < self.b.len() {
+            let lane = &mut self.b[self.lane * words..(self.lane + 1) * words];
+            if self.i == 0 {
+                self.x.copy_from_slice(lane);
+            }
+            while self.i < 2 * n {
+                if self.i < n {
+                    self.v[self.i * words..(self.i + 1) * words].copy_from_slice(&self.x);
+                } else {
+                    // Integerify, N being a power of two
+                    let j = self.x[(2 * r - 1) * 16] as usize & (n - 1);
+                    for (x, v) in self.x.iter_mut().zip(&self.v[j * words..]) {
+                        *x ^= v;
+                    }
+                }
+                block_mix(&mut self.x, &mut self.y, r);
+                self.i += 1;
+                if self.i as u32 % KDF_CHECK_EVERY == 0 && past(deadline) {
+                    return false;
+                }
+            }
+            lane.copy_from_slice(&self.x);
+            self.lane += 1;
+            self.i = 0;
+        }
+        if self.out.is_none() {
+            self.v = vec![];
+            let b: Vec<u8> = self.b.iter().flat_map(|w| w.to_le_bytes()).collect();
+            self.out = Some(pbkdf2_sha256_once(&self.password, &b, self.keylen));
+        }
+        true
+    }
+
+    fn take_output(&mut self) -> Vec<u8> {
+        self.out.take().unwrap_or_default()
+    }
+}
+
+/// HKDF of RFC 5869, None when `keylen` is over 255 blocks.
+fn hkdf<P: Prf>(ikm: &[u8], salt: &[u8], info: &[u8], keylen: usize) -> Option<Vec<u8>> {
+    let hlen = P::output_len();
+    if keylen > 255 * hlen {
+        return None;
+    }
+    // an empty salt keys the HMAC just like hlen zero bytes would
+    let mut prk = vec![0; hlen];
+    P::keyed(salt).mac_into(&[ikm], &mut prk);
+    let prf = P::keyed(&prk);
+    let mut out = Vec::with_capacity(keylen);
+    let mut t = vec![0; hlen];
+    let mut block = 1u8;
+    while out.len() < keylen {
+        let prev = if block == 1 { &[][..] } else { &prk[..] };
+        prf.mac_into(&[prev, info, &[block]], &mut t);
+        prk.copy_from_slice(&t);
+        out.extend_from_slice(&t[..hlen.min(keylen - out.len())]);
+        block = block.wrapping_add(1);
+    }
+    Some(out)
+}
+
+pub struct Kdf(Box<dyn KdfJob>);
+
+/// `step(ms)`, true once the key is derived. Without a positive time slice
+/// the job runs to the end.
+fn kdf_step(
+    this: &mut Kdf,
+    _this_obj: &mut JsObject,
+    _ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let deadline = match uint_arg(argv, 0) {
+        0 => None,
+        ms => Some(Instant::now() + Duration::from_millis(ms as u64)),
+    };
+    JsValue::Bool(this.0.step(deadline))
+}
+
+fn kdf_result(
+    this: &mut Kdf,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    ctx.new_array_buffer(&this.0.take_output()).into()
+}
+
+impl JsClassDef for Kdf {
+    type RefType = Kdf;
+
+    const CLASS_NAME: &'static str = "Kdf";
+    const CONSTRUCTOR_ARGC: u8 = 0;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] =
+        &[("step", 1, kdf_step), ("result", 0, kdf_result)];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// Jobs come from `pbkdf2()` and `scrypt()`.
+    fn constructor_fn(ctx: &mut Context, _argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        Err(ctx.throw_type_error("Illegal constructor").into())
+    }
+}
+
+fn uint_arg(argv: &[JsValue], i: usize) -> usize {
+    match argv.get(i) {
+        Some(JsValue::Int(n)) if *n > 0 => *n as usize,
+        Some(JsValue::Float(n)) if *n > 0.0 => *n as usize,
+        _ => 0,
+    }
+}
+
+/// `pbkdf2(digest, password..., salt..., iterations, keylen)`, byte ranges
+/// as (arrayBuffer, byteOffset, byteLength). A Kdf job, or null for a
+/// digest without a native HMAC.
+fn pbkdf2(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let digest = match algorithm_arg(ctx, argv) {
+        Ok(d) => d,
+        Err(e) => return e,
+    };
+    let (password, salt) = (bytes_ref_arg(argv, 1), bytes_ref_arg(argv, 4));
+    let (iterations, keylen) = (uint_arg(argv, 7) as u32, uint_arg(argv, 8));
+    match with_hmac!(
+        digest.as_str(),
+        pbkdf2_job(password, salt, iterations, keylen)
+    ) {
+        Some(job) => Kdf::wrap_obj(ctx, Kdf(job)),
+        None => JsValue::Null,
+    }
+}
+
+/// `scrypt(password..., salt..., keylen, N, r, p)`, the parameters already
+/// checked by JS.
+fn scrypt(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (password, salt) = (bytes_ref_arg(argv, 0), bytes_ref_arg(argv, 3));
+    let keylen = uint_arg(argv, 6);
+    let (n, r, p) = (uint_arg(argv, 7), uint_arg(argv, 8), uint_arg(argv, 9));
+    let lanes_ok = p.checked_mul(r).map_or(false, |pr| pr < 1 << 30);
+    if n < 2 || !n.is_power_of_two() || r == 0 || p == 0 || !lanes_ok {
+        return ctx.throw_range_error("Invalid scrypt params").into();
+    }
+    match Scrypt::new(password, salt, keylen, n, r, p) {
+        Some(job) => Kdf::wrap_obj(ctx, Kdf(Box::new(job))),
+        None => ctx
+            .throw_range_error("Invalid scrypt params: memory limit exceeded")
+            .into(),
+    }
+}
+
+/// `hkdf(digest, ikm..., salt..., info..., keylen)`, the key as an
+/// ArrayBuffer, or null for a digest without a native HMAC.
+fn hkdf_sync(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let digest = match algorithm_arg(ctx, argv) {
+        Ok(d) => d,
+        Err(e) => return e,
+    };
+    let (ikm, salt, info) = (
+        bytes_ref_arg(argv, 1),
+        bytes_ref_arg(argv, 4),
+        bytes_ref_arg(argv, 7),
+    );
+    let keylen = uint_arg(argv, 10);
+    match with_hmac!(digest.as_str(), hkdf(ikm, salt, info, keylen)) {
+        Some(Some(key)) => ctx.new_array_buffer(&key).into(),
+        Some(None) => ctx.throw_range_error("Invalid key length").into(),
+        None => JsValue::Null,
+    }
+}
+
+fn get_hashes(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let mut arr = ctx.new_array();
+    for (i, name) in HASHES.iter().enumerate() {
+        arr.put(i, ctx.new_string(name).into());
+    }
+    arr.into()
+}
+
+struct CryptoModule;
+
+impl ModuleInit for CryptoModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let class_ctor = register_class::<Hash>(ctx);
+        m.add_export("Hash\0", class_ctor);
+        let class_ctor = register_class::<HmacState>(ctx);
+        m.add_export("Hmac\0", class_ctor);
+        let f = ctx.wrap_function("getHashes", get_hashes);
+        m.add_export("getHashes\0", f.into());
+        let f = ctx.wrap_function("hashFile", hash_file);
+        m.add_export("hashFile\0", f.into());
+        let f = ctx.wrap_function("hashFiles", hash_files);
+        m.add_export("hashFiles\0", f.into());
+        let class_ctor = register_class::<Kdf>(ctx);
+        m.add_export("Kdf\0", class_ctor);
+        let f = ctx.wrap_function("pbkdf2", pbkdf2);
+        m.add_export("pbkdf2\0", f.into());
+        let f = ctx.wrap_function("scrypt", scrypt);
+        m.add_export("scrypt\0", f.into());
+        let f = ctx.wrap_function("hkdf", hkdf_sync);
+        m.add_export("hkdf\0", f.into());
+        let class_ctor = register_class::<Cipher>(ctx);
+        m.add_export("Cipher\0", class_ctor);
+        let f = ctx.wrap_function("getCiphers", get_ciphers);
+        m.add_export("getCiphers\0", f.into());
+        let f = ctx.wrap_function("randomFill", random_fill);
+        m.add_export("randomFill\0", f.into());
+        let f = ctx.wrap_function("randomUUID", random_uuid);
+        m.add_export("randomUUID\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:crypto\0",
+        CryptoModule,
+        &[
+            "Hash\0",
+            "Hmac\0",
+            "getHashes\0",
+            "hashFile\0",
+            "hashFiles\0",
+            "Kdf\0",
+            "pbkdf2\0",
+            "scrypt\0",
+            "hkdf\0",
+            "Cipher\0",
+            "getCiphers\0",
+            "randomFill\0",
+            "randomUUID\0",
+        ],
+    )
+}
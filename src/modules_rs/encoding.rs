@@ -1,14 +1,33 @@
 use std::borrow::Cow;
 
+use super::utf8;
 use crate::quickjs_sys::*;
 use encoding::{
     all::{
         whatwg::{ISO_8859_8_I, X_USER_DEFINED},
         *,
     },
-    DecoderTrap, EncoderTrap, Encoding,
+    DecoderTrap, Encoding,
 };
 
+/// Encodes straight from the string's Latin1 or UTF-16 storage into an
+/// ArrayBuffer of the exact size.
+fn encode_utf8(ctx: &mut Context, s: &JsString) -> JsValue {
+    let data = s.data();
+    let len = match data {
+        JsStringData::Latin1(src) => utf8::latin1_utf8_len(src),
+        JsStringData::Utf16(src) => utf8::utf16_utf8_len(src),
+    };
+    let mut buf = ctx.new_array_buffer_zeroed(len);
+    if let JsValue::ArrayBuffer(dst) = &mut buf {
+        match data {
+            JsStringData::Latin1(src) => utf8::latin1_to_utf8(src, dst.as_mut()),
+            JsStringData::Utf16(src) => utf8::utf16_to_utf8(src, dst.as_mut()),
+        };
+    }
+    buf
+}
+
 fn text_encode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
     let s = params.get(0);
     let utf_label = match params.get(1).clone() {
@@ -20,16 +39,7 @@ fn text_encode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
     }
     if let JsValue::String(s) = ctx.value_to_string(s.unwrap()) {
         match utf_label {
-            "" | "utf8" | "utf-8" => {
-                let b = UTF_8.encode(s.as_str(), EncoderTrap::Replace);
-                match b {
-                    Ok(ret) => ctx.new_array_buffer(&ret).into(),
-                    Err(e) => {
-                        ctx.throw_type_error(&e);
-                        JsValue::UnDefined
-                    }
-                }
-            }
+            "" | "utf8" | "utf-8" => encode_utf8(ctx, &s),
             _ => JsValue::UnDefined,
         }
     } else {
@@ -37,42 +47,8 @@ fn text_encode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
     }
 }
 
-const TAG_CONT: u8 = 0b1000_0000;
-const TAG_TWO_B: u8 = 0b1100_0000;
-const TAG_THREE_B: u8 = 0b1110_0000;
-const TAG_FOUR_B: u8 = 0b1111_0000;
-const MAX_ONE_B: u32 = 0x80;
-const MAX_TWO_B: u32 = 0x800;
-const MAX_THREE_B: u32 = 0x10000;
-
-fn encode_utf8_raw(code: char, dst: &mut [u8]) -> Option<usize> {
-    let len = char::len_utf8(code);
-    let dst_len = dst.len();
-    let code = code as u32;
-    match (len, &mut dst[..]) {
-        (1, [a, ..]) if dst_len >= 1 => {
-            *a = code as u8;
-        }
-        (2, [a, b, ..]) if dst_len >= 2 => {
-            *a = (code >> 6 & 0x1F) as u8 | TAG_TWO_B;
-            *b = (code & 0x3F) as u8 | TAG_CONT;
-        }
-        (3, [a, b, c, ..]) if dst_len >= 3 => {
-            *a = (code >> 12 & 0x0F) as u8 | TAG_THREE_B;
-            *b = (code >> 6 & 0x3F) as u8 | TAG_CONT;
-            *c = (code & 0x3F) as u8 | TAG_CONT;
-        }
-        (4, [a, b, c, d, ..]) if dst_len >= 4 => {
-            *a = (code >> 18 & 0x07) as u8 | TAG_FOUR_B;
-            *b = (code >> 12 & 0x3F) as u8 | TAG_CONT;
-            *c = (code >> 6 & 0x3F) as u8 | TAG_CONT;
-            *d = (code & 0x3F) as u8 | TAG_CONT;
-        }
-        _ => return None,
-    };
-    Some(len)
-}
-
+/// `text_encode_into(src, label, buffer, byteOffset, byteLength)`, `read`
+/// counts UTF-16 code units like the WHATWG encodeInto.
 fn text_encode_into(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
     let src = params.get(0);
     let utf_label = match params.get(1).clone() {
@@ -91,26 +67,22 @@ fn text_encode_into(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValu
         Some(JsValue::Int(offset)),
     ) = (ctx.value_to_string(src.unwrap()), dest.cloned(), offset)
     {
-        let src = s.as_str();
         let dst = dst_buff.as_mut();
         let offset = dst.len().min(*offset as usize);
+        let end = match params.get(4) {
+            Some(JsValue::Int(len)) => dst.len().min(offset + *len as usize),
+            _ => dst.len(),
+        };
+        let dst = &mut dst[offset..end];
 
         match utf_label {
             "" | "utf8" | "utf-8" => {
-                let mut read = 0;
-                let mut written = 0;
+                let (read, written) = match s.data() {
+                    JsStringData::Latin1(src) => utf8::latin1_to_utf8(src, dst),
+                    JsStringData::Utf16(src) => utf8::utf16_to_utf8(src, dst),
+                };
                 let mut ret = ctx.new_object();
-
-                for c in src.chars() {
-                    if let Some(n) = encode_utf8_raw(c, &mut dst[written + offset..]) {
-                        written += n
-                    } else {
-                        break;
-                    }
-                    read += 1;
-                }
-
-                ret.set("read", JsValue::Int(read));
+                ret.set("read", JsValue::Int(read as i32));
                 ret.set("written", JsValue::Int(written as i32));
                 ret.into()
             }
@@ -121,6 +93,40 @@ fn text_encode_into(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValu
     }
 }
 
+/// Builds the JS string in the representation QuickJS would pick itself:
+/// Latin1 when every code point fits, UTF-16 otherwise. Validation and the
+/// ASCII runs go through the SIMD kernels.
+pub(crate) fn decode_utf8(
+    ctx: &mut Context,
+    bytes: &[u8],
+    fatal: bool,
+    ignore_bom: bool,
+) -> JsValue {
+    let bytes = match bytes {
+        [0xEF, 0xBB, 0xBF, rest @ ..] if !ignore_bom => rest,
+        _ => bytes,
+    };
+    let ascii = utf8::ascii_prefix(bytes);
+    if ascii == bytes.len() {
+        return ctx.new_string_latin1(bytes);
+    }
+    if !utf8::validate(&bytes[ascii..]) {
+        if fatal {
+            return ctx.new_error("The encoded data was not valid for encoding utf-8");
+        }
+        return ctx.new_string(&String::from_utf8_lossy(bytes)).into();
+    }
+    let mut latin1 = Vec::new();
+    let consumed = utf8::utf8_to_latin1(bytes, &mut latin1);
+    if consumed == bytes.len() {
+        return ctx.new_string_latin1(&latin1);
+    }
+    let mut units = Vec::with_capacity(bytes.len());
+    utf8::latin1_to_utf16(&latin1, &mut units);
+    utf8::utf8_to_utf16(&bytes[consumed..], &mut units);
+    ctx.new_string_utf16(&units)
+}
+
 fn text_decode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
     let s = params.get(0);
     let utf_label = match params.get(1).clone() {
@@ -131,6 +137,10 @@ fn text_decode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
         Some(JsValue::Bool(b)) => *b,
         _ => false,
     };
+    let ignore_bom = match params.get(5) {
+        Some(JsValue::Bool(b)) => *b,
+        _ => false,
+    };
 
     if s.is_none() {
         return JsValue::UnDefined;
@@ -149,142 +159,150 @@ fn text_decode(ctx: &mut Context, _: JsValue, params: &[JsValue]) -> JsValue {
         }
     }
 
-    if let JsValue::ArrayBuffer(s) = s.unwrap() {
+    if let JsValue::ArrayBuffer(buf) = s.unwrap() {
+        // `byteOffset`, `byteLength` of the view being decoded
+        let buf: &[u8] = buf.as_ref();
+        let start = match params.get(3) {
+            Some(JsValue::Int(n)) => buf.len().min(*n as usize),
+            _ => 0,
+        };
+        let end = match params.get(4) {
+            Some(JsValue::Int(n)) => buf.len().min(start + *n as usize),
+            _ => buf.len(),
+        };
+        let s = &buf[start..end];
         match utf_label {
-            "" | "utf8" | "utf-8" => {
-                let b = UTF_8.decode(s.as_ref(), trap);
-                ret_to_js(ctx, b)
-            }
+            "" | "utf8" | "utf-8" => decode_utf8(ctx, s, fatal, ignore_bom),
             "gbk" => {
-                let b = GBK.decode(s.as_ref(), trap);
+                let b = GBK.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "gb18030" => {
-                let b = GB18030.decode(s.as_ref(), trap);
+                let b = GB18030.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "hz-gb-2312" => {
-                let b = HZ.decode(s.as_ref(), trap);
+                let b = HZ.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "big5" => {
-                let b = BIG5_2003.decode(s.as_ref(), trap);
+                let b = BIG5_2003.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "euc-jp" => {
-                let b = EUC_JP.decode(s.as_ref(), trap);
+                let b = EUC_JP.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-2022-jp" => {
-                let b = ISO_2022_JP.decode(s.as_ref(), trap);
+                let b = ISO_2022_JP.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "utf-16be" => {
-                let b = UTF_16BE.decode(s.as_ref(), trap);
+                let b = UTF_16BE.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "utf-16le" => {
-                let b = UTF_16LE.decode(s.as_ref(), trap);
+                let b = UTF_16LE.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "x-user-defined" => {
-                let b = X_USER_DEFINED.decode(s.as_ref(), trap);
+                let b = X_USER_DEFINED.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "ibm866" => {
-                let b = IBM866.decode(s.as_ref(), trap);
+                let b = IBM866.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-2" => {
-                let b = ISO_8859_2.decode(s.as_ref(), trap);
+                let b = ISO_8859_2.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-3" => {
-                let b = ISO_8859_3.decode(s.as_ref(), trap);
+                let b = ISO_8859_3.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-4" => {
-                let b = ISO_8859_4.decode(s.as_ref(), trap);
+                let b = ISO_8859_4.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-5" => {
-                let b = ISO_8859_5.decode(s.as_ref(), trap);
+                let b = ISO_8859_5.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-6" => {
-                let b = ISO_8859_6.decode(s.as_ref(), trap);
+                let b = ISO_8859_6.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-7" => {
-                let b = ISO_8859_7.decode(s.as_ref(), trap);
+                let b = ISO_8859_7.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-8" => {
-                let b = ISO_8859_8.decode(s.as_ref(), trap);
+                let b = ISO_8859_8.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-8i" => {
-                let b = ISO_8859_8_I.decode(s.as_ref(), trap);
+                let b = ISO_8859_8_I.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-10" => {
-                let b = ISO_8859_10.decode(s.as_ref(), trap);
+                let b = ISO_8859_10.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-13" => {
-                let b = ISO_8859_13.decode(s.as_ref(), trap);
+                let b = ISO_8859_13.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-14" => {
-                let b = ISO_8859_14.decode(s.as_ref(), trap);
+                let b = ISO_8859_14.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-15" => {
-                let b = ISO_8859_15.decode(s.as_ref(), trap);
+                let b = ISO_8859_15.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "iso-8859-16" => {
-                let b = ISO_8859_16.decode(s.as_ref(), trap);
+                let b = ISO_8859_16.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-874" => {
-                let b = WINDOWS_874.decode(s.as_ref(), trap);
+                let b = WINDOWS_874.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1250" => {
-                let b = WINDOWS_1250.decode(s.as_ref(), trap);
+                let b = WINDOWS_1250.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1251" => {
-                let b = WINDOWS_1251.decode(s.as_ref(), trap);
+                let b = WINDOWS_1251.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1252" => {
-                let b = WINDOWS_1252.decode(s.as_ref(), trap);
+                let b = WINDOWS_1252.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1253" => {
-                let b = WINDOWS_1253.decode(s.as_ref(), trap);
+                let b = WINDOWS_1253.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1254" => {
-                let b = WINDOWS_1254.decode(s.as_ref(), trap);
+                let b = WINDOWS_1254.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1255" => {
-                let b = WINDOWS_1255.decode(s.as_ref(), trap);
+                let b = WINDOWS_1255.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1256" => {
-                let b = WINDOWS_1256.decode(s.as_ref(), trap);
+                let b = WINDOWS_1256.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1257" => {
-                let b = WINDOWS_1257.decode(s.as_ref(), trap);
+                let b = WINDOWS_1257.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             "windows-1258" => {
-                let b = WINDOWS_1258.decode(s.as_ref(), trap);
+                let b = WINDOWS_1258.decode(s, trap);
                 ret_to_js(ctx, b)
             }
             _ => JsValue::UnDefined,
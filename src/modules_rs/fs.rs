@@ -72,11 +72,11 @@ fn stat_to_js_object(ctx: &mut Context, stat: wasi_fs::Filestat) -> JsValue {
     JsValue::Object(res)
 }
 
-fn err_to_js_object(ctx: &mut Context, e: io::Error) -> JsValue {
+pub(crate) fn err_to_js_object(ctx: &mut Context, e: io::Error) -> JsValue {
     errno_to_js_object(ctx, wasi_fs::Errno(e.raw_os_error().unwrap() as u16))
 }
 
-fn errno_to_js_object(ctx: &mut Context, e: wasi_fs::Errno) -> JsValue {
+pub(crate) fn errno_to_js_object(ctx: &mut Context, e: wasi_fs::Errno) -> JsValue {
     let mut res = ctx.new_object();
     res.set("message", JsValue::String(ctx.new_string(e.message())));
     res.set("code", JsValue::String(ctx.new_string(e.name())));
@@ -888,32 +888,54 @@ struct FS;
 
 impl ModuleInit for FS {
     fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
-        let stat_s = ctx.wrap_function("statSync", stat_sync);
-        let lstat_s = ctx.wrap_function("lstatSync", lstat_sync);
-        let fstat_s = ctx.wrap_function("fstatSync", fstat_sync);
-        let mkdir_s = ctx.wrap_function("mkdirSync", mkdir_sync);
-        let rmdir_s = ctx.wrap_function("rmdirSync", rmdir_sync);
-        let rm_s = ctx.wrap_function("rmSync", rm_sync);
-        let rename_s = ctx.wrap_function("renameSync", rename_sync);
-        let truncate_s = ctx.wrap_function("truncateSync", truncate_sync);
-        let ftruncate_s = ctx.wrap_function("ftruncateSync", ftruncate_sync);
-        let realpath_s = ctx.wrap_function("realpathSync", realpath_sync);
-        let copy_file_s = ctx.wrap_function("copyFileSync", copy_file_sync);
-        let link_s = ctx.wrap_function("linkSync", link_sync);
-        let symlink_s = ctx.wrap_function("symlinkSync", symlink_sync);
-        let utime_s = ctx.wrap_function("utimeSync", utime_sync);
-        let lutime_s = ctx.wrap_function("lutimeSync", lutime_sync);
-        let futime_s = ctx.wrap_function("futimeSync", futime_sync);
-        let fclose_s = ctx.wrap_function("fcloseSync", fclose_sync);
-        let fsync_s = ctx.wrap_function("fsyncSync", fsync_sync);
-        let fdatasync_s = ctx.wrap_function("fdatasyncSync", fdatasync_sync);
-        let fread_s = ctx.wrap_function("freadSync", fread_sync);
-        let fread_a = ctx.wrap_function("fread", fread);
-        let open_s = ctx.wrap_function("openSync", open_sync);
-        let readlink_s = ctx.wrap_function("readlinkSync", readlink_sync);
-        let fwrite_s = ctx.wrap_function("fwriteSync", fwrite_sync);
-        let fwrite_a = ctx.wrap_function("fwrite", fwrite);
-        let freaddir_s = ctx.wrap_function("freaddirSync", freaddir_sync);
+        let stat_s = ctx.wrap_function("statSync", traced_fn!("statSync", "fs", stat_sync));
+        let lstat_s = ctx.wrap_function("lstatSync", traced_fn!("lstatSync", "fs", lstat_sync));
+        let fstat_s = ctx.wrap_function("fstatSync", traced_fn!("fstatSync", "fs", fstat_sync));
+        let mkdir_s = ctx.wrap_function("mkdirSync", traced_fn!("mkdirSync", "fs", mkdir_sync));
+        let rmdir_s = ctx.wrap_function("rmdirSync", traced_fn!("rmdirSync", "fs", rmdir_sync));
+        let rm_s = ctx.wrap_function("rmSync", traced_fn!("rmSync", "fs", rm_sync));
+        let rename_s = ctx.wrap_function("renameSync", traced_fn!("renameSync", "fs", rename_sync));
+        let truncate_s = ctx.wrap_function(
+            "truncateSync",
+            traced_fn!("truncateSync", "fs", truncate_sync),
+        );
+        let ftruncate_s = ctx.wrap_function(
+            "ftruncateSync",
+            traced_fn!("ftruncateSync", "fs", ftruncate_sync),
+        );
+        let realpath_s = ctx.wrap_function(
+            "realpathSync",
+            traced_fn!("realpathSync", "fs", realpath_sync),
+        );
+        let copy_file_s = ctx.wrap_function(
+            "copyFileSync",
+            traced_fn!("copyFileSync", "fs", copy_file_sync),
+        );
+        let link_s = ctx.wrap_function("linkSync", traced_fn!("linkSync", "fs", link_sync));
+        let symlink_s =
+            ctx.wrap_function("symlinkSync", traced_fn!("symlinkSync", "fs", symlink_sync));
+        let utime_s = ctx.wrap_function("utimeSync", traced_fn!("utimeSync", "fs", utime_sync));
+        let lutime_s = ctx.wrap_function("lutimeSync", traced_fn!("lutimeSync", "fs", lutime_sync));
+        let futime_s = ctx.wrap_function("futimeSync", traced_fn!("futimeSync", "fs", futime_sync));
+        let fclose_s = ctx.wrap_function("fcloseSync", traced_fn!("fcloseSync", "fs", fclose_sync));
+        let fsync_s = ctx.wrap_function("fsyncSync", traced_fn!("fsyncSync", "fs", fsync_sync));
+        let fdatasync_s = ctx.wrap_function(
+            "fdatasyncSync",
+            traced_fn!("fdatasyncSync", "fs", fdatasync_sync),
+        );
+        let fread_s = ctx.wrap_function("freadSync", traced_fn!("freadSync", "fs", fread_sync));
+        let fread_a = ctx.wrap_function("fread", traced_fn!("fread", "fs", fread));
+        let open_s = ctx.wrap_function("openSync", traced_fn!("openSync", "fs", open_sync));
+        let readlink_s = ctx.wrap_function(
+            "readlinkSync",
+            traced_fn!("readlinkSync", "fs", readlink_sync),
+        );
+        let fwrite_s = ctx.wrap_function("fwriteSync", traced_fn!("fwriteSync", "fs", fwrite_sync));
+        let fwrite_a = ctx.wrap_function("fwrite", traced_fn!("fwrite", "fs", fwrite));
+        let freaddir_s = ctx.wrap_function(
+            "freaddirSync",
+            traced_fn!("freaddirSync", "fs", freaddir_sync),
+        );
         m.add_export("statSync", stat_s.into());
         m.add_export("lstatSync", lstat_s.into());
         m.add_export("fstatSync", fstat_s.into());
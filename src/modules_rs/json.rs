@@ -0,0 +1,910 @@
+// Streaming JSON parsing for drop:json. Input arrives in chunks, written
+// from JS or read straight from an fd, and values are built as QuickJS
+// values while their tokens complete, so a large document is never held
+// as one string nor as one object graph.
+//
+// Only the values at the chosen path are built. Containers above them are
+// walked without being created, and subtrees off the path are skipped by
+// a structural scan that classifies 64 bytes per step, with `+simd128`,
+// and tracks strings and escapes with bit arithmetic instead of a byte
+// loop. Skipped subtrees are only checked for balanced brackets.
+
+use super::buffer::bytes_ref_arg;
+use super::encoding::decode_utf8;
+use super::fs::err_to_js_object;
+use crate::quickjs_sys::*;
+use memchr::memchr;
+use std::convert::TryInto;
+use std::fs::File;
+use std::io::{self, Read};
+use std::mem::ManuallyDrop;
+use std::os::wasi::io::FromRawFd;
+
+const READ_SIZE: usize = 256 << 10;
+
+/// Quotes, backslashes, opening and closing brackets of a 64 byte block,
+/// one bit per byte.
+#[derive(Clone, Copy, Default)]
+pub struct Masks {
+    quote: u64,
+    backslash: u64,
+    open: u64,
+    close: u64,
+}
+
+#[cfg(target_feature = "simd128")]
+mod simd {
+    use super::Masks;
+    use core::arch::wasm32::*;
+
+    #[inline]
+    unsafe fn load(p: *const u8) -> v128 {
+        v128_load(p as *const v128)
+    }
+
+    #[inline]
+    fn eq(v: v128, b: u8) -> v128 {
+        u8x16_eq(v, u8x16_splat(b))
+    }
+
+    /// Index of the first `"`, `\` or control character, or `bytes.len()`.
+    #[inline]
+    pub fn string_run(bytes: &[u8]) -> usize {
+        let mut i = 0;
+        while i + 16 <= bytes.len() {
+            let v = unsafe { load(bytes.as_ptr().add(i)) };
+            let special = v128_or(
+                v128_or(eq(v, b'"'), eq(v, b'\\')),
+                u8x16_lt(v, u8x16_splat(0x20)),
+            );
+            let mask = u8x16_bitmask(special);
+            if mask != 0 {
+                return i + mask.trailing_zeros() as usize;
+            }
+            i += 16;
+        }
+        i + super::scalar::string_run(&bytes[i..])
+    }
+
+    #[inline]
+    pub fn masks(block: &[u8; 64]) -> Masks {
+        let mut m = Masks::default();
+        for k in 0..4 {
+            let v = unsafe { load(block.as_ptr().add(16 * k)) };
+            // `{` and `[` differ only in bit 5, and so do `}` and `]`
+            let folded = v128_or(v, u8x16_splat(0x20));
+            let shift = 16 * k;
+            m.quote |= (u8x16_bitmask(eq(v, b'"')) as u64) << shift;
+            m.backslash |= (u8x16_bitmask(eq(v, b'\\')) as u64) << shift;
+            m.open |= (u8x16_bitmask(eq(folded, b'{')) as u64) << shift;
+            m.close |= (u8x16_bitmask(eq(folded, b'}')) as u64) << shift;
+        }
+        m
+    }
+}
+
+// also the tails of the SIMD loops
+#[allow(dead_code)]
+mod scalar {
+    use super::Masks;
+
+    pub fn string_run(bytes: &[u8]) -> usize {
+        bytes
+            .iter()
+            .position(|&b| b == b'"' || b == b'\\' || b < 0x20)
+            .unwrap_or(bytes.len())
+    }
+
+    pub fn masks(block: &[u8; 64]) -> Masks {
+        let mut m = Masks::default();
+        for (i, &b) in block.iter().enumerate() {
+            let bit = 1 << i;
+            match b {
+                b'"' => m.quote |= bit,
+                b'\\' => m.backslash |= bit,
+                b'{' | b'[' => m.open |= bit,
+                b'}' | b']' => m.close |= bit,
+                _ => {}
+            }
+        }
+        m
+    }
+}
+
+#[cfg(not(target_feature = "simd128"))]
+use scalar as kernels;
+#[cfg(target_feature = "simd128")]
+use simd as kernels;
+
+const ODD_BITS: u64 = 0xAAAA_AAAA_AAAA_AAAA;
+
+/// Bit i set when an odd number of bits at or below i are.
+fn prefix_xor(mut x: u64) -> u64 {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    x
+}
+
+/// Where the scan of a skipped container stands between blocks.
+#[derive(Clone, Copy, Default)]
+struct SkipState {
+    depth: usize,
+    /// All ones when the previous block ended inside a string.
+    in_string: u64,
+    /// 1 when the previous block ended in an unescaped backslash.
+    escape_carry: u64,
+}
+
+impl SkipState {
+    /// The characters escaped by a backslash. Subtracting the backslashes
+    /// from their shifted selves over the odd bits marks where each run
+    /// of them ends, and from that which runs have odd length.
+    fn escaped(&mut self, backslash: u64) -> u64 {
+        if backslash == 0 {
+            return std::mem::take(&mut self.escape_carry);
+        }
+        let potential = backslash & !self.escape_carry;
+        let codes = ((potential << 1 | ODD_BITS).wrapping_sub(potential)) ^ ODD_BITS;
+        let escaped = codes ^ (backslash | self.escape_carry);
+        self.escape_carry = (codes & backslash) >> 63;
+        escaped
+    }
+
+    /// Feeds the masks of the next block, the offset just past the close
+    /// of the container when it is in the block.
+    fn block(&mut self, m: Masks) -> Option<usize> {
+        let escaped = self.escaped(m.backslash);
+        let quotes = m.quote & !escaped;
+        let in_string = prefix_xor(quotes) ^ self.in_string;
+        self.in_string = ((in_string as i64) >> 63) as u64;
+        let mut brackets = (m.open | m.close) & !in_string;
+        while brackets != 0 {
+            let i = brackets.trailing_zeros() as usize;
+            if m.open >> i & 1 != 0 {
+                self.depth += 1;
+            } else {
+                self.depth -= 1;
+                if self.depth == 0 {
+                    return Some(i + 1);
+                }
+            }
+            brackets &= brackets - 1;
+        }
+        None
+    }
+}
+
+/// Skips the container opening at `buf[start]`. `Ok` with the offset past
+/// its close, or `Err` with the block boundary to resume from once more
+/// input has arrived, `state` carrying the scan over.
+fn skip_container(buf: &[u8], start: usize, state: &mut SkipState) -> Result<usize, usize> {
+    let mut i = start;
+    while i + 64 <= buf.len() {
+        if let Some(n) = state.block(kernels::masks(buf[i..i + 64].try_into().unwrap())) {
+            return Ok(i + n);
+        }
+        i += 64;
+    }
+    // the tail only counts when the container ends in it, it is scanned
+    // again as part of a full block otherwise
+    let mut tail = [b' '; 64];
+    tail[..buf.len() - i].copy_from_slice(&buf[i..]);
+    let mut tail_state = *state;
+    match tail_state.block(kernels::masks(&tail)) {
+        Some(n) => Ok(i + n),
+        None => Err(i),
+    }
+}
+
+pub enum Number {
+    Int(i32),
+    Float(f64),
+}
+
+/// Where an emitted value was: its index or key in its container.
+pub enum Key {
+    Root,
+    Index(u32),
+    Name(String),
+}
+
+/// How the parser creates values, JS values in drop.
+pub trait Values {
+    type Value;
+    fn string(&mut self, utf8: &[u8]) -> Self::Value;
+    fn number(&mut self, n: Number) -> Self::Value;
+    fn bool(&mut self, b: bool) -> Self::Value;
+    fn null(&mut self) -> Self::Value;
+    fn object(&mut self) -> Self::Value;
+    fn array(&mut self) -> Self::Value;
+    fn push(&mut self, array: &mut Self::Value, index: u32, v: Self::Value);
+    fn insert(&mut self, object: &mut Self::Value, key: &str, v: Self::Value);
+    /// The `[key, value]` form of an emitted value.
+    fn entry(&mut self, key: Key, v: Self::Value) -> Self::Value;
+}
+
+/// One step of the path to the values to emit.
+pub enum Segment {
+    Any,
+    Key(String, Option<u32>),
+}
+
+impl Segment {
+    pub fn key(key: String) -> Self {
+        let index = key.parse().ok().filter(|_| !key.starts_with('+'));
+        Segment::Key(key, index)
+    }
+}
+
+#[derive(Clone, Copy)]
+enum Expect {
+    ValueOrEnd,
+    Value,
+    KeyOrEnd,
+    Key,
+    Colon,
+    CommaOrEnd,
+}
+
+struct Frame<V> {
+    /// The container being built, none for one only walked through.
+    value: Option<V>,
+    array: bool,
+    index: u32,
+    key: Option<String>,
+    expect: Expect,
+}
+
+impl<V> Frame<V> {
+    fn new(value: Option<V>, array: bool) -> Self {
+        Frame {
+            value,
+            array,
+            index: 0,
+            key: None,
+            expect: if array {
+                Expect::ValueOrEnd
+            } else {
+                Expect::KeyOrEnd
+            },
+        }
+    }
+}
+
+enum Role {
+    /// Inside a value being built.
+    Build,
+    /// At the path, built and emitted.
+    Emit,
+    /// Above the path, walked through.
+    Walk,
+    /// Off the path.
+    Skip,
+}
+
+enum Stop {
+    More,
+    Syntax(String),
+}
+
+/// A partly lexed string at the parse position.
+#[derive(Clone, Copy)]
+struct StringScan {
+    len: usize,
+    escaped: bool,
+}
+
+pub struct Parser<V> {
+    buf: Vec<u8>,
+    pos: usize,
+    /// Bytes dropped from the front of `buf`, for error positions.
+    consumed: u64,
+    eof: bool,
+    stack: Vec<Frame<V>>,
+    path: Vec<Segment>,
+    /// More than one top level value, NDJSON or concatenated.
+    multi: bool,
+    keys: bool,
+    done: bool,
+    skip: Option<SkipState>,
+    string_scan: Option<StringScan>,
+    scratch: Vec<u8>,
+}
+
+fn is_space(b: u8) -> bool {
+    matches!(b, b' ' | b'\t' | b'\n' | b'\r')
+}
+
+fn valid_number(s: &[u8]) -> bool {
+    let digits = |mut i: usize| {
+        while matches!(s.get(i), Some(b'0'..=b'9')) {
+            i += 1;
+        }
+        i
+    };
+    let mut i = (s.first() == Some(&b'-')) as usize;
+    i = match s.get(i) {
+        Some(b'0') => i + 1,
+        Some(b'1'..=b'9') => digits(i),
+        _ => return false,
+    };
+    if s.get(i) == Some(&b'.') {
+        let end = digits(i + 1);
+        if end == i + 1 {
+            return false;
+        }
+        i = end;
+    }
+    if matches!(s.get(i), Some(b'e' | b'E')) {
+        i += 1;
+        if matches!(s.get(i), Some(b'+' | b'-')) {
+            i += 1;
+        }
+        let end = digits(i);
+        if end == i {
+            return false;
+        }
+        i = end;
+    }
+    i == s.len()
+}
+
+fn to_number(s: &[u8]) -> Number {
+    let text = std::str::from_utf8(s).unwrap();
+    if s.len() <= 11 && !s.iter().any(|b| matches!(b, b'.' | b'e' | b'E')) && text != "-0" {
+        if let Ok(n) = text.parse::<i32>() {
+            return Number::Int(n);
+        }
+    }
+    Number::Float(text.parse().unwrap())
+}
+
+fn hex4(s: &[u8]) -> Option<u32> {
+    if s.len() < 4 {
+        return None;
+    }
+    s[..4].iter().try_fold(0, |n, &b| {
+        let d = (b as char).to_digit(16)?;
+        Some(n << 4 | d)
+    })
+}
+
+/// Appends the string contents `src` to `out` with escapes resolved. Lone
+/// surrogates become U+FFFD, as the string is UTF-8 from here on.
+fn unescape(src: &[u8], out: &mut Vec<u8>) -> Result<(), &'static str> {
+    let mut i = 0;
+    while let Some(n) = memchr(b'\\', &src[i..]) {
+        out.extend_from_slice(&src[i..i + n]);
+        i += n + 2;
+        let b = match src[i - 1] {
+            b'"' => b'"',
+            b'\\' => b'\\',
+            b'/' => b'/',
+            b'b' => 8,
+            b'f' => 12,
+            b'n' => b'\n',
+            b'r' => b'\r',
+            b't' => b'\t',
+            b'u' => {
+                let unit = hex4(&src[i..]).ok_or("Bad Unicode escape in JSON")?;
+                i += 4;
+                let c = match unit {
+                    0xD800..=0xDBFF if src[i..].starts_with(b"\\u") => match hex4(&src[i + 2..]) {
+                        Some(low @ 0xDC00..=0xDFFF) => {
+                            i += 6;
+                            0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00)
+                        }
+                        _ => 0xFFFD,
+                    },
+                    _ => unit,
+                };
+                let c = std::char::from_u32(c).unwrap_or('\u{FFFD}');
+                out.extend_from_slice(c.encode_utf8(&mut [0; 4]).as_bytes());
+                continue;
+            }
+            _ => return Err("Bad escaped character in JSON"),
+        };
+        out.push(b);
+    }
+    out.extend_from_slice(&src[i..]);
+    Ok(())
+}
+
+impl<V> Parser<V> {
+    pub fn new(path: Vec<Segment>, multi: bool, keys: bool) -> Self {
+        Parser {
+            buf: vec![],
+            pos: 0,
+            consumed: 0,
+            eof: false,
+            stack: vec![],
+            path,
+            multi,
+            keys,
+            done: false,
+            skip: None,
+            string_scan: None,
+            scratch: vec![],
+        }
+    }
+
+    /// Drops the parsed part of the buffer.
+    fn compact(&mut self) {
+        if self.pos > 0 {
+            self.buf.drain(..self.pos);
+            self.consumed += self.pos as u64;
+            self.pos = 0;
+        }
+    }
+
+    pub fn feed(&mut self, bytes: &[u8]) {
+        self.compact();
+        self.buf.extend_from_slice(bytes);
+    }
+
+    /// Reads up to `size` more bytes, 0 at the end of the input.
+    pub fn read_from(&mut self, r: &mut impl Read, size: usize) -> io::Result<usize> {
+        self.compact();
+        let start = self.buf.len();
+        self.buf.resize(start + size, 0);
+        let n = loop {
+            match r.read(&mut self.buf[start..]) {
+                Err(e) if e.kind() == io::ErrorKind::Interrupted => continue,
+                r => break r,
+            }
+        };
+        self.buf.truncate(start + n.as_ref().map_or(0, |n| *n));
+        n
+    }
+
+    pub fn end(&mut self) {
+        self.eof = true;
+    }
+
+    fn syntax(&self, msg: &str) -> Stop {
+        Stop::Syntax(format!(
+            "{} at position {}",
+            msg,
+            self.consumed + self.pos as u64
+        ))
+    }
+
+    fn unexpected(&self) -> Stop {
+        match self.buf[self.pos] {
+            c @ 0x21..=0x7E => self.syntax(&format!("Unexpected token {} in JSON", c as char)),
+            _ => self.syntax("Unexpected token in JSON"),
+        }
+    }
+
+    /// Parses what the buffer holds, pushing the values finished on the
+    /// way to `out`.
+    pub fn run<B: Values<Value = V>>(&mut self, b: &mut B, out: &mut Vec<V>) -> Result<(), String> {
+        loop {
+            match self.step(b, out) {
+                Ok(()) => {}
+                Err(Stop::More) => break,
+                Err(Stop::Syntax(msg)) => return Err(msg),
+            }
+        }
+        let pending = self.pos < self.buf.len() || !self.stack.is_empty() || self.skip.is_some();
+        if self.eof && (pending || !(self.done || self.multi)) {
+            return Err("Unexpected end of JSON input".to_string());
+        }
+        Ok(())
+    }
+
+    fn step<B: Values<Value = V>>(&mut self, b: &mut B, out: &mut Vec<V>) -> Result<(), Stop> {
+        if let Some(state) = &mut self.skip {
+            match skip_container(&self.buf, self.pos, state) {
+                Ok(end) => {
+                    self.pos = end;
+                    self.skip = None;
+                    return self.finish(b, out, None);
+                }
+                Err(resume) => {
+                    self.pos = resume;
+                    return Err(Stop::More);
+                }
+            }
+        }
+        if self.string_scan.is_none() {
+            while self.pos < self.buf.len() && is_space(self.buf[self.pos]) {
+                self.pos += 1;
+            }
+        }
+        if self.pos == self.buf.len() {
+            return Err(Stop::More);
+        }
+        let c = self.buf[self.pos];
+        let expect = match self.stack.last() {
+            Some(frame) => frame.expect,
+            None if self.done && !self.multi => return Err(self.unexpected()),
+            None => Expect::Value,
+        };
+        match (expect, c) {
+            (Expect::ValueOrEnd, b']') | (Expect::KeyOrEnd, b'}') => self.close(b, out),
+            (Expect::ValueOrEnd, _) | (Expect::Value, _) => self.value(b, out),
+            (Expect::KeyOrEnd, b'"') | (Expect::Key, b'"') => {
+                let key = self.lex_string()?;
+                let key = String::from_utf8_lossy(self.contents(key)?).into_owned();
+                let frame = self.stack.last_mut().unwrap();
+                frame.key = Some(key);
+                frame.expect = Expect::Colon;
+                Ok(())
+            }
+            (Expect::Colon, b':') => {
+                self.pos += 1;
+                self.stack.last_mut().unwrap().expect = Expect::Value;
+                Ok(())
+            }
+            (Expect::CommaOrEnd, b',') => {
+                self.pos += 1;
+                let frame = self.stack.last_mut().unwrap();
+                frame.expect = if frame.array {
+                    Expect::Value
+                } else {
+                    Expect::Key
+                };
+                Ok(())
+            }
+            (Expect::CommaOrEnd, b']') if self.stack.last().unwrap().array => self.close(b, out),
+            (Expect::CommaOrEnd, b'}') if !self.stack.last().unwrap().array => self.close(b, out),
+            _ => Err(self.unexpected()),
+        }
+    }
+
+    fn role(&self) -> Role {
+        let depth = self.stack.len();
+        match self.stack.last() {
+            Some(frame) if frame.value.is_some() => Role::Build,
+            Some(frame) if !self.matches(frame) => Role::Skip,
+            _ if depth == self.path.len() => Role::Emit,
+            _ => Role::Walk,
+        }
+    }
+
+    /// Whether the next value of `frame`, the innermost one, is on the path.
+    fn matches(&self, frame: &Frame<V>) -> bool {
+        match &self.path[self.stack.len() - 1] {
+            Segment::Any => true,
+            Segment::Key(_, index) if frame.array => *index == Some(frame.index),
+            Segment::Key(key, _) => frame.key.as_ref() == Some(key),
+        }
+    }
+
+    fn value<B: Values<Value = V>>(&mut self, b: &mut B, out: &mut Vec<V>) -> Result<(), Stop> {
+        let role = self.role();
+        let build = matches!(role, Role::Build | Role::Emit);
+        let v = match self.buf[self.pos] {
+            c @ b'{' | c @ b'[' => {
+                let array = c == b'[';
+                match role {
+                    Role::Skip => self.skip = Some(SkipState::default()),
+                    Role::Walk => {
+                        self.pos += 1;
+                        self.stack.push(Frame::new(None, array));
+                    }
+                    Role::Build | Role::Emit => {
+                        self.pos += 1;
+                        let v = if array { b.array() } else { b.object() };
+                        self.stack.push(Frame::new(Some(v), array));
+                    }
+                }
+                return Ok(());
+            }
+            b'"' => {
+                let s = self.lex_string()?;
+                if build {
+                    Some(b.string(self.contents(s)?))
+                } else {
+                    None
+                }
+            }
+            b'-' | b'0'..=b'9' => {
+                let rest = &self.buf[self.pos..];
+                let n = rest
+                    .iter()
+                    .position(|c| !matches!(c, b'0'..=b'9' | b'-' | b'+' | b'.' | b'e' | b'E'))
+                    .unwrap_or(rest.len());
+                if n == rest.len() && !self.eof {
+                    return Err(Stop::More);
+                }
+                if !valid_number(&rest[..n]) {
+                    return Err(self.syntax("Unexpected number in JSON"));
+                }
+                let v = build.then(|| b.number(to_number(&rest[..n])));
+                self.pos += n;
+                v
+            }
+            b't' => {
+                self.literal(b"true")?;
+                build.then(|| b.bool(true))
+            }
+            b'f' => {
+                self.literal(b"false")?;
+                build.then(|| b.bool(false))
+            }
+            b'n' => {
+                self.literal(b"null")?;
+                build.then(|| b.null())
+            }
+            _ => return Err(self.unexpected()),
+        };
+        self.finish(b, out, v)
+    }
+
+    fn literal(&mut self, word: &[u8]) -> Result<(), Stop> {
+        let rest = &self.buf[self.pos..];
+        let n = rest.len().min(word.len());
+        if rest[..n] != word[..n] {
+            return Err(self.unexpected());
+        }
+        if n < word.len() {
+            return Err(Stop::More);
+        }
+        self.pos += n;
+        Ok(())
+    }
+
+    /// Lexes the string at the parse position, the range of its contents
+    /// and whether it has escapes.
+    fn lex_string(&mut self) -> Result<(usize, usize, bool), Stop> {
+        let (mut i, mut escaped) = match self.string_scan.take() {
+            Some(scan) => (self.pos + scan.len, scan.escaped),
+            None => (self.pos + 1, false),
+        };
+        loop {
+            i += kernels::string_run(&self.buf[i..]);
+            match self.buf.get(i) {
+                Some(b'"') => {
+                    let start = self.pos + 1;
+                    self.pos = i + 1;
+                    return Ok((start, i, escaped));
+                }
+                Some(b'\\') if i + 1 < self.buf.len() => {
+                    escaped = true;
+                    i += 2;
+                }
+                Some(b'\\') | None => {
+                    let len = i - self.pos;
+                    self.string_scan = Some(StringScan { len, escaped });
+                    return Err(Stop::More);
+                }
+                Some(_) => {
+                    self.pos = i;
+                    return Err(self.syntax("Bad control character in string literal in JSON"));
+                }
+            }
+        }
+    }
+
+    /// The UTF-8 contents of a lexed string.
+    fn contents(&mut self, (start, end, escaped): (usize, usize, bool)) -> Result<&[u8], Stop> {
+        if !escaped {
+            return Ok(&self.buf[start..end]);
+        }
+        self.scratch.clear();
+        if let Err(msg) = unescape(&self.buf[start..end], &mut self.scratch) {
+            return Err(self.syntax(msg));
+        }
+        Ok(&self.scratch)
+    }
+
+    fn close<B: Values<Value = V>>(&mut self, b: &mut B, out: &mut Vec<V>) -> Result<(), Stop> {
+        self.pos += 1;
+        let frame = self.stack.pop().unwrap();
+        self.finish(b, out, frame.value)
+    }
+
+    /// Puts a finished value, if it was built, into its container or out.
+    fn finish<B: Values<Value = V>>(
+        &mut self,
+        b: &mut B,
+        out: &mut Vec<V>,
+        v: Option<V>,
+    ) -> Result<(), Stop> {
+        let parent = match self.stack.last_mut() {
+            Some(parent) => parent,
+            None => {
+                self.done = true;
+                if let Some(v) = v {
+                    out.push(if self.keys { b.entry(Key::Root, v) } else { v });
+                }
+                return Ok(());
+            }
+        };
+        if let Some(v) = v {
+            match &mut parent.value {
+                Some(container) if parent.array => b.push(container, parent.index, v),
+                Some(container) => b.insert(container, parent.key.as_deref().unwrap_or(""), v),
+                None if self.keys => {
+                    let key = if parent.array {
+                        Key::Index(parent.index)
+                    } else {
+                        Key::Name(parent.key.take().unwrap_or_default())
+                    };
+                    out.push(b.entry(key, v));
+                }
+                None => out.push(v),
+            }
+        }
+        if parent.array {
+            parent.index += 1;
+        }
+        parent.expect = Expect::CommaOrEnd;
+        Ok(())
+    }
+}
+
+struct JsValues<'a>(&'a mut Context);
+
+impl Values for JsValues<'_> {
+    type Value = JsValue;
+
+    fn string(&mut self, utf8: &[u8]) -> JsValue {
+        decode_utf8(self.0, utf8, false, true)
+    }
+
+    fn number(&mut self, n: Number) -> JsValue {
+        match n {
+            Number::Int(n) => JsValue::Int(n),
+            Number::Float(n) => JsValue::Float(n),
+        }
+    }
+
+    fn bool(&mut self, b: bool) -> JsValue {
+        JsValue::Bool(b)
+    }
+
+    fn null(&mut self) -> JsValue {
+        JsValue::Null
+    }
+
+    fn object(&mut self) -> JsValue {
+        self.0.new_object().into()
+    }
+
+    fn array(&mut self) -> JsValue {
+        self.0.new_array().into()
+    }
+
+    fn push(&mut self, array: &mut JsValue, index: u32, v: JsValue) {
+        if let JsValue::Array(array) = array {
+            array.put(index as usize, v);
+        }
+    }
+
+    fn insert(&mut self, object: &mut JsValue, key: &str, v: JsValue) {
+        if let JsValue::Object(object) = object {
+            object.define(key, v);
+        }
+    }
+
+    fn entry(&mut self, key: Key, v: JsValue) -> JsValue {
+        let key = match key {
+            Key::Root => JsValue::Null,
+            Key::Index(i) => JsValue::Int(i as i32),
+            Key::Name(name) => self.0.new_string(&name).into(),
+        };
+        let mut entry = self.0.new_array();
+        entry.put(0, key);
+        entry.put(1, v);
+        entry.into()
+    }
+}
+
+pub struct JsonParser(Parser<JsValue>);
+
+/// Runs the parser on its buffer, the array of the values finished.
+fn run(ctx: &mut Context, parser: &mut Parser<JsValue>) -> JsValue {
+    let mut out = vec![];
+    if let Err(msg) = parser.run(&mut JsValues(ctx), &mut out) {
+        return ctx.throw_syntax_error(&msg.replace('%', "%%")).into();
+    }
+    let mut values = ctx.new_array();
+    for (i, v) in out.into_iter().enumerate() {
+        values.put(i, v);
+    }
+    values.into()
+}
+
+/// `write(arrayBuffer, byteOffset, byteLength)`
+fn write(
+    this: &mut JsonParser,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    this.0.feed(bytes_ref_arg(argv, 0));
+    run(ctx, &mut this.0)
+}
+
+fn end(
+    this: &mut JsonParser,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    this.0.end();
+    run(ctx, &mut this.0)
+}
+
+/// `readFd(fd)`, the values finished by the next read of `fd`, or null
+/// at its end. The data goes from the fd to the parser without a JS copy.
+fn read_fd(
+    this: &mut JsonParser,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let fd = match argv.get(0) {
+        Some(JsValue::Int(fd)) if *fd >= 0 => *fd,
+        _ => {
+            return ctx
+                .throw_type_error("fd must be a non-negative integer")
+                .into()
+        }
+    };
+    let mut file = ManuallyDrop::new(unsafe { File::from_raw_fd(fd as _) });
+    match this.0.read_from(&mut *file, READ_SIZE) {
+        Ok(0) => JsValue::Null,
+        Ok(_) => run(ctx, &mut this.0),
+        Err(e) => {
+            let err = err_to_js_object(ctx, e);
+            ctx.throw_error(err).into()
+        }
+    }
+}
+
+impl JsClassDef for JsonParser {
+    type RefType = JsonParser;
+
+    const CLASS_NAME: &'static str = "JsonParser";
+    const CONSTRUCTOR_ARGC: u8 = 3;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] =
+        &[("write", 3, write), ("end", 0, end), ("readFd", 1, read_fd)];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// `new JsonParser(path, multi, keys)`, with the path a list of keys
+    /// and nulls for any key, as json.js builds it.
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let path = match argv.get(0) {
+            Some(JsValue::Array(path)) => path.to_vec().map_err(JsValue::from)?,
+            _ => return Err(ctx.throw_type_error("path must be an array").into()),
+        };
+        let path = path
+            .into_iter()
+            .map(|segment| match segment {
+                JsValue::String(key) => Segment::key(key.to_string()),
+                _ => Segment::Any,
+            })
+            .collect();
+        let multi = matches!(argv.get(1), Some(JsValue::Bool(true)));
+        let keys = matches!(argv.get(2), Some(JsValue::Bool(true)));
+        Ok(JsonParser(Parser::new(path, multi, keys)))
+    }
+}
+
+struct JsonModule;
+
+impl ModuleInit for JsonModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let class_ctor = register_class::<JsonParser>(ctx);
+        m.add_export("JsonParser\0", class_ctor);
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module("_drop:json\0", JsonModule, &["JsonParser\0"])
+}
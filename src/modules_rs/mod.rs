@@ -1,6 +1,20 @@
+pub mod buffer;
+pub mod cipher;
 pub mod core;
+pub mod crypto;
 pub mod encoding;
 pub mod fs;
+pub mod json;
 pub mod os;
+pub mod perf_hooks;
+pub mod process;
+pub mod querystring;
+pub mod random;
+pub mod string_decoder;
 pub mod sys;
+pub mod tar;
 pub mod tty;
+pub mod url;
+pub mod utf8;
+pub mod worker_threads;
+pub mod zlib;
@@ -7,15 +7,34 @@ fn memory_size(_ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsV
     JsValue::Int(arch::wasm32::memory_size::<0>() as i32)
 }
 
+fn allocator_stats(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    match ctx.allocator_stats() {
+        Some((name, stats)) => {
+            let mut obj = ctx.new_object();
+            obj.set("allocator", ctx.new_string(name).into());
+            obj.set("allocCount", JsValue::Float(stats.alloc_count as f64));
+            obj.set("freeCount", JsValue::Float(stats.free_count as f64));
+            obj.set("reallocCount", JsValue::Float(stats.realloc_count as f64));
+            obj.set("liveBytes", JsValue::Float(stats.live_bytes as f64));
+            obj.set("peakBytes", JsValue::Float(stats.peak_bytes as f64));
+            obj.set("reservedBytes", JsValue::Float(stats.reserved_bytes as f64));
+            obj.into()
+        }
+        None => JsValue::Null,
+    }
+}
+
 struct OS;
 
 impl ModuleInit for OS {
     fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
         let f = ctx.wrap_function("_memorySize", memory_size);
         m.add_export("_memorySize\0", f.into());
+        let f = ctx.wrap_function("_allocatorStats", allocator_stats);
+        m.add_export("_allocatorStats\0", f.into());
     }
 }
 
 pub fn init_module(ctx: &mut Context) {
-    ctx.register_module("_node:os\0", OS, &["_memorySize\0"])
+    ctx.register_module("_node:os\0", OS, &["_memorySize\0", "_allocatorStats\0"])
 }
@@ -0,0 +1,133 @@
+use crate::quickjs_sys::*;
+use std::time::Duration;
+
+fn now(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    match ctx.event_loop() {
+        Some(event_loop) => JsValue::Float(event_loop.metrics().now_ms()),
+        None => JsValue::Float(0.0),
+    }
+}
+
+fn time_origin(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    match ctx.event_loop() {
+        Some(event_loop) => JsValue::Float(event_loop.metrics().time_origin_ms()),
+        None => JsValue::Float(0.0),
+    }
+}
+
+/// `[idle, active]` in milliseconds since the time origin.
+fn elu(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let (idle, now) = match ctx.event_loop() {
+        Some(event_loop) => {
+            let metrics = event_loop.metrics();
+            (metrics.idle_ms(), metrics.now_ms())
+        }
+        None => (0.0, 0.0),
+    };
+    let mut arr = ctx.new_array();
+    arr.put(0, JsValue::Float(idle));
+    arr.put(1, JsValue::Float((now - idle).max(0.0)));
+    arr.into()
+}
+
+fn eld_enable(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let resolution = match argv.get(0) {
+        Some(JsValue::Int(ms)) => *ms as f64,
+        Some(JsValue::Float(ms)) => *ms,
+        _ => 10.0,
+    };
+    if !(resolution >= 1.0) {
+        return ctx.throw_range_error("resolution must be >= 1").into();
+    }
+    if let Some(event_loop) = ctx.event_loop() {
+        event_loop
+            .metrics()
+            .enable_delay_monitor(Duration::from_secs_f64(resolution / 1000.0));
+    }
+    JsValue::UnDefined
+}
+
+fn eld_disable(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    if let Some(event_loop) = ctx.event_loop() {
+        event_loop.metrics().disable_delay_monitor();
+    }
+    JsValue::UnDefined
+}
+
+fn eld_reset(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    if let Some(event_loop) = ctx.event_loop() {
+        event_loop.metrics().delay.reset();
+    }
+    JsValue::UnDefined
+}
+
+/// Summary of the delay histogram, values in nanoseconds as in node.
+fn eld_stats(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let mut obj = ctx.new_object();
+    if let Some(event_loop) = ctx.event_loop() {
+        let h = &event_loop.metrics().delay;
+        obj.set("min", JsValue::Float(h.min() as f64));
+        obj.set("max", JsValue::Float(h.max() as f64));
+        obj.set("mean", JsValue::Float(h.mean()));
+        obj.set("stddev", JsValue::Float(h.stddev()));
+        obj.set("count", JsValue::Float(h.count() as f64));
+    }
+    obj.into()
+}
+
+fn eld_percentile(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let p = match argv.get(0) {
+        Some(JsValue::Int(p)) => *p as f64,
+        Some(JsValue::Float(p)) => *p,
+        _ => f64::NAN,
+    };
+    if !(p > 0.0 && p <= 100.0) {
+        return ctx
+            .throw_range_error("percentile must be > 0 and <= 100")
+            .into();
+    }
+    match ctx.event_loop() {
+        Some(event_loop) => JsValue::Float(event_loop.metrics().delay.percentile(p) as f64),
+        None => JsValue::Float(0.0),
+    }
+}
+
+struct PerfHooks;
+
+impl ModuleInit for PerfHooks {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("now", now);
+        m.add_export("now\0", f.into());
+        let f = ctx.wrap_function("timeOrigin", time_origin);
+        m.add_export("timeOrigin\0", f.into());
+        let f = ctx.wrap_function("elu", elu);
+        m.add_export("elu\0", f.into());
+        let f = ctx.wrap_function("eldEnable", eld_enable);
+        m.add_export("eldEnable\0", f.into());
+        let f = ctx.wrap_function("eldDisable", eld_disable);
+        m.add_export("eldDisable\0", f.into());
+        let f = ctx.wrap_function("eldReset", eld_reset);
+        m.add_export("eldReset\0", f.into());
+        let f = ctx.wrap_function("eldStats", eld_stats);
+        m.add_export("eldStats\0", f.into());
+        let f = ctx.wrap_function("eldPercentile", eld_percentile);
+        m.add_export("eldPercentile\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:perf_hooks\0",
+        PerfHooks,
+        &[
+            "now\0",
+            "timeOrigin\0",
+            "elu\0",
+            "eldEnable\0",
+            "eldDisable\0",
+            "eldReset\0",
+            "eldStats\0",
+            "eldPercentile\0",
+        ],
+    )
+}
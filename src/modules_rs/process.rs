@@ -0,0 +1,50 @@
+use core::arch;
+
+use crate::quickjs_sys::*;
+
+fn memory_usage(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let usage = ctx.memory_usage();
+    // wasm linear memory never shrinks, so its size is the resident set.
+    let rss = arch::wasm32::memory_size::<0>() * 65536;
+    let mut obj = ctx.new_object();
+    obj.set("rss", JsValue::Float(rss as f64));
+    obj.set(
+        "heapTotal",
+        JsValue::Float(usage.malloc_size.max(usage.memory_used_size) as f64),
+    );
+    obj.set("heapUsed", JsValue::Float(usage.memory_used_size as f64));
+    obj.set("external", JsValue::Float(usage.binary_object_size as f64));
+    obj.set("arrayBuffers", JsValue::Float(usage.binary_object_size as f64));
+    obj.set("heapLimit", JsValue::Float(usage.malloc_limit as f64));
+    obj.set("objectCount", JsValue::Float(usage.obj_count as f64));
+    obj.into()
+}
+
+fn rss(_ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    JsValue::Float((arch::wasm32::memory_size::<0>() * 65536) as f64)
+}
+
+fn gc(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    ctx.run_gc();
+    JsValue::UnDefined
+}
+
+pub fn expose_gc(ctx: &mut Context) {
+    let mut global = ctx.get_global();
+    global.set("gc", ctx.wrap_function("gc", gc).into());
+}
+
+struct Process;
+
+impl ModuleInit for Process {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("_memoryUsage", memory_usage);
+        m.add_export("_memoryUsage\0", f.into());
+        let f = ctx.wrap_function("_rss", rss);
+        m.add_export("_rss\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module("_node:process\0", Process, &["_memoryUsage\0", "_rss\0"])
+}
@@ -0,0 +1,328 @@
+// The parse and stringify kernels behind querystring.js and
+// URLSearchParams. Pairs are split and percent-decoded in one pass over
+// the UTF-8 bytes of the input, and a key that repeats is decoded into a
+// property once, with its values gathered in an array.
+
+use super::encoding::decode_utf8;
+use super::utf8;
+use crate::quickjs_sys::*;
+use memchr::{memchr, memchr2, memmem};
+use std::collections::HashMap;
+
+const HEX: &[u8; 16] = b"0123456789ABCDEF";
+
+// Bytes stringify leaves as they are: encodeURIComponent's unreserved set
+// for querystring, the application/x-www-form-urlencoded one for
+// URLSearchParams.
+const QUERYSTRING: u8 = 1;
+const FORM: u8 = 2;
+
+static UNRESERVED: [u8; 256] = unreserved();
+
+const fn unreserved() -> [u8; 256] {
+    let mut table = [0; 256];
+    let mut i = 0;
+    while i < 256 {
+        let b = i as u8;
+        table[i] = match b {
+            b'-' | b'.' | b'_' | b'*' => QUERYSTRING | FORM,
+            b'!' | b'~' | b'\'' | b'(' | b')' => QUERYSTRING,
+            _ if b.is_ascii_alphanumeric() => QUERYSTRING | FORM,
+            _ => 0,
+        };
+        i += 1;
+    }
+    table
+}
+
+fn hex_value(b: u8) -> Option<u8> {
+    match b {
+        b'0'..=b'9' => Some(b - b'0'),
+        b'a'..=b'f' => Some(b - b'a' + 10),
+        b'A'..=b'F' => Some(b - b'A' + 10),
+        _ => None,
+    }
+}
+
+/// Appends `src` to `out` percent-decoded, with `+` read as a space when
+/// `plus` is set. A `%` not followed by two hex digits is kept as is.
+pub(crate) fn percent_decode(src: &[u8], plus: bool, out: &mut Vec<u8>) {
+    out.reserve(src.len());
+    let mut i = 0;
+    loop {
+        let next = if plus {
+            memchr2(b'%', b'+', &src[i..])
+        } else {
+            memchr(b'%', &src[i..])
+        };
+        let at = match next {
+            Some(n) => i + n,
+            None => {
+                out.extend_from_slice(&src[i..]);
+                return;
+            }
+        };
+        out.extend_from_slice(&src[i..at]);
+        if src[at] == b'+' {
+            out.push(b' ');
+            i = at + 1;
+            continue;
+        }
+        let hi = src.get(at + 1).and_then(|&b| hex_value(b));
+        let lo = src.get(at + 2).and_then(|&b| hex_value(b));
+        match (hi, lo) {
+            (Some(hi), Some(lo)) => {
+                out.push(hi << 4 | lo);
+                i = at + 3;
+            }
+            _ => {
+                out.push(b'%');
+                i = at + 1;
+            }
+        }
+    }
+}
+
+/// Appends `src` to `out` percent-encoded, for querystring or, with
+/// `form`, for URLSearchParams, which writes spaces as `+`.
+pub(crate) fn percent_encode(src: &[u8], form: bool, out: &mut Vec<u8>) {
+    let keep = if form { FORM } else { QUERYSTRING };
+    out.reserve(src.len());
+    for &b in src {
+        if UNRESERVED[b as usize] & keep != 0 {
+            out.push(b);
+        } else if form && b == b' ' {
+            out.push(b'+');
+        } else {
+            out.extend_from_slice(&[b'%', HEX[(b >> 4) as usize], HEX[(b & 15) as usize]]);
+        }
+    }
+}
+
+/// Calls `f` with the raw key and value of each non-empty pair of `src`.
+/// With a `max`, only the first `max` pieces between separators are read,
+/// empty ones included, like node does.
+fn for_each_pair(src: &[u8], sep: &[u8], eq: &[u8], max: usize, mut f: impl FnMut(&[u8], &[u8])) {
+    let eq = memmem::Finder::new(eq);
+    let mut pieces = 0;
+    let mut start = 0;
+    let mut seps = memmem::find_iter(src, sep);
+    while start <= src.len() && (max == 0 || pieces < max) {
+        let end = seps.next().unwrap_or(src.len());
+        let pair = &src[start..end];
+        start = end + sep.len().max(1);
+        pieces += 1;
+        if pair.is_empty() {
+            continue;
+        }
+        match eq.find(pair) {
+            Some(i) => f(&pair[..i], &pair[i + eq.needle().len()..]),
+            None => f(pair, &[]),
+        }
+    }
+}
+
+/// The UTF-8 bytes of `s`, borrowed when it is stored as ASCII.
+pub(crate) fn utf8_bytes<'a>(s: &'a JsString, buf: &'a mut Vec<u8>) -> &'a [u8] {
+    match s.data() {
+        JsStringData::Latin1(src) if utf8::ascii_prefix(src) == src.len() => src,
+        JsStringData::Latin1(src) => {
+            buf.resize(utf8::latin1_utf8_len(src), 0);
+            utf8::latin1_to_utf8(src, buf);
+            buf
+        }
+        JsStringData::Utf16(src) => {
+            buf.resize(utf8::utf16_utf8_len(src), 0);
+            utf8::utf16_to_utf8(src, buf);
+            buf
+        }
+    }
+}
+
+fn string_arg(argv: &[JsValue], i: usize) -> Option<&JsString> {
+    match argv.get(i) {
+        Some(JsValue::String(s)) => Some(s),
+        _ => None,
+    }
+}
+
+enum Values {
+    One(JsValue),
+    Many(Vec<JsValue>),
+}
+
+/// `parse(str, sep, eq, maxKeys, target)`, querystring.parse into the
+/// `target` object.
+fn parse(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (src, sep, eq) = match (
+        string_arg(argv, 0),
+        string_arg(argv, 1),
+        string_arg(argv, 2),
+    ) {
+        (Some(src), Some(sep), Some(eq)) => (src, sep, eq),
+        _ => return ctx.throw_type_error("expected strings").into(),
+    };
+    let max = match argv.get(3) {
+        Some(JsValue::Int(n)) if *n > 0 => *n as usize,
+        Some(JsValue::Float(n)) if *n >= 1.0 => *n as usize,
+        _ => 0,
+    };
+    let mut target = match argv.get(4) {
+        Some(JsValue::Object(o)) => o.clone(),
+        _ => ctx.new_object(),
+    };
+    let (mut src_buf, mut sep_buf, mut eq_buf) = (vec![], vec![], vec![]);
+    let src = utf8_bytes(src, &mut src_buf);
+    let sep = utf8_bytes(sep, &mut sep_buf);
+    let eq = utf8_bytes(eq, &mut eq_buf);
+
+    let mut index: HashMap<Vec<u8>, usize> = HashMap::new();
+    let mut entries: Vec<(String, Values)> = vec![];
+    let mut buf = vec![];
+    for_each_pair(src, sep, eq, max, |key, value| {
+        buf.clear();
+        percent_decode(value, true, &mut buf);
+        let value = decode_utf8(ctx, &buf, false, true);
+        buf.clear();
+        percent_decode(key, true, &mut buf);
+        match index.get(&buf[..]) {
+            Some(&i) => {
+                let slot = &mut entries[i].1;
+                *slot = match std::mem::replace(slot, Values::Many(vec![])) {
+                    Values::One(first) => Values::Many(vec![first, value]),
+                    Values::Many(mut values) => {
+                        values.push(value);
+                        Values::Many(values)
+                    }
+                };
+            }
+            None => {
+                index.insert(buf.clone(), entries.len());
+                let key = String::from_utf8_lossy(&buf).into_owned();
+                entries.push((key, Values::One(value)));
+            }
+        }
+    });
+
+    for (key, values) in entries {
+        let value = match values {
+            Values::One(value) => value,
+            Values::Many(values) => {
+                let mut arr = ctx.new_array();
+                for (i, v) in values.into_iter().enumerate() {
+                    arr.put(i, v);
+                }
+                arr.into()
+            }
+        };
+        target.define(&key, value);
+    }
+    JsValue::Object(target)
+}
+
+/// `parsePairs(str)`, the [name, value] list of an
+/// application/x-www-form-urlencoded string.
+fn parse_pairs(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let src = match string_arg(argv, 0) {
+        Some(src) => src,
+        None => return ctx.throw_type_error("expected a string").into(),
+    };
+    let mut src_buf = vec![];
+    let src = utf8_bytes(src, &mut src_buf);
+    let mut list = ctx.new_array();
+    let mut n = 0;
+    let mut buf = vec![];
+    for_each_pair(src, b"&", b"=", 0, |key, value| {
+        let mut pair = ctx.new_array();
+        buf.clear();
+        percent_decode(key, true, &mut buf);
+        pair.put(0, decode_utf8(ctx, &buf, false, true));
+        buf.clear();
+        percent_decode(value, true, &mut buf);
+        pair.put(1, decode_utf8(ctx, &buf, false, true));
+        list.put(n, pair.into());
+        n += 1;
+    });
+    list.into()
+}
+
+/// `stringify([key, value, ...], sep, eq, form)`, the strings of the list
+/// joined into pairs, percent-encoded for querystring or URLSearchParams.
+fn stringify(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let (list, sep, eq) = match (argv.get(0), string_arg(argv, 1), string_arg(argv, 2)) {
+        (Some(JsValue::Array(list)), Some(sep), Some(eq)) => (list, sep, eq),
+        _ => return ctx.throw_type_error("expected a list and strings").into(),
+    };
+    let form = matches!(argv.get(3), Some(JsValue::Bool(true)));
+    let (mut sep_buf, mut eq_buf) = (vec![], vec![]);
+    let sep = utf8_bytes(sep, &mut sep_buf);
+    let eq = utf8_bytes(eq, &mut eq_buf);
+    let mut out = vec![];
+    let mut buf = vec![];
+    for i in 0..list.get_length() {
+        if i > 0 {
+            out.extend_from_slice(if i % 2 == 0 { sep } else { eq });
+        }
+        if let JsValue::String(s) = list.take(i) {
+            percent_encode(utf8_bytes(&s, &mut buf), form, &mut out);
+        }
+    }
+    decode_utf8(ctx, &out, false, true)
+}
+
+/// `escape(str, form)`
+fn escape(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let s = match string_arg(argv, 0) {
+        Some(s) => s,
+        None => return ctx.throw_type_error("expected a string").into(),
+    };
+    let form = matches!(argv.get(1), Some(JsValue::Bool(true)));
+    let mut buf = vec![];
+    let mut out = vec![];
+    percent_encode(utf8_bytes(s, &mut buf), form, &mut out);
+    ctx.new_string_latin1(&out)
+}
+
+/// `unescape(str, decodeSpaces)`
+fn unescape(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let s = match string_arg(argv, 0) {
+        Some(s) => s,
+        None => return ctx.throw_type_error("expected a string").into(),
+    };
+    let plus = matches!(argv.get(1), Some(JsValue::Bool(true)));
+    let mut buf = vec![];
+    let mut out = vec![];
+    percent_decode(utf8_bytes(s, &mut buf), plus, &mut out);
+    decode_utf8(ctx, &out, false, true)
+}
+
+struct QuerystringModule;
+
+impl ModuleInit for QuerystringModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("parse", parse);
+        m.add_export("parse\0", f.into());
+        let f = ctx.wrap_function("parsePairs", parse_pairs);
+        m.add_export("parsePairs\0", f.into());
+        let f = ctx.wrap_function("stringify", stringify);
+        m.add_export("stringify\0", f.into());
+        let f = ctx.wrap_function("escape", escape);
+        m.add_export("escape\0", f.into());
+        let f = ctx.wrap_function("unescape", unescape);
+        m.add_export("unescape\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:querystring\0",
+        QuerystringModule,
+        &[
+            "parse\0",
+            "parsePairs\0",
+            "stringify\0",
+            "escape\0",
+            "unescape\0",
+        ],
+    )
+}
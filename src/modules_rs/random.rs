@@ -0,0 +1,127 @@
+// Random bytes behind crypto.randomBytes, randomFill and randomUUID,
+// exported by `_node:crypto`. Big requests are filled straight from WASI
+// `random_get`. Small ones, UUIDs above all, come from a per thread pool
+// of ChaCha20 keystream seeded by `random_get`, so they don't cost a host
+// call each.
+
+use super::buffer::bytes_arg;
+use super::fs::errno_to_js_object;
+use crate::event_loop::wasi_fs::{self, Errno};
+use crate::quickjs_sys::*;
+use chacha20::ChaCha20;
+use cipher::{KeyIvInit, StreamCipher};
+use std::cell::RefCell;
+
+const POOL_SIZE: usize = 4096;
+/// Largest request served from the pool.
+const POOL_MAX_REQUEST: usize = 256;
+/// Pool output between two seeds.
+const RESEED_AFTER: usize = 1 << 20;
+
+struct Pool {
+    rng: ChaCha20,
+    buf: Box<[u8; POOL_SIZE]>,
+    pos: usize,
+    produced: usize,
+}
+
+fn seeded_rng() -> Result<ChaCha20, Errno> {
+    let mut seed = [0; 44];
+    unsafe { wasi_fs::random_get(&mut seed) }?;
+    let rng = ChaCha20::new(seed[..32].into(), seed[32..].into());
+    seed.fill(0);
+    Ok(rng)
+}
+
+impl Pool {
+    fn new() -> Result<Self, Errno> {
+        Ok(Pool {
+            rng: seeded_rng()?,
+            buf: Box::new([0; POOL_SIZE]),
+            pos: POOL_SIZE,
+            produced: 0,
+        })
+    }
+
+    fn refill(&mut self) -> Result<(), Errno> {
+        if self.produced >= RESEED_AFTER {
+            self.rng = seeded_rng()?;
+            self.produced = 0;
+        }
+        // handed out bytes were zeroed, so this is the bare keystream
+        self.rng.apply_keystream(&mut self.buf[..]);
+        self.pos = 0;
+        self.produced += POOL_SIZE;
+        Ok(())
+    }
+
+    fn fill(&mut self, out: &mut [u8]) -> Result<(), Errno> {
+        let mut done = 0;
+        while done < out.len() {
+            if self.pos == POOL_SIZE {
+                self.refill()?;
+            }
+            let n = (out.len() - done).min(POOL_SIZE - self.pos);
+            let bytes = &mut self.buf[self.pos..self.pos + n];
+            out[done..done + n].copy_from_slice(bytes);
+            // nothing handed out stays behind in memory
+            bytes.fill(0);
+            self.pos += n;
+            done += n;
+        }
+        Ok(())
+    }
+}
+
+thread_local! {
+    static POOL: RefCell<Option<Pool>> = RefCell::new(None);
+}
+
+pub fn fill(out: &mut [u8]) -> Result<(), Errno> {
+    if out.len() > POOL_MAX_REQUEST {
+        return unsafe { wasi_fs::random_get(out) };
+    }
+    POOL.with(|pool| {
+        let mut pool = pool.borrow_mut();
+        if pool.is_none() {
+            *pool = Some(Pool::new()?);
+        }
+        pool.as_mut().unwrap().fill(out)
+    })
+}
+
+fn throw_errno(ctx: &mut Context, e: Errno) -> JsValue {
+    let err = errno_to_js_object(ctx, e);
+    ctx.throw_error(err).into()
+}
+
+/// `randomFill(arrayBuffer, byteOffset, byteLength)`
+pub fn random_fill(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    match fill(bytes_arg(argv, 0)) {
+        Ok(()) => JsValue::UnDefined,
+        Err(e) => throw_errno(ctx, e),
+    }
+}
+
+/// `randomUUID()`, a version 4 UUID string.
+pub fn random_uuid(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let mut b = [0; 16];
+    if let Err(e) = fill(&mut b) {
+        return throw_errno(ctx, e);
+    }
+    b[6] = (b[6] & 0x0f) | 0x40;
+    b[8] = (b[8] & 0x3f) | 0x80;
+    const HEX: &[u8; 16] = b"0123456789abcdef";
+    let mut s = [0; 36];
+    let mut j = 0;
+    for (i, byte) in b.iter().enumerate() {
+        if matches!(i, 4 | 6 | 8 | 10) {
+            s[j] = b'-';
+            j += 1;
+        }
+        s[j] = HEX[(byte >> 4) as usize];
+        s[j + 1] = HEX[(byte & 0xf) as usize];
+        j += 2;
+    }
+    ctx.new_string(std::str::from_utf8(&s).unwrap()).into()
+}
@@ -0,0 +1,302 @@
+// Native state behind string_decoder.js. The few bytes of a character
+// split across chunks are kept in the decoder, and every chunk is decoded
+// from the Buffer's memory straight into a JS string.
+
+use super::buffer::{base64_encode, base64_encoded_len, bytes_ref_arg};
+use super::encoding::decode_utf8;
+use crate::quickjs_sys::*;
+use std::borrow::Cow;
+
+#[derive(Clone, Copy, PartialEq)]
+enum Encoding {
+    Utf8,
+    Utf16le,
+    Base64,
+    Base64url,
+}
+
+/// Output of a chunk before it becomes a JS string.
+enum Decoded<'a> {
+    /// Valid or lossy UTF-8 bytes.
+    Utf8(Cow<'a, [u8]>),
+    Utf16(Vec<u16>),
+    Latin1(Vec<u8>),
+}
+
+pub struct StringDecoder {
+    encoding: Encoding,
+    // at most 3 bytes of UTF-8 or UTF-16, 2 of base64
+    pending: [u8; 4],
+    pending_len: usize,
+}
+
+/// Length of the UTF-8 sequence started by `lead`, 0 if it can't start one.
+fn utf8_seq_len(lead: u8) -> usize {
+    match lead {
+        0xC2..=0xDF => 2,
+        0xE0..=0xEF => 3,
+        0xF0..=0xF4 => 4,
+        _ => 0,
+    }
+}
+
+/// Whether `bytes` are the beginning of a valid character, but not all of it.
+fn is_incomplete(bytes: &[u8]) -> bool {
+    match std::str::from_utf8(bytes) {
+        Err(e) => e.valid_up_to() == 0 && e.error_len().is_none(),
+        Ok(_) => false,
+    }
+}
+
+/// Number of bytes at the end of `buf` holding an incomplete character.
+fn utf8_incomplete_tail(buf: &[u8]) -> usize {
+    for i in 1..=buf.len().min(3) {
+        let b = buf[buf.len() - i];
+        if b < 0x80 {
+            return 0;
+        }
+        if b >= 0xC0 {
+            let tail = &buf[buf.len() - i..];
+            return if utf8_seq_len(b) > i && is_incomplete(tail) {
+                i
+            } else {
+                0
+            };
+        }
+    }
+    0
+}
+
+impl StringDecoder {
+    fn new(encoding: Encoding) -> Self {
+        StringDecoder {
+            encoding,
+            pending: [0; 4],
+            pending_len: 0,
+        }
+    }
+
+    fn stash(&mut self, bytes: &[u8]) {
+        self.pending[..bytes.len()].copy_from_slice(bytes);
+        self.pending_len = bytes.len();
+    }
+
+    fn write<'a>(&mut self, buf: &'a [u8]) -> Decoded<'a> {
+        match self.encoding {
+            Encoding::Utf8 => self.write_utf8(buf),
+            Encoding::Utf16le => self.write_utf16(buf),
+            Encoding::Base64 => self.write_base64(buf, false),
+            Encoding::Base64url => self.write_base64(buf, true),
+        }
+    }
+
+    fn write_utf8<'a>(&mut self, buf: &'a [u8]) -> Decoded<'a> {
+        let mut head = [0; 4];
+        let mut head_len = 0;
+        let mut start = 0;
+        if self.pending_len > 0 {
+            // finish the character begun by the previous chunk first
+            let p = self.pending_len;
+            let take = (utf8_seq_len(self.pending[0]) - p).min(buf.len());
+            let mut c = self.pending;
+            c[p..p + take].copy_from_slice(&buf[..take]);
+            match std::str::from_utf8(&c[..p + take]) {
+                Ok(_) => {
+                    head = c;
+                    head_len = p + take;
+                    start = take;
+                }
+                Err(e) => match e.error_len() {
+                    None => {
+                        self.stash(&c[..p + take]);
+                        return Decoded::Latin1(vec![]);
+                    }
+                    Some(n) => {
+                        // the bytes after the bad sequence are decoded again
+                        head[..3].copy_from_slice("\u{FFFD}".as_bytes());
+                        head_len = 3;
+                        start = n.saturating_sub(p);
+                    }
+                },
+            }
+            self.pending_len = 0;
+        }
+
+        let tail = utf8_incomplete_tail(&buf[start..]);
+        let body = &buf[start..buf.len() - tail];
+        self.stash(&buf[buf.len() - tail..]);
+        if head_len == 0 {
+            return Decoded::Utf8(Cow::Borrowed(body));
+        }
+        let mut bytes = Vec::with_capacity(head_len + body.len());
+        bytes.extend_from_slice(&head[..head_len]);
+        bytes.extend_from_slice(body);
+        Decoded::Utf8(Cow::Owned(bytes))
+    }
+
+    fn write_utf16<'a>(&mut self, buf: &'a [u8]) -> Decoded<'a> {
+        let mut units = Vec::with_capacity((self.pending_len + buf.len()) / 2);
+        let mut pending = &self.pending[..self.pending_len];
+        let mut rest = buf;
+        while pending.len() >= 2 {
+            units.push(u16::from_le_bytes([pending[0], pending[1]]));
+            pending = &pending[2..];
+        }
+        if let (&[lo], Some((&hi, r))) = (pending, rest.split_first()) {
+            units.push(u16::from_le_bytes([lo, hi]));
+            pending = &[];
+            rest = r;
+        }
+        let mut chunks = rest.chunks_exact(2);
+        units.extend((&mut chunks).map(|c| u16::from_le_bytes([c[0], c[1]])));
+        // an odd byte left over from the pending ones, or from `buf`
+        let odd = pending.first().or(chunks.remainder().first()).copied();
+
+        // a lead surrogate waits for its trail
+        let mut stash = [0; 3];
+        let mut n = 0;
+        if let Some(&u) = units.last() {
+            if (0xD800..0xDC00).contains(&u) {
+                units.pop();
+                stash[..2].copy_from_slice(&u.to_le_bytes());
+                n = 2;
+            }
+        }
+        if let Some(b) = odd {
+            stash[n] = b;
+            n += 1;
+        }
+        self.stash(&stash[..n]);
+        Decoded::Utf16(units)
+    }
+
+    fn write_base64<'a>(&mut self, buf: &'a [u8], url: bool) -> Decoded<'a> {
+        let p = self.pending_len;
+        let full = (p + buf.len()) / 3 * 3;
+        if full == 0 {
+            let mut c = self.pending;
+            c[p..p + buf.len()].copy_from_slice(buf);
+            self.stash(&c[..p + buf.len()]);
+            return Decoded::Latin1(vec![]);
+        }
+        let mut out = vec![0; full / 3 * 4];
+        let (mut start, mut at) = (0, 0);
+        if p > 0 {
+            let mut c = self.pending;
+            c[p..3].copy_from_slice(&buf[..3 - p]);
+            base64_encode(&c[..3], &mut out[..4], url);
+            start = 3 - p;
+            at = 4;
+        }
+        let end = full - p;
+        base64_encode(&buf[start..end], &mut out[at..], url);
+        self.stash(&buf[end..]);
+        Decoded::Latin1(out)
+    }
+
+    /// Whatever is left of an incomplete character, the decoder is reset.
+    fn end(&mut self) -> Decoded<'static> {
+        let p = self.pending_len;
+        self.pending_len = 0;
+        match self.encoding {
+            _ if p == 0 => Decoded::Latin1(vec![]),
+            Encoding::Utf8 => Decoded::Utf8(Cow::Borrowed("\u{FFFD}".as_bytes())),
+            Encoding::Utf16le => {
+                // an odd byte is dropped
+                let units = self.pending[..p]
+                    .chunks_exact(2)
+                    .map(|c| u16::from_le_bytes([c[0], c[1]]))
+                    .collect();
+                Decoded::Utf16(units)
+            }
+            Encoding::Base64 | Encoding::Base64url => {
+                let url = self.encoding == Encoding::Base64url;
+                let mut out = vec![0; base64_encoded_len(p, url)];
+                base64_encode(&self.pending[..p], &mut out, url);
+                Decoded::Latin1(out)
+            }
+        }
+    }
+}
+
+fn to_js(ctx: &mut Context, d: Decoded) -> JsValue {
+    match d {
+        Decoded::Utf8(bytes) => decode_utf8(ctx, &bytes, false, true),
+        Decoded::Utf16(units) => ctx.new_string_utf16(&units),
+        Decoded::Latin1(bytes) => ctx.new_string_latin1(&bytes),
+    }
+}
+
+/// `write(arrayBuffer, byteOffset, byteLength)`
+fn write(
+    this: &mut StringDecoder,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let d = this.write(bytes_ref_arg(argv, 0));
+    to_js(ctx, d)
+}
+
+fn end(
+    this: &mut StringDecoder,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    let d = this.end();
+    to_js(ctx, d)
+}
+
+impl JsClassDef for StringDecoder {
+    type RefType = StringDecoder;
+
+    const CLASS_NAME: &'static str = "StringDecoder";
+    const CONSTRUCTOR_ARGC: u8 = 1;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] =
+        &[("write", 3, write), ("end", 0, end)];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// Takes an encoding already normalized by string_decoder.js.
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let encoding = match argv.get(0) {
+            Some(JsValue::String(s)) => match s.to_string().as_str() {
+                "utf8" => Encoding::Utf8,
+                "utf16le" => Encoding::Utf16le,
+                "base64" => Encoding::Base64,
+                "base64url" => Encoding::Base64url,
+                e => {
+                    return Err(ctx
+                        .throw_type_error(&format!("Unknown encoding: {}", e))
+                        .into())
+                }
+            },
+            _ => return Err(ctx.throw_type_error("encoding must be a string").into()),
+        };
+        Ok(StringDecoder::new(encoding))
+    }
+}
+
+struct StringDecoderModule;
+
+impl ModuleInit for StringDecoderModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let class_ctor = register_class::<StringDecoder>(ctx);
+        m.add_export("StringDecoder\0", class_ctor);
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:string_decoder\0",
+        StringDecoderModule,
+        &["StringDecoder\0"],
+    )
+}
@@ -0,0 +1,553 @@
+// Tar archives for drop:tar, on the tar crate. Archives are read from and
+// written to a file or an fd, through gzip when asked, and entry data is
+// copied between the archive and the files natively: only the headers
+// reach JS, for the optional filter callbacks.
+//
+// Entries are written and unpacked here rather than with the crate's
+// `append_path`/`unpack`, which lean on unix metadata and symlink calls
+// that aren't there on WASI.
+
+use super::fs::err_to_js_object;
+use crate::event_loop::wasi_fs;
+use crate::quickjs_sys::*;
+use flate2::bufread::MultiGzDecoder;
+use flate2::write::GzEncoder;
+use flate2::Compression;
+use std::fs::{self, File};
+use std::io::{self, BufRead, BufReader, BufWriter, Read, Write};
+use std::mem::ManuallyDrop;
+use std::os::wasi::io::FromRawFd;
+use std::path::{Component, Path, PathBuf};
+use std::time::UNIX_EPOCH;
+use tar::{Archive, Builder, Entry, EntryType, Header};
+
+const IO_BUF: usize = 64 << 10;
+
+/// An archive named by path, or an fd the caller keeps.
+enum Target {
+    Path(String),
+    Fd(i32),
+}
+
+/// An fd left open when done with.
+struct BorrowedFd(ManuallyDrop<File>);
+
+impl BorrowedFd {
+    fn new(fd: i32) -> Self {
+        BorrowedFd(ManuallyDrop::new(unsafe { File::from_raw_fd(fd as _) }))
+    }
+}
+
+impl Read for BorrowedFd {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        (&*self.0).read(buf)
+    }
+}
+
+impl Write for BorrowedFd {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        (&*self.0).write(buf)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        (&*self.0).flush()
+    }
+}
+
+/// Opens an archive for reading, gzip or not going by its first bytes.
+fn open_read(target: &Target) -> io::Result<Box<dyn BufRead>> {
+    let file: Box<dyn Read> = match target {
+        Target::Path(p) => Box::new(File::open(p)?),
+        Target::Fd(fd) => Box::new(BorrowedFd::new(*fd)),
+    };
+    let mut r = BufReader::with_capacity(IO_BUF, file);
+    if r.fill_buf()?.starts_with(&[0x1f, 0x8b]) {
+        let gz = MultiGzDecoder::new(r);
+        Ok(Box::new(BufReader::with_capacity(IO_BUF, gz)))
+    } else {
+        Ok(Box::new(r))
+    }
+}
+
+enum Sink {
+    Plain(BufWriter<Box<dyn Write>>),
+    Gzip(GzEncoder<BufWriter<Box<dyn Write>>>),
+}
+
+impl Sink {
+    /// Gzip compressed at `level` unless it is None.
+    fn open(target: &Target, level: Option<u32>) -> io::Result<Self> {
+        let file: Box<dyn Write> = match target {
+            Target::Path(p) => Box::new(File::create(p)?),
+            Target::Fd(fd) => Box::new(BorrowedFd::new(*fd)),
+        };
+        let w = BufWriter::with_capacity(IO_BUF, file);
+        Ok(match level {
+            Some(level) => Sink::Gzip(GzEncoder::new(w, Compression::new(level))),
+            None => Sink::Plain(w),
+        })
+    }
+
+    fn finish(self) -> io::Result<()> {
+        let mut w = match self {
+            Sink::Plain(w) => w,
+            Sink::Gzip(gz) => gz.finish()?,
+        };
+        w.flush()
+    }
+}
+
+impl Write for Sink {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        match self {
+            Sink::Plain(w) => w.write(buf),
+            Sink::Gzip(w) => w.write(buf),
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        match self {
+            Sink::Plain(w) => w.flush(),
+            Sink::Gzip(w) => w.flush(),
+        }
+    }
+}
+
+fn io<T>(ctx: &mut Context, r: io::Result<T>) -> Result<T, JsValue> {
+    r.map_err(|e| {
+        let err = match e.raw_os_error() {
+            Some(_) => err_to_js_object(ctx, e),
+            None => ctx.new_error(&e.to_string()),
+        };
+        ctx.throw_error(err).into()
+    })
+}
+
+fn errno(e: wasi_fs::Errno) -> io::Error {
+    io::Error::from_raw_os_error(e.raw() as i32)
+}
+
+fn type_name(t: EntryType) -> &'static str {
+    if t.is_file() {
+        "file"
+    } else if t.is_dir() {
+        "directory"
+    } else if t.is_symlink() {
+        "symlink"
+    } else if t.is_hard_link() {
+        "link"
+    } else {
+        "other"
+    }
+}
+
+/// What filters and `list` see of an entry.
+fn entry_info(
+    ctx: &mut Context,
+    path: &Path,
+    kind: EntryType,
+    size: u64,
+    mode: u32,
+    mtime: u64,
+    link: Option<&Path>,
+) -> JsValue {
+    let mut info = ctx.new_object();
+    info.set("path", ctx.new_string(&path.to_string_lossy()).into());
+    info.set("type", ctx.new_string(type_name(kind)).into());
+    info.set("size", (size as f64).into());
+    info.set("mode", (mode as i32).into());
+    info.set("mtime", ((mtime * 1000) as f64).into());
+    if let Some(link) = link {
+        info.set("linkpath", ctx.new_string(&link.to_string_lossy()).into());
+    }
+    JsValue::Object(info)
+}
+
+fn header_info<R: Read>(
+    ctx: &mut Context,
+    path: &Path,
+    entry: &Entry<R>,
+) -> Result<JsValue, JsValue> {
+    let header = entry.header();
+    let link = io(ctx, entry.link_name())?;
+    Ok(entry_info(
+        ctx,
+        path,
+        header.entry_type(),
+        entry.size(),
+        header.mode().unwrap_or(0),
+        header.mtime().unwrap_or(0),
+        link.as_deref(),
+    ))
+}
+
+/// Asks the filter, if any, whether to keep an entry.
+fn keep(filter: Option<&JsFunction>, info: JsValue) -> Result<bool, JsValue> {
+    let filter = match filter {
+        Some(f) => f,
+        None => return Ok(true),
+    };
+    match filter.call(&[info]) {
+        JsValue::Exception(e) => Err(JsValue::Exception(e)),
+        JsValue::Bool(b) => Ok(b),
+        JsValue::Int(n) => Ok(n != 0),
+        JsValue::Null | JsValue::UnDefined => Ok(false),
+        _ => Ok(true),
+    }
+}
+
+/// `path` without its first `strip` components, None when nothing is left
+/// or it would point outside the destination.
+fn strip_path(path: &Path, strip: usize) -> Option<PathBuf> {
+    let mut out = PathBuf::new();
+    let parts = path.components().filter(|c| *c != Component::CurDir);
+    for c in parts.skip(strip) {
+        match c {
+            Component::Normal(p) => out.push(p),
+            _ => return None,
+        }
+    }
+    if out.as_os_str().is_empty() {
+        None
+    } else {
+        Some(out)
+    }
+}
+
+fn copy(r: &mut impl Read, w: &mut impl Write, buf: &mut [u8]) -> io::Result<()> {
+    loop {
+        match r.read(buf) {
+            Ok(0) => return Ok(()),
+            Ok(n) => w.write_all(&buf[..n])?,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+}
+
+fn outside(rel: &Path) -> io::Error {
+    let msg = format!("{} leads outside the destination", rel.display());
+    io::Error::new(io::ErrorKind::InvalidData, msg)
+}
+
+/// Errors when a directory between `dest` and `rel` is a symlink, which
+/// would take whatever is written there outside the destination.
+fn check_parents(dest: &Path, rel: &Path) -> io::Result<()> {
+    let mut dir = dest.to_path_buf();
+    for c in rel.parent().into_iter().flat_map(Path::components) {
+        dir.push(c);
+        match fs::symlink_metadata(&dir) {
+            Ok(meta) if meta.file_type().is_symlink() => return Err(outside(rel)),
+            Ok(_) => {}
+            Err(_) => break,
+        }
+    }
+    Ok(())
+}
+
+/// Whether `link`, followed from the directory of `rel`, stays inside the
+/// destination. `rel` comes from strip_path and only has normal parts.
+fn link_inside(rel: &Path, link: &Path) -> bool {
+    let mut depth = rel.components().count() - 1;
+    for c in link.components() {
+        match c {
+            Component::Normal(_) => depth += 1,
+            Component::CurDir => {}
+            Component::ParentDir if depth > 0 => depth -= 1,
+            _ => return false,
+        }
+    }
+    true
+}
+
+fn unpack<R: Read>(
+    entry: &mut Entry<R>,
+    dest: &Path,
+    rel: &Path,
+    strip: usize,
+    buf: &mut [u8],
+) -> io::Result<bool> {
+    check_parents(dest, rel)?;
+    let target = dest.join(rel);
+    if let Some(parent) = target.parent() {
+        fs::create_dir_all(parent)?;
+    }
+    let kind = entry.header().entry_type();
+    if kind.is_dir() {
+        fs::create_dir_all(&target)?;
+    } else if kind.is_file() {
+        // File::create would write through a symlink already there
+        if let Ok(meta) = fs::symlink_metadata(&target) {
+            if meta.file_type().is_symlink() {
+                fs::remove_file(&target)?;
+            }
+        }
+        let mut f = File::create(&target)?;
+        copy(entry, &mut f, buf)?;
+    } else if kind.is_symlink() {
+        let link = match entry.link_name()? {
+            Some(link) => link.into_owned(),
+            None => return Ok(false),
+        };
+        if !link_inside(rel, &link) {
+            return Err(outside(rel));
+        }
+        let _ = fs::remove_file(&target);
+        let (dir, file) = wasi_fs::open_parent(&target.to_string_lossy())?;
+        unsafe { wasi_fs::path_symlink(&link.to_string_lossy(), dir, &file) }.map_err(errno)?;
+    } else if kind.is_hard_link() {
+        // the link names another entry of the archive
+        let link = match entry.link_name()?.and_then(|l| strip_path(&l, strip)) {
+            Some(link) => link,
+            None => return Ok(false),
+        };
+        check_parents(dest, &link)?;
+        let _ = fs::remove_file(&target);
+        fs::hard_link(dest.join(link), &target)?;
+    } else {
+        return Ok(false);
+    }
+    Ok(true)
+}
+
+fn extract_all(
+    ctx: &mut Context,
+    src: &Target,
+    dest: &Path,
+    strip: usize,
+    filter: Option<&JsFunction>,
+) -> Result<usize, JsValue> {
+    let mut archive = Archive::new(io(ctx, open_read(src))?);
+    let mut buf = vec![0; IO_BUF];
+    let mut n = 0;
+    for entry in io(ctx, archive.entries())? {
+        let mut entry = io(ctx, entry)?;
+        let path = io(ctx, entry.path())?.into_owned();
+        let rel = match strip_path(&path, strip) {
+            Some(rel) => rel,
+            None => continue,
+        };
+        if filter.is_some() {
+            let info = header_info(ctx, &rel, &entry)?;
+            if !keep(filter, info)? {
+                continue;
+            }
+        }
+        if io(ctx, unpack(&mut entry, dest, &rel, strip, &mut buf))? {
+            n += 1;
+        }
+    }
+    Ok(n)
+}
+
+fn add_path(
+    ctx: &mut Context,
+    builder: &mut Builder<Sink>,
+    cwd: &Path,
+    rel: &Path,
+    filter: Option<&JsFunction>,
+    n: &mut usize,
+) -> Result<(), JsValue> {
+    let full = cwd.join(rel);
+    let meta = io(ctx, fs::symlink_metadata(&full))?;
+    let mtime = meta
+        .modified()
+        .ok()
+        .and_then(|t| t.duration_since(UNIX_EPOCH).ok())
+        .map_or(0, |d| d.as_secs());
+    let ro = meta.permissions().readonly();
+    let (kind, mode, size) = if meta.is_dir() {
+        (EntryType::Directory, if ro { 0o555 } else { 0o755 }, 0)
+    } else if meta.file_type().is_symlink() {
+        (EntryType::Symlink, 0o777, 0)
+    } else {
+        (
+            EntryType::Regular,
+            if ro { 0o444 } else { 0o644 },
+            meta.len(),
+        )
+    };
+    let link = match kind {
+        EntryType::Symlink => Some(io(ctx, fs::read_link(&full))?),
+        _ => None,
+    };
+    if filter.is_some() {
+        let info = entry_info(ctx, rel, kind, size, mode, mtime, link.as_deref());
+        if !keep(filter, info)? {
+            return Ok(());
+        }
+    }
+    let mut header = Header::new_gnu();
+    header.set_entry_type(kind);
+    header.set_size(size);
+    header.set_mode(mode);
+    header.set_mtime(mtime);
+    match link {
+        Some(link) => {
+            io(ctx, header.set_link_name(&link))?;
+            io(ctx, builder.append_data(&mut header, rel, io::empty()))?
+        }
+        None if kind == EntryType::Directory => {
+            io(ctx, builder.append_data(&mut header, rel, io::empty()))?
+        }
+        None => {
+            let file = io(ctx, File::open(&full))?;
+            io(ctx, builder.append_data(&mut header, rel, file))?
+        }
+    }
+    *n += 1;
+    if kind == EntryType::Directory {
+        let mut names = vec![];
+        for e in io(ctx, fs::read_dir(&full))? {
+            names.push(io(ctx, e)?.file_name());
+        }
+        // the same tree always packs the same way
+        names.sort();
+        for name in names {
+            add_path(ctx, builder, cwd, &rel.join(name), filter, n)?;
+        }
+    }
+    Ok(())
+}
+
+fn target_arg(ctx: &mut Context, argv: &[JsValue]) -> Result<Target, JsValue> {
+    match argv.get(0) {
+        Some(JsValue::String(s)) => Ok(Target::Path(s.to_string())),
+        Some(JsValue::Int(fd)) if *fd >= 0 => Ok(Target::Fd(*fd)),
+        _ => Err(ctx
+            .throw_type_error("archive must be a path or a file descriptor")
+            .into()),
+    }
+}
+
+fn string_arg(argv: &[JsValue], i: usize) -> String {
+    match argv.get(i) {
+        Some(JsValue::String(s)) => s.to_string(),
+        _ => ".".to_string(),
+    }
+}
+
+fn filter_arg(argv: &[JsValue], i: usize) -> Option<JsFunction> {
+    match argv.get(i) {
+        Some(JsValue::Function(f)) => Some(f.clone()),
+        _ => None,
+    }
+}
+
+fn int_arg(argv: &[JsValue], i: usize) -> i32 {
+    match argv.get(i) {
+        Some(JsValue::Int(n)) => *n,
+        Some(JsValue::Float(n)) => *n as i32,
+        _ => 0,
+    }
+}
+
+/// `extract(archive, dest, strip, filter)`, the number of entries written.
+fn extract(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let src = match target_arg(ctx, argv) {
+        Ok(t) => t,
+        Err(e) => return e,
+    };
+    let dest = PathBuf::from(string_arg(argv, 1));
+    let strip = int_arg(argv, 2).max(0) as usize;
+    let filter = filter_arg(argv, 3);
+    match extract_all(ctx, &src, &dest, strip, filter.as_ref()) {
+        Ok(n) => JsValue::Int(n as i32),
+        Err(e) => e,
+    }
+}
+
+/// `pack(archive, cwd, paths, level, filter)`, gzip compressed for a level
+/// from 0 to 9. Directories are added with everything under them.
+fn pack(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let dst = match target_arg(ctx, argv) {
+        Ok(t) => t,
+        Err(e) => return e,
+    };
+    let cwd = PathBuf::from(string_arg(argv, 1));
+    let paths = match argv.get(2) {
+        Some(JsValue::Array(paths)) => paths.clone(),
+        _ => return ctx.throw_type_error("paths must be an array").into(),
+    };
+    let level = match int_arg(argv, 3) {
+        level @ 0..=9 => Some(level as u32),
+        _ => None,
+    };
+    let filter = filter_arg(argv, 4);
+    let sink = match io(ctx, Sink::open(&dst, level)) {
+        Ok(sink) => sink,
+        Err(e) => return e,
+    };
+    let mut builder = Builder::new(sink);
+    let mut n = 0;
+    for i in 0..paths.get_length() {
+        let path = match paths.take(i) {
+            JsValue::String(p) => p.to_string(),
+            _ => return ctx.throw_type_error("paths must be strings").into(),
+        };
+        let rel = Path::new(&path);
+        if let Err(e) = add_path(ctx, &mut builder, &cwd, rel, filter.as_ref(), &mut n) {
+            return e;
+        }
+    }
+    let done = builder.into_inner().and_then(Sink::finish);
+    match io(ctx, done) {
+        Ok(()) => JsValue::Int(n as i32),
+        Err(e) => e,
+    }
+}
+
+/// `list(archive, filter)`, the headers of the entries the filter keeps.
+fn list(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let src = match target_arg(ctx, argv) {
+        Ok(t) => t,
+        Err(e) => return e,
+    };
+    let filter = filter_arg(argv, 1);
+    let mut archive = match io(ctx, open_read(&src)) {
+        Ok(r) => Archive::new(r),
+        Err(e) => return e,
+    };
+    let entries = match io(ctx, archive.entries()) {
+        Ok(entries) => entries,
+        Err(e) => return e,
+    };
+    let mut arr = ctx.new_array();
+    let mut n = 0;
+    for entry in entries {
+        let info = io(ctx, entry).and_then(|entry| {
+            let path = io(ctx, entry.path())?.into_owned();
+            header_info(ctx, &path, &entry)
+        });
+        let info = match info {
+            Ok(info) => info,
+            Err(e) => return e,
+        };
+        match keep(filter.as_ref(), info.clone()) {
+            Ok(true) => {
+                arr.put(n, info);
+                n += 1;
+            }
+            Ok(false) => {}
+            Err(e) => return e,
+        }
+    }
+    arr.into()
+}
+
+struct TarModule;
+
+impl ModuleInit for TarModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("extract", extract);
+        m.add_export("extract\0", f.into());
+        let f = ctx.wrap_function("pack", pack);
+        m.add_export("pack\0", f.into());
+        let f = ctx.wrap_function("list", list);
+        m.add_export("list\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module("_drop:tar\0", TarModule, &["extract\0", "pack\0", "list\0"])
+}
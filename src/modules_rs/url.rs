@@ -0,0 +1,173 @@
+// WHATWG URL parsing for whatwg_url.js, on the url crate. A parsed URL
+// goes back to JS as its href and the offsets of its components in it,
+// which the URL getters slice on demand. Setters reparse the href and go
+// through `url::quirks`, which implements the spec's setter steps.
+
+use super::buffer::bytes_arg;
+use super::querystring::utf8_bytes;
+use crate::quickjs_sys::*;
+use ::url::{quirks, Position, Url};
+
+/// Offsets written after a parse, in the order whatwg_url.js reads them.
+/// Every serialized URL is ASCII, so they index the href string as well.
+const POSITIONS: [Position; 14] = [
+    Position::AfterScheme,
+    Position::BeforeUsername,
+    Position::AfterUsername,
+    Position::BeforePassword,
+    Position::AfterPassword,
+    Position::BeforeHost,
+    Position::AfterHost,
+    Position::BeforePort,
+    Position::AfterPort,
+    Position::BeforePath,
+    Position::AfterPath,
+    Position::BeforeQuery,
+    Position::AfterQuery,
+    Position::BeforeFragment,
+];
+
+const HREF: i32 = 0;
+const PROTOCOL: i32 = 1;
+const USERNAME: i32 = 2;
+const PASSWORD: i32 = 3;
+const HOST: i32 = 4;
+const HOSTNAME: i32 = 5;
+const PORT: i32 = 6;
+const PATHNAME: i32 = 7;
+const SEARCH: i32 = 8;
+const HASH: i32 = 9;
+
+/// `argv[i]` as UTF-8, with its lone surrogates replaced by U+FFFD like
+/// the spec's USVString conversion.
+fn str_arg(argv: &[JsValue], i: usize) -> Option<String> {
+    match argv.get(i) {
+        Some(JsValue::String(s)) => {
+            let mut buf = Vec::new();
+            Some(String::from_utf8_lossy(utf8_bytes(s, &mut buf)).into_owned())
+        }
+        _ => None,
+    }
+}
+
+/// The href of `url`, with its component offsets written to the
+/// `(arrayBuffer, byteOffset, byteLength)` at `argv[i]`.
+fn to_js(ctx: &mut Context, url: &Url, argv: &[JsValue], i: usize) -> JsValue {
+    let out = bytes_arg(argv, i);
+    for (chunk, &pos) in out.chunks_exact_mut(4).zip(POSITIONS.iter()) {
+        let offset = url[..pos].len() as u32;
+        chunk.copy_from_slice(&offset.to_le_bytes());
+    }
+    ctx.new_string_latin1(url.as_str().as_bytes())
+}
+
+/// `parse(input, base, offsets3)`, the href or null when either fails to
+/// parse.
+fn parse(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let input = match str_arg(argv, 0) {
+        Some(s) => s,
+        None => return JsValue::Null,
+    };
+    let base = match str_arg(argv, 1).as_deref().map(Url::parse) {
+        Some(Ok(base)) => Some(base),
+        Some(Err(_)) => return JsValue::Null,
+        None => None,
+    };
+    match Url::options().base_url(base.as_ref()).parse(&input) {
+        Ok(url) => to_js(ctx, &url, argv, 2),
+        Err(_) => JsValue::Null,
+    }
+}
+
+/// `update(href, setter, value, offsets3)`, the href after setting one of
+/// its components, or null when the href setter rejects the value. The
+/// other setters ignore values they can't use, like in the spec.
+fn update(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let mut url = match str_arg(argv, 0).as_deref().map(Url::parse) {
+        Some(Ok(url)) => url,
+        _ => return JsValue::Null,
+    };
+    let setter = match argv.get(1) {
+        Some(JsValue::Int(n)) => *n,
+        _ => return JsValue::Null,
+    };
+    let value = &str_arg(argv, 2).unwrap_or_default();
+    match setter {
+        HREF => {
+            if quirks::set_href(&mut url, value).is_err() {
+                return JsValue::Null;
+            }
+        }
+        PROTOCOL => {
+            let _ = quirks::set_protocol(&mut url, value);
+        }
+        USERNAME => {
+            let _ = quirks::set_username(&mut url, value);
+        }
+        PASSWORD => {
+            let _ = quirks::set_password(&mut url, value);
+        }
+        HOST => {
+            let _ = quirks::set_host(&mut url, value);
+        }
+        HOSTNAME => {
+            let _ = quirks::set_hostname(&mut url, value);
+        }
+        PORT => {
+            let _ = quirks::set_port(&mut url, value);
+        }
+        PATHNAME => quirks::set_pathname(&mut url, value),
+        SEARCH => quirks::set_search(&mut url, value),
+        HASH => quirks::set_hash(&mut url, value),
+        _ => return JsValue::Null,
+    }
+    to_js(ctx, &url, argv, 3)
+}
+
+fn origin(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    match str_arg(argv, 0).as_deref().map(Url::parse) {
+        Some(Ok(url)) => ctx.new_string(&quirks::origin(&url)).into(),
+        _ => JsValue::Null,
+    }
+}
+
+fn domain_to_ascii(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let domain = &str_arg(argv, 0).unwrap_or_default();
+    ctx.new_string(&quirks::domain_to_ascii(domain)).into()
+}
+
+fn domain_to_unicode(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let domain = &str_arg(argv, 0).unwrap_or_default();
+    ctx.new_string(&quirks::domain_to_unicode(domain)).into()
+}
+
+struct UrlModule;
+
+impl ModuleInit for UrlModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("parse", parse);
+        m.add_export("parse\0", f.into());
+        let f = ctx.wrap_function("update", update);
+        m.add_export("update\0", f.into());
+        let f = ctx.wrap_function("origin", origin);
+        m.add_export("origin\0", f.into());
+        let f = ctx.wrap_function("domainToASCII", domain_to_ascii);
+        m.add_export("domainToASCII\0", f.into());
+        let f = ctx.wrap_function("domainToUnicode", domain_to_unicode);
+        m.add_export("domainToUnicode\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:url\0",
+        UrlModule,
+        &[
+            "parse\0",
+            "update\0",
+            "origin\0",
+            "domainToASCII\0",
+            "domainToUnicode\0",
+        ],
+    )
+}
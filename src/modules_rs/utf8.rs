@@ -0,0 +1,460 @@
+// UTF-8 kernels behind TextEncoder/TextDecoder and Buffer.
+//
+// QuickJS stores strings either as Latin1 bytes or as UTF-16 code units,
+// so decoding targets those two forms directly instead of going through a
+// Rust `String`. With `+simd128` the hot loops (ASCII runs, validation)
+// process 16 bytes at a time, every kernel has a scalar fallback for
+// builds without it.
+
+#[cfg(target_feature = "simd128")]
+mod simd {
+    use core::arch::wasm32::*;
+
+    #[inline]
+    unsafe fn load(p: *const u8) -> v128 {
+        v128_load(p as *const v128)
+    }
+
+    /// Index of the first byte >= 0x80, or `bytes.len()`.
+    #[inline]
+    pub fn ascii_prefix(bytes: &[u8]) -> usize {
+        let mut i = 0;
+        while i + 16 <= bytes.len() {
+            let mask = u8x16_bitmask(unsafe { load(bytes.as_ptr().add(i)) });
+            if mask != 0 {
+                return i + mask.trailing_zeros() as usize;
+            }
+            i += 16;
+        }
+        i + super::scalar::ascii_prefix(&bytes[i..])
+    }
+
+    /// Like `ascii_prefix` over UTF-16 code units.
+    #[inline]
+    pub fn ascii_prefix_u16(units: &[u16]) -> usize {
+        let mut i = 0;
+        let high = u16x8_splat(0xFF80);
+        while i + 8 <= units.len() {
+            let v = unsafe { v128_load(units.as_ptr().add(i) as *const v128) };
+            let non_ascii = u16x8_ne(v128_and(v, high), u16x8_splat(0));
+            if v128_any_true(non_ascii) {
+                let mask = i16x8_bitmask(non_ascii);
+                return i + mask.trailing_zeros() as usize;
+            }
+            i += 8;
+        }
+        i + super::scalar::ascii_prefix_u16(&units[i..])
+    }
+
+    /// Appends `src` to `out` zero-extended to 16 bits.
+    #[inline]
+    pub fn widen(src: &[u8], out: &mut Vec<u16>) {
+        out.reserve(src.len());
+        let mut i = 0;
+        unsafe {
+            let dst = out.as_mut_ptr().add(out.len());
+            while i + 16 <= src.len() {
+                let v = load(src.as_ptr().add(i));
+                v128_store(dst.add(i) as *mut v128, u16x8_extend_low_u8x16(v));
+                v128_store(dst.add(i + 8) as *mut v128, u16x8_extend_high_u8x16(v));
+                i += 16;
+            }
+            for j in i..src.len() {
+                *dst.add(j) = src[j] as u16;
+            }
+            out.set_len(out.len() + src.len());
+        }
+    }
+
+    /// Writes ASCII code units `src` to `dst` as bytes, `dst` as long as
+    /// `src`.
+    #[inline]
+    pub fn narrow_ascii(src: &[u16], dst: &mut [u8]) {
+        let mut i = 0;
+        while i + 16 <= src.len() {
+            unsafe {
+                let lo = v128_load(src.as_ptr().add(i) as *const v128);
+                let hi = v128_load(src.as_ptr().add(i + 8) as *const v128);
+                v128_store(
+                    dst.as_mut_ptr().add(i) as *mut v128,
+                    u8x16_narrow_i16x8(lo, hi),
+                );
+            }
+            i += 16;
+        }
+        for j in i..src.len() {
+            dst[j] = src[j] as u8;
+        }
+    }
+
+    // Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per
+    // Byte": three nibble lookups classify every (previous, current) byte
+    // pair, a separate check covers the 3rd and 4th byte of long sequences.
+    const TOO_SHORT: u8 = 1 << 0;
+    const TOO_LONG: u8 = 1 << 1;
+    const OVERLONG_3: u8 = 1 << 2;
+    const TOO_LARGE: u8 = 1 << 3;
+    const SURROGATE: u8 = 1 << 4;
+    const OVERLONG_2: u8 = 1 << 5;
+    const TOO_LARGE_1000: u8 = 1 << 6;
+    const OVERLONG_4: u8 = 1 << 6;
+    const TWO_CONTS: u8 = 1 << 7;
+    const CARRY: u8 = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+    #[rustfmt::skip]
+    const BYTE_1_HIGH: [u8; 16] = [
+        // 0_______ ASCII
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        // 10______ continuation
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        // 1100____ two byte lead
+        TOO_SHORT | OVERLONG_2,
+        // 1101____ two byte lead
+        TOO_SHORT,
+        // 1110____ three byte lead
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        // 1111____ four byte lead
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+    ];
+
+    #[rustfmt::skip]
+    const BYTE_1_LOW: [u8; 16] = [
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+    ];
+
+    #[rustfmt::skip]
+    const BYTE_2_HIGH: [u8; 16] = [
+        // ________ 0_______ ASCII
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        // ________ 1000____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        // ________ 1001____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        // ________ 101_____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        // ________ 11______
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    ];
+
+    #[rustfmt::skip]
+    const INCOMPLETE_MAX: [u8; 16] = [
+        255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+    ];
+
+    struct Validator {
+        table_1_high: v128,
+        table_1_low: v128,
+        table_2_high: v128,
+        incomplete_max: v128,
+        prev_input: v128,
+        prev_incomplete: v128,
+        error: v128,
+    }
+
+    impl Validator {
+        fn new() -> Self {
+            unsafe {
+                Validator {
+                    table_1_high: load(BYTE_1_HIGH.as_ptr()),
+                    table_1_low: load(BYTE_1_LOW.as_ptr()),
+                    table_2_high: load(BYTE_2_HIGH.as_ptr()),
+                    incomplete_max: load(INCOMPLETE_MAX.as_ptr()),
+                    prev_input: u8x16_splat(0),
+                    prev_incomplete: u8x16_splat(0),
+                    error: u8x16_splat(0),
+                }
+            }
+        }
+
+        #[inline]
+        fn block(&mut self, input: v128) {
+            if u8x16_bitmask(input) == 0 {
+                // ASCII only, an unfinished sequence before it is an error
+                self.error = v128_or(self.error, self.prev_incomplete);
+                self.prev_input = input;
+                self.prev_incomplete = u8x16_splat(0);
+                return;
+            }
+            let prev = self.prev_input;
+            let prev1 =
+                i8x16_shuffle::<15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30>(
+                    prev, input,
+                );
+            let prev2 =
+                i8x16_shuffle::<14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29>(
+                    prev, input,
+                );
+            let prev3 =
+                i8x16_shuffle::<13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28>(
+                    prev, input,
+                );
+            let low_nibble = u8x16_splat(0x0F);
+            let byte_1_high = u8x16_swizzle(self.table_1_high, u8x16_shr(prev1, 4));
+            let byte_1_low = u8x16_swizzle(self.table_1_low, v128_and(prev1, low_nibble));
+            let byte_2_high = u8x16_swizzle(self.table_2_high, u8x16_shr(input, 4));
+            let special = v128_and(v128_and(byte_1_high, byte_1_low), byte_2_high);
+            // only 111_____ / 1111____ reach 0x80 after the subtraction
+            let third = u8x16_sub_sat(prev2, u8x16_splat(0xE0 - 0x80));
+            let fourth = u8x16_sub_sat(prev3, u8x16_splat(0xF0 - 0x80));
+            let must_be_cont = v128_and(v128_or(third, fourth), u8x16_splat(0x80));
+            self.error = v128_or(self.error, v128_xor(must_be_cont, special));
+            self.prev_incomplete = u8x16_sub_sat(input, self.incomplete_max);
+            self.prev_input = input;
+        }
+
+        fn finish(mut self) -> bool {
+            self.error = v128_or(self.error, self.prev_incomplete);
+            !v128_any_true(self.error)
+        }
+    }
+
+    pub fn validate(bytes: &[u8]) -> bool {
+        let mut v = Validator::new();
+        let mut i = 0;
+        while i + 16 <= bytes.len() {
+            v.block(unsafe { load(bytes.as_ptr().add(i)) });
+            i += 16;
+        }
+        if i < bytes.len() {
+            // zero padding is ASCII, so a truncated sequence still fails
+            let mut tail = [0u8; 16];
+            tail[..bytes.len() - i].copy_from_slice(&bytes[i..]);
+            v.block(unsafe { load(tail.as_ptr()) });
+        }
+        v.finish()
+    }
+}
+
+// also the tails of the SIMD loops
+#[allow(dead_code)]
+mod scalar {
+    pub fn ascii_prefix(bytes: &[u8]) -> usize {
+        bytes.iter().position(|b| *b >= 0x80).unwrap_or(bytes.len())
+    }
+
+    pub fn ascii_prefix_u16(units: &[u16]) -> usize {
+        units.iter().position(|u| *u >= 0x80).unwrap_or(units.len())
+    }
+
+    pub fn widen(src: &[u8], out: &mut Vec<u16>) {
+        out.extend(src.iter().map(|b| *b as u16));
+    }
+
+    pub fn narrow_ascii(src: &[u16], dst: &mut [u8]) {
+        for (d, s) in dst.iter_mut().zip(src) {
+            *d = *s as u8;
+        }
+    }
+
+    pub fn validate(bytes: &[u8]) -> bool {
+        std::str::from_utf8(bytes).is_ok()
+    }
+}
+
+#[cfg(not(target_feature = "simd128"))]
+use scalar as kernels;
+#[cfg(target_feature = "simd128")]
+use simd as kernels;
+
+pub use kernels::{ascii_prefix, ascii_prefix_u16, validate};
+
+const REPLACEMENT: [u8; 3] = [0xEF, 0xBF, 0xBD];
+
+/// Decodes valid UTF-8 to Latin1 until a code point above U+00FF shows
+/// up, returns the number of bytes consumed.
+pub fn utf8_to_latin1(bytes: &[u8], out: &mut Vec<u8>) -> usize {
+    out.reserve(bytes.len());
+    let mut i = 0;
+    while i < bytes.len() {
+        let n = ascii_prefix(&bytes[i..]);
+        out.extend_from_slice(&bytes[i..i + n]);
+        i += n;
+        if i == bytes.len() {
+            break;
+        }
+        match bytes[i] {
+            lead @ 0xC2..=0xC3 => {
+                out.push((lead & 0x03) << 6 | (bytes[i + 1] & 0x3F));
+                i += 2;
+            }
+            _ => break,
+        }
+    }
+    i
+}
+
+/// Appends Latin1 `src` to `out` as UTF-16.
+pub fn latin1_to_utf16(src: &[u8], out: &mut Vec<u16>) {
+    kernels::widen(src, out)
+}
+
+/// Decodes valid UTF-8 to UTF-16 code units.
+pub fn utf8_to_utf16(bytes: &[u8], out: &mut Vec<u16>) {
+    out.reserve(bytes.len());
+    let mut i = 0;
+    while i < bytes.len() {
+        let n = ascii_prefix(&bytes[i..]);
+        kernels::widen(&bytes[i..i + n], out);
+        i += n;
+        if i == bytes.len() {
+            break;
+        }
+        let b0 = bytes[i] as u32;
+        if b0 < 0xE0 {
+            out.push(((b0 & 0x1F) << 6 | (bytes[i + 1] as u32 & 0x3F)) as u16);
+            i += 2;
+        } else if b0 < 0xF0 {
+            let c = (b0 & 0x0F) << 12
+                | (bytes[i + 1] as u32 & 0x3F) << 6
+                | (bytes[i + 2] as u32 & 0x3F);
+            out.push(c as u16);
+            i += 3;
+        } else {
+            let c = (b0 & 0x07) << 18
+                | (bytes[i + 1] as u32 & 0x3F) << 12
+                | (bytes[i + 2] as u32 & 0x3F) << 6
+                | (bytes[i + 3] as u32 & 0x3F);
+            let c = c - 0x10000;
+            out.push((0xD800 | (c >> 10)) as u16);
+            out.push((0xDC00 | (c & 0x3FF)) as u16);
+            i += 4;
+        }
+    }
+}
+
+/// UTF-8 size of a Latin1 string.
+pub fn latin1_utf8_len(src: &[u8]) -> usize {
+    let mut len = src.len();
+    let mut i = 0;
+    while i < src.len() {
+        let n = ascii_prefix(&src[i..]);
+        i += n;
+        if i < src.len() {
+            len += 1;
+            i += 1;
+        }
+    }
+    len
+}
+
+/// UTF-8 size of UTF-16 code units, lone surrogates become U+FFFD.
+pub fn utf16_utf8_len(src: &[u16]) -> usize {
+    let mut len = 0;
+    let mut i = 0;
+    while i < src.len() {
+        let n = ascii_prefix_u16(&src[i..]);
+        len += n;
+        i += n;
+        if i == src.len() {
+            break;
+        }
+        let u = src[i];
+        if u < 0x800 {
+            len += 2;
+        } else if (0xD800..0xDC00).contains(&u)
+            && i + 1 < src.len()
+            && (0xDC00..0xE000).contains(&src[i + 1])
+        {
+            len += 4;
+            i += 1;
+        } else {
+            len += 3;
+        }
+        i += 1;
+    }
+    len
+}
+
+/// Encodes as much of `src` as fits in `dst` without splitting a
+/// character, returns (code units read, bytes written).
+pub fn latin1_to_utf8(src: &[u8], dst: &mut [u8]) -> (usize, usize) {
+    let (mut read, mut written) = (0, 0);
+    while read < src.len() {
+        let n = ascii_prefix(&src[read..]).min(dst.len() - written);
+        dst[written..written + n].copy_from_slice(&src[read..read + n]);
+        read += n;
+        written += n;
+        if read == src.len() || dst.len() - written < 2 {
+            break;
+        }
+        let c = src[read];
+        dst[written] = 0xC0 | (c >> 6);
+        dst[written + 1] = 0x80 | (c & 0x3F);
+        read += 1;
+        written += 2;
+    }
+    (read, written)
+}
+
+/// Like `latin1_to_utf8` for UTF-16, lone surrogates become U+FFFD.
+pub fn utf16_to_utf8(src: &[u16], dst: &mut [u8]) -> (usize, usize) {
+    let (mut read, mut written) = (0, 0);
+    while read < src.len() {
+        let n = ascii_prefix_u16(&src[read..]).min(dst.len() - written);
+        kernels::narrow_ascii(&src[read..read + n], &mut dst[written..written + n]);
+        read += n;
+        written += n;
+        if read == src.len() || written == dst.len() {
+            break;
+        }
+        let u = src[read] as u32;
+        let room = dst.len() - written;
+        let out = &mut dst[written..];
+        if u < 0x800 {
+            if room < 2 {
+                break;
+            }
+            out[0] = 0xC0 | (u >> 6) as u8;
+            out[1] = 0x80 | (u & 0x3F) as u8;
+            read += 1;
+            written += 2;
+        } else if (0xD800..0xDC00).contains(&u)
+            && read + 1 < src.len()
+            && (0xDC00..0xE000).contains(&src[read + 1])
+        {
+            if room < 4 {
+                break;
+            }
+            let c = 0x10000 + ((u - 0xD800) << 10) + (src[read + 1] as u32 - 0xDC00);
+            out[0] = 0xF0 | (c >> 18) as u8;
+            out[1] = 0x80 | (c >> 12 & 0x3F) as u8;
+            out[2] = 0x80 | (c >> 6 & 0x3F) as u8;
+            out[3] = 0x80 | (c & 0x3F) as u8;
+            read += 2;
+            written += 4;
+        } else {
+            if room < 3 {
+                break;
+            }
+            if (0xD800..0xE000).contains(&u) {
+                out[..3].copy_from_slice(&REPLACEMENT);
+            } else {
+                out[0] = 0xE0 | (u >> 12) as u8;
+                out[1] = 0x80 | (u >> 6 & 0x3F) as u8;
+                out[2] = 0x80 | (u & 0x3F) as u8;
+            }
+            read += 1;
+            written += 3;
+        }
+    }
+    (read, written)
+}
@@ -0,0 +1,333 @@
+// Workers run on their own thread with a separate Runtime, Context and
+// EventLoop, so nothing JS is ever shared between threads. Messages cross
+// as `Context::serialize` buffers over mpsc channels and arrive through
+// `EventLoop::add_channel`. Spawning needs a wasi-threads build, plain
+// wasm32-wasi reports it as unsupported.
+
+use crate::event_loop::ChannelMessage;
+use crate::quickjs_sys::*;
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc::{channel, Receiver, Sender};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+static NEXT_THREAD_ID: AtomicUsize = AtomicUsize::new(1);
+
+// QuickJS's JS_DEFAULT_STACK_SIZE, the stack check budget without --max-stack
+const QJS_DEFAULT_STACK: usize = 256 << 10;
+// native frames outside the QuickJS budget, SWC transpiling imports above all
+const WORKER_STACK_MARGIN: usize = 4 << 20;
+
+struct WorkerHandle {
+    tx: Sender<ChannelMessage>,
+    terminate: Arc<AtomicBool>,
+    channel: usize,
+    thread: JoinHandle<()>,
+}
+
+/// What a worker thread knows about its parent.
+struct ParentPort {
+    thread_id: usize,
+    worker_data: Option<Serialized>,
+    tx: Sender<ChannelMessage>,
+    rx: Option<Receiver<ChannelMessage>>,
+    channel: Option<usize>,
+}
+
+thread_local! {
+    static WORKERS: RefCell<HashMap<usize, WorkerHandle>> = RefCell::new(HashMap::new());
+    static PARENT: RefCell<Option<ParentPort>> = RefCell::new(None);
+}
+
+fn thread_id_arg(argv: &[JsValue]) -> usize {
+    match argv.get(0) {
+        Some(JsValue::Int(id)) => *id as usize,
+        Some(JsValue::Float(id)) => *id as usize,
+        _ => 0,
+    }
+}
+
+fn run_worker(
+    options: RuntimeOptions,
+    thread_id: usize,
+    file_path: String,
+    args: Vec<String>,
+    worker_data: Option<Serialized>,
+    tx: Sender<ChannelMessage>,
+    rx: Receiver<ChannelMessage>,
+    terminate: Arc<AtomicBool>,
+) {
+    let mut rt = Runtime::new_with_options(&options);
+    if let Some(event_loop) = rt.event_loop() {
+        // exit() ends the worker, not the process
+        event_loop.set_trap_exit(true);
+        event_loop.set_terminate_flag(Some(terminate));
+    }
+    PARENT.with(|p| {
+        *p.borrow_mut() = Some(ParentPort {
+            thread_id,
+            worker_data,
+            tx: tx.clone(),
+            rx: Some(rx),
+            channel: None,
+        })
+    });
+    let (result, exit_code) = rt.run_with_context(|ctx| {
+        let result = ctx.run_entry_module(&file_path, args.clone());
+        (result, ctx.exit_code())
+    });
+    PARENT.with(|p| p.borrow_mut().take());
+    if let Err(e) = &result {
+        tx.send(ChannelMessage::Error(e.clone()));
+    }
+    let code = exit_code.unwrap_or(if result.is_err() { 1 } else { 0 });
+    tx.send(ChannelMessage::Exit(code));
+}
+
+/// `spawn(filename, workerData, argv, onEvent)`, returns the thread id.
+fn spawn(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let file_path = match argv.get(0) {
+        Some(JsValue::String(s)) => s.to_string(),
+        _ => return ctx.throw_type_error("filename must be a string").into(),
+    };
+    let worker_data = match argv.get(1) {
+        None | Some(JsValue::UnDefined) => None,
+        Some(v) => match ctx.serialize(v) {
+            Ok(buf) => Some(buf),
+            Err(e) => return e.into(),
+        },
+    };
+    let args = match argv.get(2) {
+        Some(JsValue::Array(arr)) => match arr.to_vec() {
+            Ok(values) => values
+                .into_iter()
+                .filter_map(|v| v.to_string().map(|s| s.to_string()))
+                .collect(),
+            Err(e) => return e.into(),
+        },
+        _ => vec![],
+    };
+    let callback = match argv.get(3) {
+        Some(JsValue::Function(f)) => f.clone(),
+        _ => return ctx.throw_type_error("onEvent must be a function").into(),
+    };
+
+    let thread_id = NEXT_THREAD_ID.fetch_add(1, Ordering::Relaxed);
+    let (to_worker, worker_rx) = channel();
+    let (worker_tx, from_worker) = channel();
+    let terminate = Arc::new(AtomicBool::new(false));
+    let worker_terminate = terminate.clone();
+    let options = ctx
+        .event_loop()
+        .and_then(|event_loop| event_loop.runtime_options().cloned())
+        .unwrap_or_default();
+    // the thread stack must outlast the QuickJS stack check
+    let stack_size = match options.max_stack_size {
+        Some(0) | None => QJS_DEFAULT_STACK,
+        Some(size) => size,
+    } + WORKER_STACK_MARGIN;
+    let spawned = std::thread::Builder::new()
+        .name(format!("worker {}", thread_id))
+        .stack_size(stack_size)
+        .spawn(move || {
+            run_worker(
+                options,
+                thread_id,
+                file_path,
+                args,
+                worker_data,
+                worker_tx,
+                worker_rx,
+                worker_terminate,
+            )
+        });
+    let thread = match spawned {
+        Ok(thread) => thread,
+        Err(e) => {
+            let msg = format!(
+                "cannot start worker thread, drop needs a wasi-threads build: {}",
+                e
+            );
+            return ctx.throw_internal_type_error(&msg).into();
+        }
+    };
+
+    let channel = match ctx.event_loop() {
+        Some(event_loop) => event_loop.add_channel(from_worker, callback),
+        None => return JsValue::UnDefined,
+    };
+    WORKERS.with(|w| {
+        w.borrow_mut().insert(
+            thread_id,
+            WorkerHandle {
+                tx: to_worker,
+                terminate,
+                channel,
+                thread,
+            },
+        )
+    });
+    JsValue::Int(thread_id as i32)
+}
+
+/// `postMessage(threadId, value)` from the parent.
+fn post_message(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let buf = match ctx.serialize(argv.get(1).unwrap_or(&JsValue::UnDefined)) {
+        Ok(buf) => buf,
+        Err(e) => return e.into(),
+    };
+    WORKERS.with(|w| {
+        if let Some(handle) = w.borrow().get(&thread_id_arg(argv)) {
+            // a worker that already exited drops the message, as in node
+            handle.tx.send(ChannelMessage::Data(buf));
+        }
+    });
+    JsValue::UnDefined
+}
+
+fn terminate(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    WORKERS.with(|w| {
+        if let Some(handle) = w.borrow().get(&thread_id_arg(argv)) {
+            handle.terminate.store(true, Ordering::Relaxed);
+        }
+    });
+    JsValue::UnDefined
+}
+
+/// `setRef(threadId, bool)`, an unreferenced worker doesn't keep the
+/// parent's event loop alive.
+fn set_ref(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let refed = matches!(argv.get(1), Some(JsValue::Bool(true)));
+    let channel = WORKERS.with(|w| w.borrow().get(&thread_id_arg(argv)).map(|h| h.channel));
+    if let (Some(channel), Some(event_loop)) = (channel, ctx.event_loop()) {
+        event_loop.set_channel_ref(channel, refed);
+    }
+    JsValue::UnDefined
+}
+
+/// Stops every worker started on this thread and waits for them to end,
+/// so none outlives the script that started it. A worker does the same
+/// for its own workers when its loop resets.
+pub fn terminate_all() {
+    let workers = WORKERS.with(|w| std::mem::take(&mut *w.borrow_mut()));
+    for handle in workers.values() {
+        handle.terminate.store(true, Ordering::Relaxed);
+    }
+    for (_, handle) in workers {
+        let _ = handle.thread.join();
+    }
+}
+
+/// Forgets an exited worker.
+fn release(_ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    WORKERS.with(|w| w.borrow_mut().remove(&thread_id_arg(argv)));
+    JsValue::UnDefined
+}
+
+/// `{ threadId, workerData }` inside a worker, null on the main thread.
+fn worker_info(ctx: &mut Context, _this_val: JsValue, _argv: &[JsValue]) -> JsValue {
+    let info = PARENT.with(|p| {
+        p.borrow().as_ref().map(|p| {
+            let worker_data = match &p.worker_data {
+                Some(data) => ctx.deserialize(data),
+                None => Ok(JsValue::UnDefined),
+            };
+            (p.thread_id, worker_data)
+        })
+    });
+    match info {
+        Some((thread_id, Ok(worker_data))) => {
+            let mut obj = ctx.new_object();
+            obj.set("threadId", JsValue::Int(thread_id as i32));
+            obj.set("workerData", worker_data);
+            obj.into()
+        }
+        Some((_, Err(e))) => ctx.throw_error(e).into(),
+        None => JsValue::Null,
+    }
+}
+
+/// Starts delivering the parent's messages to `callback`, once.
+fn parent_port_listen(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let callback = match argv.get(0) {
+        Some(JsValue::Function(f)) => f.clone(),
+        _ => return ctx.throw_type_error("callback must be a function").into(),
+    };
+    let rx = PARENT.with(|p| p.borrow_mut().as_mut().and_then(|p| p.rx.take()));
+    if let (Some(rx), Some(event_loop)) = (rx, ctx.event_loop()) {
+        let channel = event_loop.add_channel(rx, callback);
+        PARENT.with(|p| {
+            if let Some(p) = p.borrow_mut().as_mut() {
+                p.channel = Some(channel);
+            }
+        });
+    }
+    JsValue::UnDefined
+}
+
+fn parent_port_ref(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let refed = matches!(argv.get(0), Some(JsValue::Bool(true)));
+    let channel = PARENT.with(|p| p.borrow().as_ref().and_then(|p| p.channel));
+    if let (Some(channel), Some(event_loop)) = (channel, ctx.event_loop()) {
+        event_loop.set_channel_ref(channel, refed);
+    }
+    JsValue::UnDefined
+}
+
+fn post_to_parent(ctx: &mut Context, _this_val: JsValue, argv: &[JsValue]) -> JsValue {
+    let buf = match ctx.serialize(argv.get(0).unwrap_or(&JsValue::UnDefined)) {
+        Ok(buf) => buf,
+        Err(e) => return e.into(),
+    };
+    PARENT.with(|p| {
+        if let Some(p) = p.borrow().as_ref() {
+            p.tx.send(ChannelMessage::Data(buf));
+        }
+    });
+    JsValue::UnDefined
+}
+
+struct WorkerThreads;
+
+impl ModuleInit for WorkerThreads {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let f = ctx.wrap_function("spawn", spawn);
+        m.add_export("spawn\0", f.into());
+        let f = ctx.wrap_function("postMessage", post_message);
+        m.add_export("postMessage\0", f.into());
+        let f = ctx.wrap_function("terminate", terminate);
+        m.add_export("terminate\0", f.into());
+        let f = ctx.wrap_function("setRef", set_ref);
+        m.add_export("setRef\0", f.into());
+        let f = ctx.wrap_function("release", release);
+        m.add_export("release\0", f.into());
+        let f = ctx.wrap_function("workerInfo", worker_info);
+        m.add_export("workerInfo\0", f.into());
+        let f = ctx.wrap_function("parentPortListen", parent_port_listen);
+        m.add_export("parentPortListen\0", f.into());
+        let f = ctx.wrap_function("parentPortRef", parent_port_ref);
+        m.add_export("parentPortRef\0", f.into());
+        let f = ctx.wrap_function("postToParent", post_to_parent);
+        m.add_export("postToParent\0", f.into());
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module(
+        "_node:worker_threads\0",
+        WorkerThreads,
+        &[
+            "spawn\0",
+            "postMessage\0",
+            "terminate\0",
+            "setRef\0",
+            "release\0",
+            "workerInfo\0",
+            "parentPortListen\0",
+            "parentPortRef\0",
+            "postToParent\0",
+        ],
+    )
+}
@@ -0,0 +1,272 @@
+// Compression streams behind zlib.js, on the flate2 crate. A Zlib object
+// wraps one of flate2's `write` encoders or decoders over a Vec that
+// collects the output, which every call hands back as a new ArrayBuffer.
+// Modes are node's zlib constants.
+
+use super::buffer::bytes_ref_arg;
+use crate::quickjs_sys::*;
+use flate2::write::{
+    DeflateDecoder, DeflateEncoder, GzDecoder, GzEncoder, ZlibDecoder, ZlibEncoder,
+};
+use flate2::Compression;
+use std::io::{self, Write};
+
+const DEFLATE: i32 = 1;
+const INFLATE: i32 = 2;
+const GZIP: i32 = 3;
+const GUNZIP: i32 = 4;
+const DEFLATERAW: i32 = 5;
+const INFLATERAW: i32 = 6;
+const UNZIP: i32 = 7;
+
+const Z_DATA_ERROR: i32 = -3;
+const Z_BUF_ERROR: i32 = -5;
+
+trait Codec: Write {
+    /// Takes the output produced so far.
+    fn output(&mut self) -> Vec<u8>;
+    fn finish(&mut self) -> io::Result<()>;
+}
+
+macro_rules! impl_codec {
+    ($end:ident: $($t:ident),*) => {
+        $(
+            impl Codec for $t<Vec<u8>> {
+                fn output(&mut self) -> Vec<u8> {
+                    std::mem::take(self.get_mut())
+                }
+
+                fn finish(&mut self) -> io::Result<()> {
+                    $end(self)?;
+                    self.try_finish()
+                }
+            }
+        )*
+    };
+}
+
+fn any_end<W: Write>(_: &mut W) -> io::Result<()> {
+    Ok(())
+}
+
+/// try_finish takes a cut off stream for a complete one, but a decoder
+/// past the end of its stream refuses more input, so one more byte tells
+/// them apart.
+fn stream_end<W: Write>(decoder: &mut W) -> io::Result<()> {
+    match decoder.write(&[0]) {
+        Ok(0) => Ok(()),
+        _ => Err(io::Error::new(
+            io::ErrorKind::UnexpectedEof,
+            "unexpected end of file",
+        )),
+    }
+}
+
+impl_codec!(any_end: DeflateEncoder, GzEncoder, ZlibEncoder);
+impl_codec!(stream_end: DeflateDecoder, GzDecoder, ZlibDecoder);
+
+pub struct Zlib {
+    mode: i32,
+    level: Compression,
+    // none until the first bytes tell UNZIP which format it reads
+    codec: Option<Box<dyn Codec>>,
+    finished: bool,
+}
+
+impl Zlib {
+    fn new(mode: i32, level: i32) -> Option<Self> {
+        let level = match level {
+            0..=9 => Compression::new(level as u32),
+            _ => Compression::default(),
+        };
+        let mut z = Zlib {
+            mode,
+            level,
+            codec: None,
+            finished: false,
+        };
+        if mode != UNZIP {
+            z.codec = Some(z.new_codec(mode)?);
+        }
+        Some(z)
+    }
+
+    fn new_codec(&self, mode: i32) -> Option<Box<dyn Codec>> {
+        let c: Box<dyn Codec> = match mode {
+            DEFLATE => Box::new(ZlibEncoder::new(Vec::new(), self.level)),
+            INFLATE => Box::new(ZlibDecoder::new(Vec::new())),
+            GZIP => Box::new(GzEncoder::new(Vec::new(), self.level)),
+            GUNZIP => Box::new(GzDecoder::new(Vec::new())),
+            DEFLATERAW => Box::new(DeflateEncoder::new(Vec::new(), self.level)),
+            INFLATERAW => Box::new(DeflateDecoder::new(Vec::new())),
+            _ => return None,
+        };
+        Some(c)
+    }
+
+    fn reset(&mut self) {
+        self.finished = false;
+        self.codec = match self.mode {
+            UNZIP => None,
+            mode => self.new_codec(mode),
+        };
+    }
+
+    fn codec(&mut self, input: &[u8]) -> Option<&mut Box<dyn Codec>> {
+        if self.codec.is_none() && !input.is_empty() {
+            let mode = if input[0] == 0x1F { GUNZIP } else { INFLATE };
+            self.codec = self.new_codec(mode);
+        }
+        self.codec.as_mut()
+    }
+
+    fn write(&mut self, input: &[u8]) -> io::Result<Vec<u8>> {
+        if self.finished {
+            return Err(io::Error::new(io::ErrorKind::Other, "zlib binding closed"));
+        }
+        let codec = match self.codec(input) {
+            Some(codec) => codec,
+            None => return Ok(vec![]),
+        };
+        let mut rest = input;
+        while !rest.is_empty() {
+            let n = codec.write(rest)?;
+            if n == 0 {
+                // past the end of the compressed data, node ignores the rest
+                break;
+            }
+            rest = &rest[n..];
+        }
+        Ok(codec.output())
+    }
+
+    fn flush(&mut self) -> io::Result<Vec<u8>> {
+        match &mut self.codec {
+            Some(codec) if !self.finished => {
+                codec.flush()?;
+                Ok(codec.output())
+            }
+            _ => Ok(vec![]),
+        }
+    }
+
+    fn finish(&mut self, input: &[u8]) -> io::Result<Vec<u8>> {
+        let mut out = self.write(input)?;
+        self.finished = true;
+        if let Some(codec) = &mut self.codec {
+            codec.finish()?;
+            out.append(&mut codec.output());
+        }
+        Ok(out)
+    }
+}
+
+fn to_js(ctx: &mut Context, r: io::Result<Vec<u8>>) -> JsValue {
+    match r {
+        Ok(out) => ctx.new_array_buffer(&out).into(),
+        Err(e) => {
+            let (code, errno) = match e.kind() {
+                io::ErrorKind::UnexpectedEof => ("Z_BUF_ERROR", Z_BUF_ERROR),
+                _ => ("Z_DATA_ERROR", Z_DATA_ERROR),
+            };
+            let mut err = ctx.new_error(&e.to_string());
+            if let JsValue::Object(o) = &mut err {
+                o.set("code", ctx.new_string(code).into());
+                o.set("errno", JsValue::Int(errno));
+            }
+            ctx.throw_error(err).into()
+        }
+    }
+}
+
+/// `write(arrayBuffer, byteOffset, byteLength)`, returns the output so far.
+fn write(
+    this: &mut Zlib,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let r = this.write(bytes_ref_arg(argv, 0));
+    to_js(ctx, r)
+}
+
+fn flush(
+    this: &mut Zlib,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    let r = this.flush();
+    to_js(ctx, r)
+}
+
+/// `finish([arrayBuffer, byteOffset, byteLength])`, writes the last input
+/// and returns all the remaining output.
+fn finish(
+    this: &mut Zlib,
+    _this_obj: &mut JsObject,
+    ctx: &mut Context,
+    argv: &[JsValue],
+) -> JsValue {
+    let r = this.finish(bytes_ref_arg(argv, 0));
+    to_js(ctx, r)
+}
+
+fn reset(
+    this: &mut Zlib,
+    _this_obj: &mut JsObject,
+    _ctx: &mut Context,
+    _argv: &[JsValue],
+) -> JsValue {
+    this.reset();
+    JsValue::UnDefined
+}
+
+fn int_arg(argv: &[JsValue], i: usize, default: i32) -> i32 {
+    match argv.get(i) {
+        Some(JsValue::Int(n)) => *n,
+        Some(JsValue::Float(n)) => *n as i32,
+        _ => default,
+    }
+}
+
+impl JsClassDef for Zlib {
+    type RefType = Zlib;
+
+    const CLASS_NAME: &'static str = "Zlib";
+    const CONSTRUCTOR_ARGC: u8 = 2;
+
+    const FIELDS: &'static [JsClassField<Self::RefType>] = &[];
+
+    const METHODS: &'static [JsClassMethod<Self::RefType>] = &[
+        ("write", 3, write),
+        ("flush", 0, flush),
+        ("finish", 3, finish),
+        ("reset", 0, reset),
+    ];
+
+    unsafe fn mut_class_id_ptr() -> &'static mut u32 {
+        static mut CLASS_ID: u32 = 0;
+        &mut CLASS_ID
+    }
+
+    /// `new Zlib(mode, level)`
+    fn constructor_fn(ctx: &mut Context, argv: &[JsValue]) -> Result<Self::RefType, JsValue> {
+        let mode = int_arg(argv, 0, 0);
+        let level = int_arg(argv, 1, -1);
+        Zlib::new(mode, level).ok_or_else(|| ctx.throw_type_error("Bad argument").into())
+    }
+}
+
+struct ZlibModule;
+
+impl ModuleInit for ZlibModule {
+    fn init_module(ctx: &mut Context, m: &mut JsModuleDef) {
+        let class_ctor = register_class::<Zlib>(ctx);
+        m.add_export("Zlib\0", class_ctor);
+    }
+}
+
+pub fn init_module(ctx: &mut Context) {
+    ctx.register_module("_node:zlib\0", ZlibModule, &["Zlib\0"])
+}
@@ -50,28 +50,23 @@ function decode(encoded: string) {
 	return bytes.buffer;
 }
 
-/**
- * Run a Drop command (NodeJS subset emulation)
- * @param opts Options to run the command
- * @returns Runner to execute the command
- * @example
- * ```ts
- * const { exec } = await runDrop({ file: "index.ts" });
- * exec();
- * ```
- */
-export async function runDrop(opts: DropRunOptions): Promise<Runner> {
-	const variant = opts.variant || getDefaultABIVariant();
+async function instantiateDrop(
+	args: string[],
+	variant: ABIVariant,
+	buffer?: BufferSource,
+	stdin?: number,
+): Promise<Runner> {
 	const sharedOpts = {
 		preopens: { [process.cwd()]: ".", ".": "." },
-		args: ["drop", opts.file, ...(opts.args || [])],
+		args,
 		env: process.env,
 	};
 	const wasi =
-		variant === "node" ? new NodeWASI({ returnOnExit: true, ...sharedOpts }) : new WASI({ bindings, ...sharedOpts });
+		variant === "node"
+			? new NodeWASI({ returnOnExit: true, ...(stdin === undefined ? {} : { stdin }), ...sharedOpts })
+			: new WASI({ bindings, ...sharedOpts });
 	const importObject = { wasi_snapshot_preview1: wasi.wasiImport };
-	const buffer = opts.buffer || decode(DROP_WASM_BASE64);
-	const wasm = await WebAssembly.compile(buffer);
+	const wasm = await WebAssembly.compile(buffer || decode(DROP_WASM_BASE64));
 	const instance = await WebAssembly.instantiate(wasm, importObject);
 	return {
 		instance,
@@ -81,6 +76,46 @@ export async function runDrop(opts: DropRunOptions): Promise<Runner> {
 	};
 }
 
+/**
+ * Run a Drop command (NodeJS subset emulation)
+ * @param opts Options to run the command
+ * @returns Runner to execute the command
+ * @example
+ * ```ts
+ * const { exec } = await runDrop({ file: "index.ts" });
+ * exec();
+ * ```
+ */
+export async function runDrop(opts: DropRunOptions): Promise<Runner> {
+	const variant = opts.variant || getDefaultABIVariant();
+	return instantiateDrop(["drop", opts.file, ...(opts.args || [])], variant, opts.buffer);
+}
+
+/** Options to run Drop in batch mode */
+export interface DropServeOptions extends RunOptions {
+	/** File descriptor jobs are read from, defaults to the process stdin */
+	readonly stdin?: number;
+	/** Wasm binary to instantiate instead of the embedded Drop build */
+	readonly buffer?: BufferSource;
+}
+
+/**
+ * Run many Drop scripts in a single wasm instance. Each line read from
+ * `stdin` is a job, `file args...`, executed in a fresh context of a shared
+ * runtime. A JSON status line is written to stderr after every job.
+ * @param opts Options to run the server, `args` are runtime flags
+ * @returns Runner to execute the server until `stdin` is closed
+ * @example
+ * ```ts
+ * const { exec } = await serveDrop({ stdin: fs.openSync("jobs.txt", "r") });
+ * exec();
+ * ```
+ */
+export async function serveDrop(opts: DropServeOptions = {}): Promise<Runner> {
+	const variant = opts.variant || getDefaultABIVariant();
+	return instantiateDrop(["drop", ...(opts.args || []), "--serve"], variant, opts.buffer, opts.stdin);
+}
+
 /** Options to run a BusyBox command (POSIX subset emulation) */
 export interface BusyBoxRunOptions extends RunOptions {
 	readonly Module?: {};
@@ -211,4 +211,106 @@ JSValue js_exception(){
 
 JSValue js_null(){
     return JS_NULL;
-}
\ No newline at end of file
+}
+
+void *JS_GetMallocOpaque_real(JSRuntime *rt){
+    return rt->malloc_state.opaque;
+}
+
+/* 1 for an ArrayBuffer, 2 for a SharedArrayBuffer, 0 otherwise */
+int JS_IsArrayBuffer_real(JSValueConst v){
+    JSObject *p;
+    if (JS_VALUE_GET_TAG(v) != JS_TAG_OBJECT)
+        return 0;
+    p = JS_VALUE_GET_OBJ(v);
+    if (p->class_id == JS_CLASS_ARRAY_BUFFER)
+        return 1;
+    if (p->class_id == JS_CLASS_SHARED_ARRAY_BUFFER)
+        return 2;
+    return 0;
+}
+
+/* Internal storage of a string: Latin1 bytes, or UTF-16 code units when
+   *is_wide is set. Returns the length in units, -1 if v is not a string. */
+int JS_GetStringData_real(JSValueConst v, const void **buf, int *is_wide){
+    JSString *p;
+    if (JS_VALUE_GET_TAG(v) != JS_TAG_STRING)
+        return -1;
+    p = JS_VALUE_GET_STRING(v);
+    *is_wide = p->is_wide_char;
+    if (p->is_wide_char)
+        *buf = p->u.str16;
+    else
+        *buf = p->u.str8;
+    return p->len;
+}
+
+JSValue JS_NewStringLatin1_real(JSContext *ctx, const uint8_t *buf, size_t len){
+    if (len > JS_STRING_LEN_MAX)
+        return JS_ThrowRangeError(ctx, "invalid string length");
+    return js_new_string8(ctx, buf, len);
+}
+
+JSValue JS_NewStringUTF16_real(JSContext *ctx, const uint16_t *buf, size_t len){
+    if (len > JS_STRING_LEN_MAX)
+        return JS_ThrowRangeError(ctx, "invalid string length");
+    return js_new_string16(ctx, buf, len);
+}
+
+JSValue JS_ThrowUncatchableError_real(JSContext *ctx, const char *msg){
+    JSValue ret = JS_ThrowInternalError(ctx, "%s", msg);
+    JS_SetUncatchableError(ctx, ctx->rt->current_exception, TRUE);
+    return ret;
+}
+
+/* Copies the current JS call stack, innermost frame first. Only touches
+   runtime state so it is safe to call from the interrupt handler. */
+int js_sample_stack(JSRuntime *rt, JSSampleFrame *frames, int max_frames){
+    JSStackFrame *sf;
+    JSObject *p;
+    JSFunctionBytecode *b;
+    JSSampleFrame *f;
+    int n = 0;
+
+    for(sf = rt->current_stack_frame; sf != NULL && n < max_frames; sf = sf->prev_frame) {
+        f = &frames[n++];
+        f->func_name[0] = '\0';
+        f->file_name[0] = '\0';
+        f->line_num = 0;
+        if (JS_VALUE_GET_TAG(sf->cur_func) != JS_TAG_OBJECT)
+            continue;
+        p = JS_VALUE_GET_OBJ(sf->cur_func);
+        if (js_class_has_bytecode(p->class_id)) {
+            b = p->u.func.function_bytecode;
+            JS_AtomGetStrRT(rt, f->func_name, sizeof(f->func_name), b->func_name);
+            if (b->has_debug) {
+                JS_AtomGetStrRT(rt, f->file_name, sizeof(f->file_name), b->debug.filename);
+                if (sf->cur_pc)
+                    f->line_num = find_line_num(b->realm, b, sf->cur_pc - b->byte_code_buf - 1);
+                else
+                    f->line_num = b->debug.line_num;
+            }
+        } else {
+            snprintf(f->func_name, sizeof(f->func_name), "(native)");
+        }
+    }
+    return n;
+}
+
+// JS_FreeContext leaves the jobs of the context queued, the runtime would
+// run them on the freed context the next time jobs are executed.
+void js_free_pending_jobs(JSContext *ctx) {
+    JSRuntime *rt = ctx->rt;
+    struct list_head *el, *el1;
+    int i;
+
+    list_for_each_safe(el, el1, &rt->job_list) {
+        JSJobEntry *e = list_entry(el, JSJobEntry, link);
+        if (e->ctx != ctx)
+            continue;
+        list_del(&e->link);
+        for(i = 0; i < e->argc; i++)
+            JS_FreeValue(ctx, e->argv[i]);
+        js_free(ctx, e);
+    }
+}
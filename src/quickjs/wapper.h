@@ -91,4 +91,26 @@ JSValue js_undefined();
 
 JSValue js_exception();
 
-JSValue js_null();
\ No newline at end of file
+JSValue js_null();
+
+void *JS_GetMallocOpaque_real(JSRuntime *rt);
+
+int JS_IsArrayBuffer_real(JSValueConst v);
+
+int JS_GetStringData_real(JSValueConst v, const void **buf, int *is_wide);
+
+JSValue JS_NewStringLatin1_real(JSContext *ctx, const uint8_t *buf, size_t len);
+
+JSValue JS_NewStringUTF16_real(JSContext *ctx, const uint16_t *buf, size_t len);
+
+JSValue JS_ThrowUncatchableError_real(JSContext *ctx, const char *msg);
+
+typedef struct JSSampleFrame {
+    char func_name[64];
+    char file_name[128];
+    int line_num;
+} JSSampleFrame;
+
+int js_sample_stack(JSRuntime *rt, JSSampleFrame *frames, int max_frames);
+
+void js_free_pending_jobs(JSContext *ctx);
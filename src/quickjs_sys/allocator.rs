@@ -0,0 +1,433 @@
+// Custom JSMallocFunctions for the QuickJS runtime.
+//
+// QuickJS allocates a very large number of small objects (shapes, property
+// tables, strings, closures...). The wasi-libc dlmalloc handles this pattern
+// poorly in long running scripts, and since `memory.grow` never shrinks in
+// wasm, fragmentation turns directly into resident memory. The slab allocator
+// below serves small requests from per size-class free lists carved out of
+// larger chunks, and falls back to the global allocator for the rest.
+//
+// Every block carries an 8 byte header holding its block size, which gives us
+// an exact `js_malloc_usable_size` (the stock wasi build reports 0) and thus
+// meaningful `malloc_size` accounting for memory limits.
+
+use super::qjs::*;
+use std::alloc::{alloc, dealloc, realloc, Layout};
+use std::os::raw::c_void;
+
+const HEADER_SIZE: usize = 8;
+const ALIGN: usize = 8;
+/// Bookkeeping overhead QuickJS adds per allocation in its own accounting.
+const MALLOC_OVERHEAD: usize = 8;
+
+/// Counters maintained by the malloc trampolines for any `JsAllocator`.
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy)]
+pub struct AllocStats {
+    pub alloc_count: usize,
+    pub free_count: usize,
+    pub realloc_count: usize,
+    pub live_bytes: usize,
+    pub peak_bytes: usize,
+    pub reserved_bytes: usize,
+}
+
+pub trait JsAllocator: 'static {
+    const NAME: &'static str;
+
+    /// Returns an 8-byte aligned block of at least `size` bytes, or null.
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8;
+
+    unsafe fn free(&mut self, ptr: *mut u8);
+
+    unsafe fn realloc(&mut self, ptr: *mut u8, size: usize) -> *mut u8;
+
+    /// Must not depend on allocator state, QuickJS calls it without opaque.
+    unsafe fn usable_size(ptr: *const u8) -> usize;
+
+    /// Bytes obtained from the underlying allocator, including free blocks.
+    fn reserved_bytes(&self) -> usize;
+}
+
+/// Common prefix of every `AllocState<A>`, used to read the stats back
+/// through the type erased malloc opaque.
+#[repr(C)]
+pub(crate) struct AllocStateHeader {
+    pub(crate) stats: AllocStats,
+    pub(crate) name: &'static str,
+}
+
+#[repr(C)]
+pub(crate) struct AllocState<A: JsAllocator> {
+    pub(crate) stats: AllocStats,
+    pub(crate) name: &'static str,
+    pub(crate) allocator: A,
+}
+
+impl<A: JsAllocator> AllocState<A> {
+    pub(crate) fn new(allocator: A) -> Self {
+        AllocState {
+            stats: AllocStats::default(),
+            name: A::NAME,
+            allocator,
+        }
+    }
+
+    unsafe fn from_malloc_state<'a>(s: *mut JSMallocState) -> &'a mut Self {
+        &mut *((*s).opaque as *mut Self)
+    }
+
+    fn on_alloc(&mut self, usable: usize) {
+        self.stats.alloc_count += 1;
+        self.stats.live_bytes += usable;
+        self.stats.peak_bytes = self.stats.peak_bytes.max(self.stats.live_bytes);
+        self.stats.reserved_bytes = self.allocator.reserved_bytes();
+    }
+
+    fn on_free(&mut self, usable: usize) {
+        self.stats.free_count += 1;
+        self.stats.live_bytes -= usable;
+        self.stats.reserved_bytes = self.allocator.reserved_bytes();
+    }
+}
+
+/// Whether `size` more bytes on top of `used` would pass `limit`. Huge
+/// requests, like an `ArrayBuffer` of near `usize::MAX`, must fail rather
+/// than wrap around.
+fn over_limit(used: usize, size: usize, limit: usize) -> bool {
+    used.checked_add(size).map_or(true, |n| n > limit)
+}
+
+unsafe extern "C" fn js_malloc<A: JsAllocator>(s: *mut JSMallocState, size: usize) -> *mut c_void {
+    if over_limit((*s).malloc_size, size, (*s).malloc_limit) {
+        return std::ptr::null_mut();
+    }
+    let state = AllocState::<A>::from_malloc_state(s);
+    let ptr = state.allocator.alloc(size);
+    if ptr.is_null() {
+        return std::ptr::null_mut();
+    }
+    let usable = A::usable_size(ptr);
+    (*s).malloc_count += 1;
+    (*s).malloc_size += usable + MALLOC_OVERHEAD;
+    state.on_alloc(usable);
+    ptr.cast()
+}
+
+unsafe extern "C" fn js_free<A: JsAllocator>(s: *mut JSMallocState, ptr: *mut c_void) {
+    if ptr.is_null() {
+        return;
+    }
+    let state = AllocState::<A>::from_malloc_state(s);
+    let usable = A::usable_size(ptr.cast());
+    (*s).malloc_count -= 1;
+    (*s).malloc_size -= usable + MALLOC_OVERHEAD;
+    state.allocator.free(ptr.cast());
+    state.on_free(usable);
+}
+
+unsafe extern "C" fn js_realloc<A: JsAllocator>(
+    s: *mut JSMallocState,
+    ptr: *mut c_void,
+    size: usize,
+) -> *mut c_void {
+    if ptr.is_null() {
+        if size == 0 {
+            return std::ptr::null_mut();
+        }
+        return js_malloc::<A>(s, size);
+    }
+    if size == 0 {
+        js_free::<A>(s, ptr);
+        return std::ptr::null_mut();
+    }
+    let old_size = A::usable_size(ptr.cast());
+    if over_limit((*s).malloc_size - old_size, size, (*s).malloc_limit) {
+        return std::ptr::null_mut();
+    }
+    let state = AllocState::<A>::from_malloc_state(s);
+    let new_ptr = state.allocator.realloc(ptr.cast(), size);
+    if new_ptr.is_null() {
+        return std::ptr::null_mut();
+    }
+    let new_size = A::usable_size(new_ptr);
+    (*s).malloc_size = (*s).malloc_size + new_size - old_size;
+    state.stats.realloc_count += 1;
+    state.stats.live_bytes = state.stats.live_bytes + new_size - old_size;
+    state.stats.peak_bytes = state.stats.peak_bytes.max(state.stats.live_bytes);
+    state.stats.reserved_bytes = state.allocator.reserved_bytes();
+    new_ptr.cast()
+}
+
+unsafe extern "C" fn js_malloc_usable_size<A: JsAllocator>(ptr: *const c_void) -> usize {
+    if ptr.is_null() {
+        0
+    } else {
+        A::usable_size(ptr.cast())
+    }
+}
+
+pub(crate) fn malloc_functions<A: JsAllocator>() -> JSMallocFunctions {
+    JSMallocFunctions {
+        js_malloc: Some(js_malloc::<A>),
+        js_free: Some(js_free::<A>),
+        js_realloc: Some(js_realloc::<A>),
+        js_malloc_usable_size: Some(js_malloc_usable_size::<A>),
+    }
+}
+
+#[inline]
+unsafe fn block_size(ptr: *const u8) -> usize {
+    *(ptr.sub(HEADER_SIZE) as *const usize)
+}
+
+#[inline]
+unsafe fn init_block(block: *mut u8, size: usize) -> *mut u8 {
+    *(block as *mut usize) = size;
+    block.add(HEADER_SIZE)
+}
+
+#[inline]
+fn round_up(size: usize) -> usize {
+    (size + HEADER_SIZE + ALIGN - 1) & !(ALIGN - 1)
+}
+
+unsafe fn system_alloc(size: usize) -> *mut u8 {
+    let total = round_up(size);
+    match Layout::from_size_align(total, ALIGN) {
+        Ok(layout) => {
+            let block = alloc(layout);
+            if block.is_null() {
+                block
+            } else {
+                init_block(block, total)
+            }
+        }
+        Err(_) => std::ptr::null_mut(),
+    }
+}
+
+unsafe fn system_free(ptr: *mut u8) {
+    let block = ptr.sub(HEADER_SIZE);
+    dealloc(block, Layout::from_size_align_unchecked(block_size(ptr), ALIGN));
+}
+
+unsafe fn system_realloc(ptr: *mut u8, size: usize) -> *mut u8 {
+    let total = round_up(size);
+    let block = ptr.sub(HEADER_SIZE);
+    let layout = Layout::from_size_align_unchecked(block_size(ptr), ALIGN);
+    let block = realloc(block, layout, total);
+    if block.is_null() {
+        block
+    } else {
+        init_block(block, total)
+    }
+}
+
+/// The global allocator with a size header, i.e. the stock behaviour but with
+/// exact usable sizes so that `JS_SetMemoryLimit` accounting is meaningful.
+#[derive(Default)]
+pub struct SystemAllocator {
+    reserved: usize,
+}
+
+impl JsAllocator for SystemAllocator {
+    const NAME: &'static str = "system";
+
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8 {
+        let ptr = system_alloc(size);
+        if !ptr.is_null() {
+            self.reserved += block_size(ptr);
+        }
+        ptr
+    }
+
+    unsafe fn free(&mut self, ptr: *mut u8) {
+        self.reserved -= block_size(ptr);
+        system_free(ptr)
+    }
+
+    unsafe fn realloc(&mut self, ptr: *mut u8, size: usize) -> *mut u8 {
+        let old = block_size(ptr);
+        let new_ptr = system_realloc(ptr, size);
+        if !new_ptr.is_null() {
+            self.reserved = self.reserved + block_size(new_ptr) - old;
+        }
+        new_ptr
+    }
+
+    unsafe fn usable_size(ptr: *const u8) -> usize {
+        block_size(ptr) - HEADER_SIZE
+    }
+
+    fn reserved_bytes(&self) -> usize {
+        self.reserved
+    }
+}
+
+// Block sizes include the 8 byte header. They follow the sizes QuickJS asks
+// for on wasm32: JSString headers (16) plus short payloads, JSObject (48),
+// JSShape with a handful of properties, closure var refs and small
+// JSProperty arrays. Everything above the largest class goes to the system.
+const SIZE_CLASSES: [usize; 21] = [
+    16, 24, 32, 40, 48, 56, 64, 72, 80, 96, 112, 128, 144, 160, 192, 224, 256, 320, 384, 448, 512,
+];
+const MAX_SMALL_BLOCK: usize = 512;
+const CHUNK_SIZE: usize = 16 * 1024;
+
+const fn size_class_table() -> [u8; MAX_SMALL_BLOCK / ALIGN + 1] {
+    let mut table = [0u8; MAX_SMALL_BLOCK / ALIGN + 1];
+    let mut slot = 0;
+    let mut class = 0;
+    while slot < table.len() {
+        while SIZE_CLASSES[class] < slot * ALIGN {
+            class += 1;
+        }
+        table[slot] = class as u8;
+        slot += 1;
+    }
+    table
+}
+
+/// Maps `block_size / 8` to the index of the smallest class that fits.
+static CLASS_OF: [u8; MAX_SMALL_BLOCK / ALIGN + 1] = size_class_table();
+
+struct FreeBlock {
+    next: *mut FreeBlock,
+}
+
+#[derive(Clone, Copy)]
+struct SizeClass {
+    free: *mut FreeBlock,
+    bump: *mut u8,
+    bump_end: *mut u8,
+}
+
+impl Default for SizeClass {
+    fn default() -> Self {
+        SizeClass {
+            free: std::ptr::null_mut(),
+            bump: std::ptr::null_mut(),
+            bump_end: std::ptr::null_mut(),
+        }
+    }
+}
+
+/// Size-class slab allocator. Freed small blocks go back to their class free
+/// list and are never returned to the system; chunks are 16 KiB.
+pub struct SlabAllocator {
+    classes: [SizeClass; SIZE_CLASSES.len()],
+    chunks: Vec<*mut u8>,
+    large_reserved: usize,
+}
+
+impl Default for SlabAllocator {
+    fn default() -> Self {
+        SlabAllocator {
+            classes: [SizeClass::default(); SIZE_CLASSES.len()],
+            chunks: Vec::new(),
+            large_reserved: 0,
+        }
+    }
+}
+
+impl SlabAllocator {
+    unsafe fn refill(&mut self, class: usize) -> bool {
+        let chunk = alloc(Layout::from_size_align_unchecked(CHUNK_SIZE, ALIGN));
+        if chunk.is_null() {
+            return false;
+        }
+        self.chunks.push(chunk);
+        let c = &mut self.classes[class];
+        c.bump = chunk;
+        c.bump_end = chunk.add(CHUNK_SIZE - CHUNK_SIZE % SIZE_CLASSES[class]);
+        true
+    }
+
+    unsafe fn alloc_small(&mut self, class: usize) -> *mut u8 {
+        let block_size = SIZE_CLASSES[class];
+        let c = &mut self.classes[class];
+        let block = if !c.free.is_null() {
+            let block = c.free;
+            c.free = (*block).next;
+            block as *mut u8
+        } else {
+            if c.bump == c.bump_end && !self.refill(class) {
+                return std::ptr::null_mut();
+            }
+            let c = &mut self.classes[class];
+            let block = c.bump;
+            c.bump = c.bump.add(block_size);
+            block
+        };
+        init_block(block, block_size)
+    }
+}
+
+impl JsAllocator for SlabAllocator {
+    const NAME: &'static str = "slab";
+
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8 {
+        let total = round_up(size);
+        if total <= MAX_SMALL_BLOCK {
+            self.alloc_small(CLASS_OF[total / ALIGN] as usize)
+        } else {
+            let ptr = system_alloc(size);
+            if !ptr.is_null() {
+                self.large_reserved += block_size(ptr);
+            }
+            ptr
+        }
+    }
+
+    unsafe fn free(&mut self, ptr: *mut u8) {
+        let size = block_size(ptr);
+        if size <= MAX_SMALL_BLOCK {
+            let block = ptr.sub(HEADER_SIZE) as *mut FreeBlock;
+            let c = &mut self.classes[CLASS_OF[size / ALIGN] as usize];
+            (*block).next = c.free;
+            c.free = block;
+        } else {
+            self.large_reserved -= size;
+            system_free(ptr)
+        }
+    }
+
+    unsafe fn realloc(&mut self, ptr: *mut u8, size: usize) -> *mut u8 {
+        let old_block = block_size(ptr);
+        let total = round_up(size);
+        if total <= old_block && (old_block <= MAX_SMALL_BLOCK || total > MAX_SMALL_BLOCK) {
+            return ptr;
+        }
+        if old_block > MAX_SMALL_BLOCK && total > MAX_SMALL_BLOCK {
+            let new_ptr = system_realloc(ptr, size);
+            if !new_ptr.is_null() {
+                self.large_reserved = self.large_reserved + block_size(new_ptr) - old_block;
+            }
+            return new_ptr;
+        }
+        let new_ptr = self.alloc(size);
+        if !new_ptr.is_null() {
+            let n = (old_block - HEADER_SIZE).min(size);
+            std::ptr::copy_nonoverlapping(ptr, new_ptr, n);
+            self.free(ptr);
+        }
+        new_ptr
+    }
+
+    unsafe fn usable_size(ptr: *const u8) -> usize {
+        block_size(ptr) - HEADER_SIZE
+    }
+
+    fn reserved_bytes(&self) -> usize {
+        self.chunks.len() * CHUNK_SIZE + self.large_reserved
+    }
+}
+
+impl Drop for SlabAllocator {
+    fn drop(&mut self) {
+        for chunk in self.chunks.drain(..) {
+            unsafe { dealloc(chunk, Layout::from_size_align_unchecked(CHUNK_SIZE, ALIGN)) };
+        }
+    }
+}
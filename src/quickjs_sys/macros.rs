@@ -109,3 +109,15 @@ macro_rules! assert_size_zero {
         let _ = AssertSize::<$t>::F_SIZE_MUST_ZERO;
     }};
 }
+
+/// Wraps a native function in a trace span while keeping it zero sized, as
+/// `Context::wrap_function` requires.
+#[macro_export]
+macro_rules! traced_fn {
+    ($name:expr, $cat:expr, $f:path) => {
+        |ctx: &mut Context, this_val: JsValue, argv: &[JsValue]| -> JsValue {
+            let _span = $crate::quickjs_sys::trace::span($name, $cat);
+            $f(ctx, this_val, argv)
+        }
+    };
+}
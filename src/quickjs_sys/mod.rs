@@ -1,14 +1,21 @@
 #[macro_use]
 mod macros;
+pub mod allocator;
 pub mod js_class;
 pub mod js_module;
+pub mod profiler;
 pub mod resolver;
+mod sab;
+pub mod trace;
 pub mod transpiler;
 
 use std::collections::HashMap;
 
+pub use allocator::{AllocStats, JsAllocator, SlabAllocator, SystemAllocator};
 pub use js_class::*;
 pub use js_module::{JsModuleDef, ModuleInit};
+pub use profiler::Profiler;
+pub use sab::SabRef;
 
 use flate2::bufread::GzDecoder;
 use lazy_static::lazy_static;
@@ -77,18 +84,59 @@ pub trait JsFn {
     fn call(ctx: &mut Context, this_val: JsValue, argv: &[JsValue]) -> JsValue;
 }
 
+/// Compiled bytecode of the embedded module library, shared by every
+/// context of a runtime so that warm runs skip parsing.
+#[derive(Default)]
+struct ModuleCache {
+    bytecode: HashMap<String, Vec<u8>>,
+}
+
+unsafe fn load_module_bytecode(ctx: *mut JSContext, buf: &[u8]) -> *mut JSModuleDef {
+    let func_val = JS_ReadObject(ctx, buf.as_ptr(), buf.len(), JS_READ_OBJ_BYTECODE as i32);
+    if JS_IsException_real(func_val) != 0 {
+        return std::ptr::null_mut();
+    }
+    js_module_set_import_meta(ctx, func_val, 0, 0);
+    let m = JS_VALUE_GET_PTR_real(func_val);
+    JS_FreeValue_real(ctx, func_val);
+    m.cast()
+}
+
+/// Charges the time since the last profiler sample to the current stack,
+/// topped with the frame returned by `label`.
+unsafe fn profile_mark<F: FnOnce() -> Option<String>>(ctx: *mut JSContext, label: F) {
+    let rt = JS_GetRuntime(ctx);
+    if let Some(event_loop) = (JS_GetRuntimeOpaque(rt) as *mut super::EventLoop).as_mut() {
+        if let Some(profiler) = event_loop.profiler() {
+            profiler.mark_rt(rt, label().as_deref());
+        }
+    }
+}
+
 unsafe extern "C" fn module_loader(
     ctx: *mut JSContext,
     module_name_: *const ::std::os::raw::c_char,
-    _opaque: *mut ::std::os::raw::c_void,
+    opaque: *mut ::std::os::raw::c_void,
 ) -> *mut JSModuleDef {
     let module_name = std::ffi::CStr::from_ptr(module_name_).to_str();
     if module_name.is_err() {
         return std::ptr::null_mut();
     }
     let module_name = module_name.unwrap();
+    let _span = trace::span_with("module_loader", "module", || module_name.to_string());
+
+    profile_mark(ctx, || None);
+
+    let cache = (opaque as *mut ModuleCache).as_mut();
+    if let Some(buf) = cache.as_ref().and_then(|c| c.bytecode.get(module_name)) {
+        let _span = trace::span("bytecode read", "module");
+        let m = load_module_bytecode(ctx, buf);
+        profile_mark(ctx, || Some(format!("(load bytecode {})", module_name)));
+        return m;
+    }
 
     let code = resolver::import(module_name);
+    profile_mark(ctx, || Some(format!("(transpile {})", module_name)));
 
     if code.is_err() {
         JS_ThrowReferenceError(
@@ -115,18 +163,37 @@ unsafe extern "C" fn module_loader(
     let buf = make_c_string(buf);
 
     // compile the module
-    let func_val = JS_Eval(
-        ctx,
-        buf.as_ptr(),
-        buf_len,
-        module_name_,
-        (JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY) as i32,
-    );
+    let func_val = {
+        let _span = trace::span("JS_Eval compile", "module");
+        JS_Eval(
+            ctx,
+            buf.as_ptr(),
+            buf_len,
+            module_name_,
+            (JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY) as i32,
+        )
+    };
+
+    profile_mark(ctx, || Some(format!("(compile {})", module_name)));
 
     if JS_IsException_real(func_val) != 0 {
         return std::ptr::null_mut();
     }
 
+    // user files may change between runs, only the embedded ones are cached
+    if let Some(cache) = cache {
+        if resolver::is_embedded(module_name) {
+            let _span = trace::span("bytecode write", "module");
+            let mut len = 0;
+            let ptr = JS_WriteObject(ctx, &mut len, func_val, JS_WRITE_OBJ_BYTECODE as i32);
+            if !ptr.is_null() {
+                let bytecode = std::slice::from_raw_parts(ptr, len).to_vec();
+                cache.bytecode.insert(module_name.to_string(), bytecode);
+                js_free(ctx, ptr.cast());
+            }
+        }
+    }
+
     js_module_set_import_meta(ctx, func_val, 0, 0);
 
     let m = JS_VALUE_GET_PTR_real(func_val);
@@ -135,38 +202,186 @@ unsafe extern "C" fn module_loader(
     m.cast()
 }
 
-pub struct Runtime(*mut JSRuntime);
+unsafe extern "C" fn interrupt_handler(
+    rt: *mut JSRuntime,
+    _opaque: *mut ::std::os::raw::c_void,
+) -> ::std::os::raw::c_int {
+    match (JS_GetRuntimeOpaque(rt) as *mut super::EventLoop).as_mut() {
+        Some(event_loop) => {
+            if let Some(profiler) = event_loop.profiler() {
+                profiler.tick(rt);
+            }
+            event_loop.on_interrupt() as ::std::os::raw::c_int
+        }
+        None => 0,
+    }
+}
+
+/// Heap backing a runtime, see `--allocator`.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum AllocatorKind {
+    /// The wasi libc malloc.
+    Default,
+    System,
+    Slab,
+}
+
+/// Settings from the command line that every runtime of the process is
+/// created with, worker threads included.
+#[derive(Clone, Debug)]
+pub struct RuntimeOptions {
+    pub allocator: AllocatorKind,
+    pub memory_limit: Option<usize>,
+    pub gc_threshold: Option<usize>,
+    pub max_stack_size: Option<usize>,
+    pub idle_gc: bool,
+}
+
+impl Default for RuntimeOptions {
+    fn default() -> Self {
+        RuntimeOptions {
+            allocator: AllocatorKind::Default,
+            memory_limit: None,
+            gc_threshold: None,
+            max_stack_size: None,
+            idle_gc: true,
+        }
+    }
+}
+
+pub struct Runtime {
+    rt: *mut JSRuntime,
+    module_cache: Box<ModuleCache>,
+    // Custom allocator state passed as malloc opaque, freed after the runtime.
+    alloc_state: Option<(*mut std::os::raw::c_void, unsafe fn(*mut std::os::raw::c_void))>,
+}
 
 impl Runtime {
     pub fn new() -> Self {
+        unsafe { Self::init(JS_NewRuntime(), None) }
+    }
+
+    /// Creates a runtime set up by `opts`, which its event loop keeps for
+    /// the workers it spawns.
+    pub fn new_with_options(opts: &RuntimeOptions) -> Self {
+        // The wasi libc malloc reports no usable sizes, so a heap limit would
+        // only count per-allocation overhead. Account real sizes instead.
+        let allocator = match opts.allocator {
+            AllocatorKind::Default if opts.memory_limit.is_some() => AllocatorKind::System,
+            allocator => allocator,
+        };
+        let mut rt = match allocator {
+            AllocatorKind::Default => Runtime::new(),
+            AllocatorKind::System => Runtime::new_with_allocator(SystemAllocator::default()),
+            AllocatorKind::Slab => Runtime::new_with_allocator(SlabAllocator::default()),
+        };
+        if let Some(limit) = opts.memory_limit {
+            rt.set_memory_limit(limit);
+        }
+        if let Some(threshold) = opts.gc_threshold {
+            rt.set_gc_threshold(threshold);
+        }
+        if let Some(size) = opts.max_stack_size {
+            rt.set_max_stack_size(size);
+        }
+        if let Some(event_loop) = rt.event_loop() {
+            event_loop.set_idle_gc(opts.idle_gc);
+            event_loop.set_runtime_options(opts.clone());
+        }
+        rt
+    }
+
+    /// Creates a runtime whose QuickJS heap is served by `allocator`
+    /// instead of the libc malloc.
+    pub fn new_with_allocator<A: JsAllocator>(allocator: A) -> Self {
+        unsafe fn drop_state<A: JsAllocator>(p: *mut std::os::raw::c_void) {
+            Box::from_raw(p as *mut allocator::AllocState<A>);
+        }
         unsafe {
-            let mut rt = Runtime(JS_NewRuntime());
-            JS_SetModuleLoaderFunc(rt.0, None, Some(module_loader), std::ptr::null_mut());
-            rt.init_event_loop();
-            rt
+            let state = Box::into_raw(Box::new(allocator::AllocState::new(allocator)));
+            let mf = allocator::malloc_functions::<A>();
+            let rt = JS_NewRuntime2(&mf, state.cast());
+            if rt.is_null() {
+                drop_state::<A>(state.cast());
+                panic!("failed to create runtime with {} allocator", A::NAME);
+            }
+            Self::init(rt, Some((state.cast(), drop_state::<A>)))
         }
     }
 
+    unsafe fn init(
+        rt: *mut JSRuntime,
+        alloc_state: Option<(*mut std::os::raw::c_void, unsafe fn(*mut std::os::raw::c_void))>,
+    ) -> Self {
+        let mut rt = Runtime {
+            rt,
+            module_cache: Box::new(ModuleCache::default()),
+            alloc_state,
+        };
+        let cache: *mut ModuleCache = rt.module_cache.as_mut();
+        JS_SetModuleLoaderFunc(rt.rt, None, Some(module_loader), cache.cast());
+        JS_SetInterruptHandler(rt.rt, Some(interrupt_handler), std::ptr::null_mut());
+        sab::install(rt.rt);
+        rt.init_event_loop();
+        rt
+    }
+
     fn init_event_loop(&mut self) {
         unsafe {
             let event_loop = Box::new(super::EventLoop::default());
             let event_loop_ptr: &'static mut super::EventLoop = Box::leak(event_loop);
-            JS_SetRuntimeOpaque(self.0, (event_loop_ptr as *mut super::EventLoop).cast());
+            JS_SetRuntimeOpaque(self.rt, (event_loop_ptr as *mut super::EventLoop).cast());
         }
     }
     fn drop_event_loop(&mut self) {
         unsafe {
-            let event_loop = JS_GetRuntimeOpaque(self.0) as *mut super::EventLoop;
+            let event_loop = JS_GetRuntimeOpaque(self.rt) as *mut super::EventLoop;
             if !event_loop.is_null() {
                 Box::from_raw(event_loop); // drop
             }
         }
     }
 
+    /// Caps the QuickJS heap; allocations past it throw "out of memory".
+    /// Only meaningful with a custom allocator, the wasi libc malloc reports
+    /// no usable sizes to the accounting.
+    pub fn set_memory_limit(&mut self, limit: usize) {
+        unsafe { JS_SetMemoryLimit(self.rt, limit) }
+    }
+
+    /// Bytes of heap growth between two automatic GC runs.
+    pub fn set_gc_threshold(&mut self, threshold: usize) {
+        unsafe { JS_SetGCThreshold(self.rt, threshold) }
+    }
+
+    /// Native stack budget for JS recursion, 0 disables the check.
+    pub fn set_max_stack_size(&mut self, size: usize) {
+        unsafe { JS_SetMaxStackSize(self.rt, size) }
+    }
+
+    pub fn run_gc(&mut self) {
+        unsafe { JS_RunGC(self.rt) }
+    }
+
+    /// Name and counters of the custom allocator, `None` for libc malloc.
+    pub fn allocator_stats(&self) -> Option<(&'static str, AllocStats)> {
+        unsafe { allocator_stats(self.rt) }
+    }
+
+    pub fn event_loop(&mut self) -> Option<&mut super::EventLoop> {
+        unsafe { (JS_GetRuntimeOpaque(self.rt) as *mut super::EventLoop).as_mut() }
+    }
+
+    /// Runs `f` in a fresh context. Pending event loop tasks are dropped
+    /// before the context is freed, so the runtime can be reused.
     pub fn run_with_context<F: FnMut(&mut Context) -> R, R>(&mut self, mut f: F) -> R {
         unsafe {
-            let mut ctx = Context::new_with_rt(self.0);
-            f(&mut ctx)
+            let mut ctx = Context::new_with_rt(self.rt);
+            let r = f(&mut ctx);
+            if let Some(event_loop) = ctx.event_loop() {
+                event_loop.reset();
+            }
+            r
         }
     }
 }
@@ -174,10 +389,54 @@ impl Runtime {
 impl Drop for Runtime {
     fn drop(&mut self) {
         self.drop_event_loop();
-        unsafe { JS_FreeRuntime(self.0) };
+        unsafe {
+            JS_FreeRuntime(self.rt);
+            if let Some((state, drop_fn)) = self.alloc_state.take() {
+                drop_fn(state);
+            }
+        }
+    }
+}
+
+/// A value encoded by `Context::serialize`, it can move to another thread
+/// and be decoded by any runtime there.
+pub struct Serialized {
+    data: Vec<u8>,
+    // keeps the posted SharedArrayBuffers alive until decoded
+    sabs: Vec<SabRef>,
+}
+
+/// Subset of `JSMemoryUsage` reported by `JS_ComputeMemoryUsage`.
+#[derive(Debug, Default, Clone, Copy)]
+pub struct MemoryUsage {
+    pub malloc_size: i64,
+    pub malloc_limit: i64,
+    pub malloc_count: i64,
+    pub memory_used_size: i64,
+    pub memory_used_count: i64,
+    pub obj_count: i64,
+    pub str_size: i64,
+    pub binary_object_count: i64,
+    pub binary_object_size: i64,
+}
+
+/// Prints the pending exception, unless it is the uncatchable error thrown
+/// by a trapped `exit()`.
+unsafe fn dump_error(ctx: *mut JSContext) {
+    let event_loop = JS_GetRuntimeOpaque(JS_GetRuntime(ctx)) as *mut super::EventLoop;
+    match event_loop.as_ref() {
+        Some(event_loop) if event_loop.exit_code().is_some() => {
+            JS_FreeValue_real(ctx, JS_GetException(ctx));
+        }
+        _ => js_std_dump_error(ctx),
     }
 }
 
+unsafe fn allocator_stats(rt: *mut JSRuntime) -> Option<(&'static str, AllocStats)> {
+    let state = JS_GetMallocOpaque_real(rt) as *const allocator::AllocStateHeader;
+    state.as_ref().map(|s| (s.name, s.stats))
+}
+
 struct JsFunctionTrampoline;
 impl JsFunctionTrampoline {
     // How i figured it out!
@@ -287,6 +546,21 @@ impl Context {
         unsafe { (JS_GetRuntimeOpaque(self.rt()) as *mut super::EventLoop).as_mut() }
     }
 
+    /// Code passed to a trapped `exit()` during the current script.
+    pub fn exit_code(&mut self) -> Option<i32> {
+        self.event_loop().and_then(|event_loop| event_loop.exit_code())
+    }
+
+    /// See `Profiler::mark`, a no-op unless profiling.
+    pub fn profile_mark(&mut self, label: Option<&str>) {
+        unsafe { profile_mark(self.ctx, || label.map(|l| l.to_string())) }
+    }
+
+    /// Whether the current script ran out of its time budget.
+    pub fn timed_out(&mut self) -> bool {
+        self.event_loop().map_or(false, |event_loop| event_loop.timed_out())
+    }
+
     fn event_loop_run_once(&mut self) -> std::io::Result<usize> {
         unsafe {
             if let Some(event_loop) =
@@ -299,6 +573,37 @@ impl Context {
         }
     }
 
+    pub fn allocator_stats(&mut self) -> Option<(&'static str, AllocStats)> {
+        unsafe { allocator_stats(self.rt()) }
+    }
+
+    pub fn memory_usage(&mut self) -> MemoryUsage {
+        unsafe {
+            let mut usage = mem::zeroed::<JSMemoryUsage>();
+            JS_ComputeMemoryUsage(self.rt(), &mut usage);
+            MemoryUsage {
+                malloc_size: usage.malloc_size,
+                malloc_limit: usage.malloc_limit,
+                malloc_count: usage.malloc_count,
+                memory_used_size: usage.memory_used_size,
+                memory_used_count: usage.memory_used_count,
+                obj_count: usage.obj_count,
+                str_size: usage.str_size,
+                binary_object_count: usage.binary_object_count,
+                binary_object_size: usage.binary_object_size,
+            }
+        }
+    }
+
+    pub fn run_gc(&mut self) {
+        unsafe { JS_RunGC(self.rt()) }
+    }
+
+    /// Defines a global `gc()` like node's `--expose-gc`.
+    pub fn expose_gc(&mut self) {
+        super::modules_rs::process::expose_gc(self);
+    }
+
     #[inline]
     unsafe fn rt(&mut self) -> *mut JSRuntime {
         JS_GetRuntime(self.ctx)
@@ -309,6 +614,7 @@ impl Context {
     }
 
     unsafe fn new_with_rt(rt: *mut JSRuntime) -> Context {
+        let _span = trace::span("Context::new_with_rt", "init");
         let ctx = JS_NewContext(rt);
         JS_AddIntrinsicBigFloat(ctx);
         JS_AddIntrinsicBigDecimal(ctx);
@@ -321,13 +627,48 @@ impl Context {
 
         js_init_dirname(&mut ctx);
 
-        super::modules_rs::core::init_global_function(&mut ctx);
-        super::modules_rs::core::init_ext_function(&mut ctx);
-        super::modules_rs::encoding::init_encoding_module(&mut ctx);
-        super::modules_rs::os::init_module(&mut ctx);
-        super::modules_rs::fs::init_module(&mut ctx);
-        super::modules_rs::tty::init_module(&mut ctx);
-        super::modules_rs::sys::init_module(&mut ctx);
+        macro_rules! traced_init {
+            ($name:expr, $init:path) => {{
+                let _span = trace::span($name, "init");
+                $init(&mut ctx);
+            }};
+        }
+        traced_init!(
+            "core globals",
+            super::modules_rs::core::init_global_function
+        );
+        traced_init!("core ext", super::modules_rs::core::init_ext_function);
+        traced_init!(
+            "_encoding",
+            super::modules_rs::encoding::init_encoding_module
+        );
+        traced_init!("_node:os", super::modules_rs::os::init_module);
+        traced_init!("_node:buffer", super::modules_rs::buffer::init_module);
+        traced_init!("_node:crypto", super::modules_rs::crypto::init_module);
+        traced_init!("_node:zlib", super::modules_rs::zlib::init_module);
+        traced_init!(
+            "_node:string_decoder",
+            super::modules_rs::string_decoder::init_module
+        );
+        traced_init!("_node:process", super::modules_rs::process::init_module);
+        traced_init!(
+            "_node:perf_hooks",
+            super::modules_rs::perf_hooks::init_module
+        );
+        traced_init!("_node:fs", super::modules_rs::fs::init_module);
+        traced_init!("_node:url", super::modules_rs::url::init_module);
+        traced_init!(
+            "_node:querystring",
+            super::modules_rs::querystring::init_module
+        );
+        traced_init!("_node:tty", super::modules_rs::tty::init_module);
+        traced_init!("_drop:json", super::modules_rs::json::init_module);
+        traced_init!("_drop:sys", super::modules_rs::sys::init_module);
+        traced_init!("_drop:tar", super::modules_rs::tar::init_module);
+        traced_init!(
+            "_node:worker_threads",
+            super::modules_rs::worker_threads::init_module
+        );
 
         ctx
     }
@@ -384,7 +725,7 @@ impl Context {
                 )
             };
             if JS_IsException_real(val) > 0 {
-                js_std_dump_error(ctx);
+                dump_error(ctx);
             }
             JsValue::from_qjs_value(ctx, val)
         }
@@ -394,9 +735,10 @@ impl Context {
         self.eval_buf(code.into_bytes(), "<evalScript>", JS_EVAL_TYPE_GLOBAL)
     }
 
-    pub fn eval_module_str(&mut self, code: String, filename: &str) {
-        self.eval_buf(code.into_bytes(), filename, JS_EVAL_TYPE_MODULE);
+    pub fn eval_module_str(&mut self, code: String, filename: &str) -> JsValue {
+        let r = self.eval_buf(code.into_bytes(), filename, JS_EVAL_TYPE_MODULE);
         self.promise_loop_poll();
+        r
     }
 
     pub fn new_function<F: JsFn>(&mut self, name: &str) -> JsFunction {
@@ -449,6 +791,14 @@ impl Context {
         }
     }
 
+    /// Zeroed ArrayBuffer, to be filled through `AsMut`.
+    pub fn new_array_buffer_zeroed(&mut self, len: usize) -> JsValue {
+        unsafe {
+            let v = JS_NewArrayBufferCopy(self.ctx, std::ptr::null(), len);
+            JsValue::from_qjs_value(self.ctx, v)
+        }
+    }
+
     pub fn new_array_buffer_t<T: Sized>(&mut self, buff: &[T]) -> JsArrayBuffer {
         unsafe {
             let v = JS_NewArrayBufferCopy(
@@ -467,6 +817,22 @@ impl Context {
         }
     }
 
+    /// String from Latin1 bytes, stored by QuickJS as is.
+    pub fn new_string_latin1(&mut self, buf: &[u8]) -> JsValue {
+        unsafe {
+            let v = JS_NewStringLatin1_real(self.ctx, buf.as_ptr(), buf.len());
+            JsValue::from_qjs_value(self.ctx, v)
+        }
+    }
+
+    /// String from UTF-16 code units, stored by QuickJS as is.
+    pub fn new_string_utf16(&mut self, buf: &[u16]) -> JsValue {
+        unsafe {
+            let v = JS_NewStringUTF16_real(self.ctx, buf.as_ptr(), buf.len());
+            JsValue::from_qjs_value(self.ctx, v)
+        }
+    }
+
     pub fn value_to_string(&mut self, v: &JsValue) -> JsValue {
         unsafe {
             let v = JS_ToString(self.ctx, v.get_qjs_value());
@@ -474,6 +840,59 @@ impl Context {
         }
     }
 
+    /// Encodes `v` with the QuickJS object serializer, the structured clone
+    /// of `postMessage`. Cycles and shared references survive, functions
+    /// and class instances throw. SharedArrayBuffers are not copied, the
+    /// message holds a reference to their memory instead.
+    pub fn serialize(&mut self, v: &JsValue) -> Result<Serialized, JsException> {
+        unsafe {
+            let mut len = 0;
+            let mut sab_tab: *mut *mut u8 = std::ptr::null_mut();
+            let mut sab_tab_len = 0;
+            let ptr = JS_WriteObject2(
+                self.ctx,
+                &mut len,
+                v.get_qjs_value(),
+                (JS_WRITE_OBJ_REFERENCE | JS_WRITE_OBJ_SAB) as i32,
+                &mut sab_tab,
+                &mut sab_tab_len,
+            );
+            if ptr.is_null() {
+                return Err(JsException(JsRef {
+                    ctx: self.ctx,
+                    v: js_exception(),
+                }));
+            }
+            let data = std::slice::from_raw_parts(ptr, len).to_vec();
+            js_free(self.ctx, ptr.cast());
+            let mut sabs = Vec::with_capacity(sab_tab_len);
+            if !sab_tab.is_null() {
+                for &p in std::slice::from_raw_parts(sab_tab, sab_tab_len) {
+                    sabs.push(SabRef::retain(p.cast()));
+                }
+                js_free(self.ctx, sab_tab.cast());
+            }
+            Ok(Serialized { data, sabs })
+        }
+    }
+
+    /// Decodes a `serialize` result, `Err` holds the error thrown while
+    /// decoding and leaves no exception pending.
+    pub fn deserialize(&mut self, msg: &Serialized) -> Result<JsValue, JsValue> {
+        unsafe {
+            let v = JS_ReadObject(
+                self.ctx,
+                msg.data.as_ptr(),
+                msg.data.len(),
+                (JS_READ_OBJ_REFERENCE | JS_READ_OBJ_SAB) as i32,
+            );
+            if JS_IsException_real(v) != 0 {
+                return Err(JsValue::from_qjs_value(self.ctx, JS_GetException(self.ctx)));
+            }
+            Ok(JsValue::from_qjs_value(self.ctx, v))
+        }
+    }
+
     pub fn new_error(&mut self, msg: &str) -> JsValue {
         let msg = self.new_string(msg);
         let error = unsafe { JS_NewError(self.ctx) };
@@ -491,6 +910,15 @@ impl Context {
         }
     }
 
+    /// Throws an InternalError that `catch` cannot intercept, unwinding the
+    /// whole script.
+    pub fn throw_uncatchable_error(&mut self, msg: &str) -> JsException {
+        unsafe {
+            let v = JS_ThrowUncatchableError_real(self.ctx, make_c_string(msg).as_ptr());
+            JsException(JsRef { ctx: self.ctx, v })
+        }
+    }
+
     pub fn throw_error(&mut self, obj: JsValue) -> JsException {
         unsafe {
             let v = JS_Throw(self.ctx, obj.into_qjs_value());
@@ -519,6 +947,13 @@ impl Context {
         }
     }
 
+    pub fn throw_syntax_error(&mut self, msg: &str) -> JsException {
+        unsafe {
+            let v = JS_ThrowSyntaxError(self.ctx, make_c_string(msg).as_ptr());
+            JsException(JsRef { ctx: self.ctx, v })
+        }
+    }
+
     pub fn new_promise(&mut self) -> (JsValue, JsValue, JsValue) {
         unsafe {
             let ctx = self.ctx;
@@ -533,6 +968,38 @@ impl Context {
         }
     }
 
+    /// Runs `file_path` as the entry module, `args` become `process.argv`
+    /// after it, then drives the event loop until it drains.
+    pub fn run_entry_module(
+        &mut self,
+        file_path: &str,
+        mut args: Vec<String>,
+    ) -> Result<(), String> {
+        let entrypoint = resolver::import(file_path)
+            .map_err(|e| format!("file not found: {}: {}", file_path, e))?;
+        let code =
+            String::from_utf8(entrypoint).map_err(|_| format!("invalid format: {}", file_path))?;
+        args.insert(0, file_path.to_owned());
+        self.put_args(args);
+        self.js_loop().map_err(|e| e.to_string())?;
+        let make_require_global = r#"
+    ;(async () => {
+        const { require } = await import("commonjs");
+        globalThis.require = require;
+    })();
+    "#;
+        self.eval_global_str(make_require_global.to_owned());
+        self.promise_loop_poll();
+        let r = self.eval_module_str(code, file_path);
+        if self.timed_out() {
+            return Err("time budget exceeded".to_owned());
+        }
+        if r.is_exception() && self.exit_code().is_none() {
+            return Err(format!("uncaught exception in {}", file_path));
+        }
+        self.js_loop().map_err(|e| e.to_string())
+    }
+
     pub fn promise_loop_poll(&mut self) {
         unsafe {
             let rt = self.rt();
@@ -542,7 +1009,7 @@ impl Context {
                 let err = JS_ExecutePendingJob(rt, (&mut pctx) as *mut *mut JSContext);
                 if err <= 0 {
                     if err < 0 {
-                        js_std_dump_error(pctx);
+                        dump_error(pctx);
                     }
                     break;
                 }
@@ -556,17 +1023,35 @@ impl Context {
 
             let mut pctx: *mut JSContext = 0 as *mut JSContext;
             loop {
+                let _span = trace::span("js_loop iteration", "loop");
+                // exit() from the entry module leaves its jobs unrun, like node
+                if self.exit_code().is_some() {
+                    return Ok(());
+                }
                 'pending: loop {
                     let err = JS_ExecutePendingJob(rt, (&mut pctx) as *mut *mut JSContext);
                     if err <= 0 {
                         if err < 0 {
-                            js_std_dump_error(pctx);
-                            return Err(std::io::Error::from(std::io::ErrorKind::Other));
+                            dump_error(pctx);
+                            if self.exit_code().is_some() {
+                                return Ok(());
+                            }
+                            if !self.timed_out() {
+                                return Err(std::io::Error::from(std::io::ErrorKind::Other));
+                            }
                         }
                         break 'pending;
                     }
                 }
-                if self.event_loop_run_once()? == 0 {
+                // interrupts inside timer or fd callbacks are swallowed by
+                // the callback, so the flag is checked here as well
+                if self.timed_out() {
+                    return Err(std::io::Error::new(
+                        std::io::ErrorKind::TimedOut,
+                        "time budget exceeded",
+                    ));
+                }
+                if self.exit_code().is_some() || self.event_loop_run_once()? == 0 {
                     return Ok(());
                 }
             }
@@ -577,6 +1062,9 @@ impl Context {
 impl Drop for Context {
     fn drop(&mut self) {
         unsafe {
+            // a trapped exit(), a timeout or an uncaught job error stops the
+            // loop with jobs still queued, they must not outlive the context
+            js_free_pending_jobs(self.ctx);
             JS_FreeContext(self.ctx);
         }
     }
@@ -683,6 +1171,21 @@ pub trait AsObject {
         }
     }
 
+    /// Defines an own enumerable data property, bypassing setters and the
+    /// `__proto__` accessor. `key` may contain NUL.
+    fn define(&mut self, key: &str, value: JsValue) -> bool {
+        unsafe {
+            let js_ref = self.js_ref();
+            let ctx = js_ref.ctx;
+            let atom = JS_NewAtomLen(ctx, key.as_ptr().cast(), key.len() as _);
+            let flags = JS_PROP_ENUMERABLE | JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE;
+            let r =
+                JS_DefinePropertyValue(ctx, js_ref.v, atom, value.into_qjs_value(), flags as i32);
+            JS_FreeAtom(ctx, atom);
+            r >= 0
+        }
+    }
+
     fn invoke(&mut self, fn_name: &str, argv: &[JsValue]) -> JsValue {
         unsafe {
             let js_ref = self.js_ref();
@@ -942,6 +1445,30 @@ impl JsString {
     }
 }
 
+/// The code units QuickJS stores a string as.
+pub enum JsStringData<'a> {
+    Latin1(&'a [u8]),
+    Utf16(&'a [u16]),
+}
+
+impl JsString {
+    /// Borrows the string's internal storage, without converting to UTF-8.
+    pub fn data(&self) -> JsStringData<'_> {
+        unsafe {
+            let mut buf = std::ptr::null();
+            let mut is_wide = 0;
+            let len = JS_GetStringData_real(self.0.v, &mut buf, &mut is_wide).max(0) as usize;
+            if len == 0 {
+                JsStringData::Latin1(&[])
+            } else if is_wide != 0 {
+                JsStringData::Utf16(std::slice::from_raw_parts(buf as *const u16, len))
+            } else {
+                JsStringData::Latin1(std::slice::from_raw_parts(buf as *const u8, len))
+            }
+        }
+    }
+}
+
 impl PartialEq for JsString {
     fn eq(&self, other: &Self) -> bool {
         self.as_str() == other.as_str()
@@ -1030,6 +1557,8 @@ impl JsValue {
                         JsValue::Array(JsArray(JsRef { ctx, v }))
                     } else if JS_IsPromise(ctx, v) != 0 {
                         JsValue::Promise(JsPromise(JsRef { ctx, v }))
+                    } else if JS_IsArrayBuffer_real(v) != 0 {
+                        JsValue::ArrayBuffer(JsArrayBuffer(JsRef { ctx, v }))
                     } else {
                         JsValue::Object(JsObject(JsRef { ctx, v }))
                     }
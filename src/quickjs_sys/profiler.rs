@@ -0,0 +1,227 @@
+// Sampling CPU profiler driven by the QuickJS interrupt handler.
+//
+// QuickJS polls the interrupt handler roughly every 10k branches or calls.
+// Whenever at least `interval` has elapsed since the last sample, the JS
+// stack is copied with `js_sample_stack` and the elapsed time is charged to
+// it. Work that never reaches the interrupt handler (module transpile and
+// compile, event loop waits) is charged explicitly through `mark` with a
+// synthetic frame on top of the current stack.
+
+use super::qjs::*;
+use super::Context;
+use std::collections::HashMap;
+use std::io::Write;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+const MAX_FRAMES: usize = 64;
+
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+struct Frame {
+    name: String,
+    file: String,
+    line: i32,
+}
+
+impl Frame {
+    fn synthetic(name: &str) -> Self {
+        Frame {
+            name: name.to_string(),
+            file: String::new(),
+            line: 0,
+        }
+    }
+}
+
+struct Node {
+    frame: Frame,
+    children: HashMap<Frame, usize>,
+    hit_count: u64,
+}
+
+pub struct Profiler {
+    interval: Duration,
+    start: Instant,
+    start_us: u128,
+    last: Instant,
+    // call tree, node 0 is the root
+    nodes: Vec<Node>,
+    samples: Vec<usize>,
+    time_deltas: Vec<u64>,
+    // self time in microseconds per collapsed stack
+    collapsed: HashMap<String, u64>,
+    raw: Vec<JSSampleFrame>,
+}
+
+impl Profiler {
+    pub fn new(interval: Duration) -> Self {
+        let now = Instant::now();
+        Profiler {
+            interval,
+            start: now,
+            start_us: SystemTime::now()
+                .duration_since(UNIX_EPOCH)
+                .unwrap_or_default()
+                .as_micros(),
+            last: now,
+            nodes: vec![Node {
+                frame: Frame::synthetic("(root)"),
+                children: HashMap::new(),
+                hit_count: 0,
+            }],
+            samples: vec![],
+            time_deltas: vec![],
+            collapsed: HashMap::new(),
+            raw: Vec::with_capacity(MAX_FRAMES),
+        }
+    }
+
+    /// Called from the interrupt handler.
+    pub(crate) fn tick(&mut self, rt: *mut JSRuntime) {
+        if self.last.elapsed() >= self.interval {
+            self.mark_rt(rt, None);
+        }
+    }
+
+    /// Charges the time since the previous sample to the current stack,
+    /// with `label` as an extra innermost frame when given.
+    pub fn mark(&mut self, ctx: &mut Context, label: Option<&str>) {
+        unsafe { self.mark_rt(ctx.rt(), label) }
+    }
+
+    pub(crate) fn mark_rt(&mut self, rt: *mut JSRuntime, label: Option<&str>) {
+        let now = Instant::now();
+        let delta = now.duration_since(self.last).as_micros() as u64;
+        self.last = now;
+
+        let mut stack = self.sample_stack(rt);
+        if let Some(label) = label {
+            stack.push(Frame::synthetic(label));
+        } else if stack.is_empty() {
+            stack.push(Frame::synthetic("(program)"));
+        }
+        self.record(&stack, delta);
+    }
+
+    /// Outermost frame first.
+    fn sample_stack(&mut self, rt: *mut JSRuntime) -> Vec<Frame> {
+        unsafe {
+            self.raw.set_len(0);
+            let n = js_sample_stack(rt, self.raw.as_mut_ptr(), MAX_FRAMES as i32);
+            self.raw.set_len(n.max(0) as usize);
+        }
+        self.raw
+            .iter()
+            .rev()
+            .map(|f| unsafe {
+                let name = std::ffi::CStr::from_ptr(f.func_name.as_ptr()).to_string_lossy();
+                let file = std::ffi::CStr::from_ptr(f.file_name.as_ptr()).to_string_lossy();
+                Frame {
+                    name: if name.is_empty() {
+                        "(anonymous)".to_string()
+                    } else {
+                        name.into_owned()
+                    },
+                    file: file.into_owned(),
+                    line: f.line_num,
+                }
+            })
+            .collect()
+    }
+
+    fn record(&mut self, stack: &[Frame], delta_us: u64) {
+        let mut node = 0;
+        for frame in stack {
+            node = match self.nodes[node].children.get(frame) {
+                Some(&child) => child,
+                None => {
+                    let child = self.nodes.len();
+                    self.nodes.push(Node {
+                        frame: frame.clone(),
+                        children: HashMap::new(),
+                        hit_count: 0,
+                    });
+                    self.nodes[node].children.insert(frame.clone(), child);
+                    child
+                }
+            };
+        }
+        self.nodes[node].hit_count += 1;
+        self.samples.push(node);
+        self.time_deltas.push(delta_us);
+
+        let key = stack
+            .iter()
+            .map(|f| {
+                if f.file.is_empty() {
+                    f.name.clone()
+                } else {
+                    format!("{} {}:{}", f.name, f.file, f.line)
+                }
+            })
+            .collect::<Vec<_>>()
+            .join(";");
+        *self.collapsed.entry(key).or_insert(0) += delta_us;
+    }
+
+    /// `stack;frames weight_us` lines, the input of flamegraph.pl/inferno.
+    pub fn write_collapsed<W: Write>(&self, w: &mut W) -> std::io::Result<()> {
+        let mut lines: Vec<_> = self.collapsed.iter().collect();
+        lines.sort();
+        for (stack, us) in lines {
+            writeln!(w, "{} {}", stack, us)?;
+        }
+        Ok(())
+    }
+
+    /// Chrome DevTools `.cpuprofile` JSON.
+    pub fn write_cpuprofile<W: Write>(&self, w: &mut W) -> std::io::Result<()> {
+        let mut scripts: HashMap<&str, usize> = HashMap::new();
+        write!(w, "{{\"nodes\":[")?;
+        for (id, node) in self.nodes.iter().enumerate() {
+            let next_script_id = scripts.len() + 1;
+            let script_id = if node.frame.file.is_empty() {
+                0
+            } else {
+                *scripts.entry(node.frame.file.as_str()).or_insert(next_script_id)
+            };
+            let mut children: Vec<_> = node.children.values().map(|c| c + 1).collect();
+            children.sort();
+            write!(
+                w,
+                "{}{{\"id\":{},\"callFrame\":{{\"functionName\":{},\"scriptId\":\"{}\",\"url\":{},\"lineNumber\":{},\"columnNumber\":-1}},\"hitCount\":{},\"children\":{:?}}}",
+                if id == 0 { "" } else { "," },
+                id + 1,
+                json_string(&node.frame.name),
+                script_id,
+                json_string(&node.frame.file),
+                node.frame.line - 1,
+                node.hit_count,
+                children
+            )?;
+        }
+        let samples: Vec<_> = self.samples.iter().map(|s| s + 1).collect();
+        write!(
+            w,
+            "],\"startTime\":{},\"endTime\":{},\"samples\":{:?},\"timeDeltas\":{:?}}}",
+            self.start_us,
+            self.start_us + self.start.elapsed().as_micros(),
+            samples,
+            self.time_deltas
+        )
+    }
+}
+
+pub fn json_string(s: &str) -> String {
+    let mut out = String::with_capacity(s.len() + 2);
+    out.push('"');
+    for c in s.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            c if (c as u32) < 0x20 => out.push_str(&format!("\\u{:04x}", c as u32)),
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+    out
+}
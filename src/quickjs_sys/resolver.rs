@@ -1,6 +1,8 @@
+use crate::trace;
 use crate::transpiler::{tsx_to_js_str, tsx_to_js_vec, OutputType};
 use flate2::bufread::GzDecoder;
 use lazy_static::lazy_static;
+use std::collections::HashMap;
 use std::fs;
 use std::io::Read;
 use std::io::{Error, ErrorKind};
@@ -24,10 +26,29 @@ lazy_static! {
         }
         file_list
     };
+    // Decompressed once, the archive used to be inflated on every import.
+    static ref EMBEDDED_MODULES_FILES: HashMap<String, Vec<u8>> = {
+        let file_bytes = GzDecoder::new(&EMBEDDED_MODULES[..]);
+        let mut archive = Archive::new(file_bytes);
+        let mut files = HashMap::new();
+        for file in archive.entries().unwrap() {
+            let mut file = file.unwrap();
+            let path = file.path().unwrap().to_str().unwrap().to_string();
+            let mut content = Vec::new();
+            if file.read_to_end(&mut content).is_ok() {
+                files.insert(path, content);
+            }
+        }
+        files
+    };
 }
 
 pub fn resolve(module_name: &str) -> Result<String, Error> {
-    let mut path = PathBuf::from(module_name);
+    // drop's own modules, `drop:tar` is embedded as drop/tar.js
+    let mut path = match module_name.strip_prefix("drop:") {
+        Some(name) => PathBuf::from("drop").join(name),
+        None => PathBuf::from(module_name),
+    };
     let ext = path
         .extension()
         .unwrap_or_default()
@@ -49,15 +70,23 @@ pub fn resolve(module_name: &str) -> Result<String, Error> {
 }
 
 pub fn require(module_name: &str) -> Result<Vec<u8>, Error> {
-    let path = resolve(module_name);
-    if is_embedded_module(module_name) {
+    let (path, embedded) = {
+        let _span = trace::span("resolve", "module");
+        (resolve(module_name), is_embedded_module(module_name))
+    };
+    if embedded {
+        let _span = trace::span("embedded read", "module");
         let path = PathBuf::from("modules").join(path?);
         read_embedded_module(&path)
     } else {
-        let buf = fs::read(path.unwrap());
+        let buf = {
+            let _span = trace::span("fs read", "module");
+            fs::read(path?)?
+        };
+        let _span = trace::span("transpile", "module");
         tsx_to_js_vec(
             Some(module_name),
-            &String::from_utf8(buf.unwrap()).unwrap(),
+            &String::from_utf8(buf).map_err(|e| Error::new(ErrorKind::InvalidData, e))?,
             &OutputType::CommonJS,
         )
         .map_err(|e| Error::new(ErrorKind::Other, e))
@@ -65,21 +94,33 @@ pub fn require(module_name: &str) -> Result<Vec<u8>, Error> {
 }
 
 pub fn import(module_name: &str) -> Result<Vec<u8>, Error> {
-    let path = resolve(module_name);
-    if is_embedded_module(module_name) {
+    let (path, embedded) = {
+        let _span = trace::span("resolve", "module");
+        (resolve(module_name), is_embedded_module(module_name))
+    };
+    if embedded {
+        let _span = trace::span("embedded read", "module");
         let path = PathBuf::from("modules").join(path?);
         read_embedded_module(&path)
     } else {
-        let buf = fs::read(path.unwrap());
+        let buf = {
+            let _span = trace::span("fs read", "module");
+            fs::read(path?)?
+        };
+        let _span = trace::span("transpile", "module");
         tsx_to_js_vec(
             Some(module_name),
-            &String::from_utf8(buf.unwrap()).unwrap(),
+            &String::from_utf8(buf).map_err(|e| Error::new(ErrorKind::InvalidData, e))?,
             &OutputType::ESModule,
         )
         .map_err(|e| Error::new(ErrorKind::Other, e))
     }
 }
 
+pub fn is_embedded(module_name_or_path: &str) -> bool {
+    is_embedded_module(module_name_or_path)
+}
+
 fn is_embedded_module(module_name_or_path: &str) -> bool {
     let resolved = resolve(module_name_or_path).unwrap_or("".to_string());
     EMBEDDED_MODULES_LIST
@@ -89,19 +130,11 @@ fn is_embedded_module(module_name_or_path: &str) -> bool {
 
 fn read_embedded_module(path: &PathBuf) -> Result<Vec<u8>, Error> {
     let file_name = path.to_str().unwrap();
-    let file_bytes = GzDecoder::new(&EMBEDDED_MODULES[..]);
-    let mut archive = Archive::new(file_bytes);
-    for file in archive.entries().unwrap() {
-        let mut file = file.unwrap();
-        let file_path = file.path().unwrap();
-        if file_path.to_str().unwrap() == file_name {
-            let mut content = Vec::new();
-            file.read_to_end(&mut content)?;
-            return Ok(content);
-        }
+    match EMBEDDED_MODULES_FILES.get(file_name) {
+        Some(content) => Ok(content.clone()),
+        None => Err(Error::new(
+            ErrorKind::NotFound,
+            format!("could not load embedded module: {}", path.to_str().unwrap()),
+        )),
     }
-    Err(Error::new(
-        ErrorKind::NotFound,
-        format!("could not load embedded module: {}", path.to_str().unwrap()),
-    ))
 }
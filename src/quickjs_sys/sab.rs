@@ -0,0 +1,101 @@
+// SharedArrayBuffer memory shared by every runtime in the process.
+//
+// QuickJS hands SharedArrayBuffer allocation to these hooks. Each block
+// carries an atomic reference count in front of the data, so a buffer
+// posted to a worker stays alive until the last runtime holding it frees
+// it. With wasi-threads the linear memory itself is shared, so the data
+// pointer is valid on every thread.
+
+use super::qjs::*;
+use std::alloc::{alloc_zeroed, dealloc, Layout};
+use std::os::raw::c_void;
+use std::sync::atomic::{fence, AtomicUsize, Ordering};
+
+#[repr(C)]
+struct SabHeader {
+    ref_count: AtomicUsize,
+    size: usize,
+}
+
+// keeps the data 16-byte aligned for any typed array view
+const HEADER_SIZE: usize = 16;
+const ALIGN: usize = 16;
+
+unsafe fn header(ptr: *mut c_void) -> *mut SabHeader {
+    (ptr as *mut u8).sub(HEADER_SIZE) as *mut SabHeader
+}
+
+/// Zeroed block with one reference.
+unsafe fn sab_alloc_raw(size: usize) -> *mut c_void {
+    let layout = match Layout::from_size_align(HEADER_SIZE + size, ALIGN) {
+        Ok(layout) => layout,
+        Err(_) => return std::ptr::null_mut(),
+    };
+    let p = alloc_zeroed(layout);
+    if p.is_null() {
+        return std::ptr::null_mut();
+    }
+    (p as *mut SabHeader).write(SabHeader {
+        ref_count: AtomicUsize::new(1),
+        size,
+    });
+    p.add(HEADER_SIZE).cast()
+}
+
+pub(crate) unsafe fn sab_retain(ptr: *mut c_void) {
+    (*header(ptr)).ref_count.fetch_add(1, Ordering::Relaxed);
+}
+
+pub(crate) unsafe fn sab_release(ptr: *mut c_void) {
+    let h = header(ptr);
+    if (*h).ref_count.fetch_sub(1, Ordering::Release) == 1 {
+        fence(Ordering::Acquire);
+        let layout = Layout::from_size_align_unchecked(HEADER_SIZE + (*h).size, ALIGN);
+        dealloc(h.cast(), layout);
+    }
+}
+
+unsafe extern "C" fn sab_alloc(_opaque: *mut c_void, size: usize) -> *mut c_void {
+    sab_alloc_raw(size)
+}
+
+unsafe extern "C" fn sab_free(_opaque: *mut c_void, ptr: *mut c_void) {
+    sab_release(ptr)
+}
+
+unsafe extern "C" fn sab_dup(_opaque: *mut c_void, ptr: *mut c_void) {
+    sab_retain(ptr)
+}
+
+pub(crate) unsafe fn install(rt: *mut JSRuntime) {
+    let funcs = JSSharedArrayBufferFunctions {
+        sab_alloc: Some(sab_alloc),
+        sab_free: Some(sab_free),
+        sab_dup: Some(sab_dup),
+        sab_opaque: std::ptr::null_mut(),
+    };
+    JS_SetSharedArrayBufferFunctions(rt, &funcs);
+    // lets Atomics.wait block, workers and the main thread alike
+    JS_SetCanBlock(rt, 1);
+}
+
+/// A reference to shared memory held by a serialized message while it
+/// travels between threads.
+pub struct SabRef(*mut c_void);
+
+// the block is reference counted atomically and never moves
+unsafe impl Send for SabRef {}
+
+impl SabRef {
+    /// Takes a new reference to `ptr`.
+    pub(crate) unsafe fn retain(ptr: *mut c_void) -> Self {
+        sab_retain(ptr);
+        SabRef(ptr)
+    }
+}
+
+impl Drop for SabRef {
+    fn drop(&mut self) {
+        unsafe { sab_release(self.0) }
+    }
+}
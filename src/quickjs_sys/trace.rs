@@ -0,0 +1,123 @@
+// Chrome trace-event recorder for runtime phases (`--trace-events`).
+//
+// Spans are RAII guards recording a complete ("X") event when dropped. The
+// recorder is thread local and disabled by default; a disabled `span` is a
+// single flag check and allocates nothing.
+
+use super::profiler::json_string;
+use std::cell::{Cell, RefCell};
+use std::io::Write;
+use std::time::Instant;
+
+struct Event {
+    name: &'static str,
+    cat: &'static str,
+    detail: Option<String>,
+    ts: u64,
+    dur: u64,
+}
+
+struct Recorder {
+    start: Instant,
+    events: Vec<Event>,
+}
+
+thread_local! {
+    static ENABLED: Cell<bool> = Cell::new(false);
+    static RECORDER: RefCell<Option<Recorder>> = RefCell::new(None);
+}
+
+/// Starts recording, timestamps are relative to this call.
+pub fn enable() {
+    RECORDER.with(|r| {
+        *r.borrow_mut() = Some(Recorder {
+            start: Instant::now(),
+            events: vec![],
+        })
+    });
+    ENABLED.with(|e| e.set(true));
+}
+
+#[inline]
+pub fn is_enabled() -> bool {
+    ENABLED.with(|e| e.get())
+}
+
+pub struct Span {
+    name: &'static str,
+    cat: &'static str,
+    detail: Option<String>,
+    start: Option<Instant>,
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        if let Some(start) = self.start {
+            let end = Instant::now();
+            let detail = self.detail.take();
+            RECORDER.with(|r| {
+                if let Some(r) = r.borrow_mut().as_mut() {
+                    r.events.push(Event {
+                        name: self.name,
+                        cat: self.cat,
+                        detail,
+                        ts: start.duration_since(r.start).as_micros() as u64,
+                        dur: end.duration_since(start).as_micros() as u64,
+                    });
+                }
+            });
+        }
+    }
+}
+
+#[inline]
+pub fn span(name: &'static str, cat: &'static str) -> Span {
+    Span {
+        name,
+        cat,
+        detail: None,
+        start: if is_enabled() {
+            Some(Instant::now())
+        } else {
+            None
+        },
+    }
+}
+
+/// Like `span`, `detail` (e.g. a module name) is only built when tracing.
+#[inline]
+pub fn span_with<F: FnOnce() -> String>(name: &'static str, cat: &'static str, detail: F) -> Span {
+    let mut span = span(name, cat);
+    if span.start.is_some() {
+        span.detail = Some(detail());
+    }
+    span
+}
+
+/// Writes the JSON object format understood by Perfetto and chrome://tracing.
+pub fn write<W: Write>(w: &mut W) -> std::io::Result<()> {
+    RECORDER.with(|r| {
+        let r = r.borrow();
+        let events = match r.as_ref() {
+            Some(r) => &r.events[..],
+            None => &[],
+        };
+        write!(w, "{{\"traceEvents\":[")?;
+        for (i, e) in events.iter().enumerate() {
+            write!(
+                w,
+                "{}{{\"name\":{},\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{},\"dur\":{},\"pid\":1,\"tid\":1",
+                if i == 0 { "" } else { ",\n" },
+                json_string(e.name),
+                e.cat,
+                e.ts,
+                e.dur
+            )?;
+            if let Some(detail) = &e.detail {
+                write!(w, ",\"args\":{{\"detail\":{}}}", json_string(detail))?;
+            }
+            write!(w, "}}")?;
+        }
+        write!(w, "],\"displayTimeUnit\":\"ms\"}}")
+    })
+}
@@ -4,7 +4,13 @@ import events from "events";
 import fs from "fs";
 import memfs from "memfs";
 import path from "path";
+import perf_hooks from "perf_hooks";
+import process from "process";
+import querystring from "querystring";
 import stream from "stream";
+import string_decoder from "string_decoder";
+import json from "drop:json";
+import tar from "drop:tar";
 import url from "url";
 import util from "util";
 import zlib from "zlib";
@@ -19,10 +25,27 @@ console.log(test.content);
 console.log("testing url:");
 console.log("------------------");
 console.log(Object.keys(url));
+const parsed = new url.URL("/a/b?x=1#top", "https://user@ex\u00e4mple.com:8443/");
+console.log(parsed.href, parsed.host, parsed.pathname, parsed.search, parsed.hash, url.domainToASCII("b\u00fccher.de"));
+console.log(querystring.parse("a=1&a=2&b=x+y%21"), querystring.stringify({ q: "caf\u00e9 & co" }));
+parsed.searchParams.append("page", "2 3");
+console.log(parsed.search, parsed.searchParams.get("x"));
+console.log(new url.URL("https://ex.com/?q=\ud800&z=\u0000z").search);
 
 console.log("testing zlib:");
 console.log("------------------");
 console.log(Object.keys(zlib));
+console.log(zlib.gunzipSync(zlib.gzipSync("hello zlib")).toString());
+for (const call of [
+	() => zlib.inflateSync(zlib.deflateSync("hello zlib").subarray(0, 6)),
+	() => zlib.deflateSync("hello zlib", { level: 12 }),
+]) {
+	try {
+		call();
+	} catch (e) {
+		console.log(e.code, e.message);
+	}
+}
 
 console.log("testing memfs:");
 console.log("------------------");
@@ -43,11 +66,54 @@ console.log(Object.keys(events));
 console.log("testing buffer:");
 console.log("------------------");
 console.log(Object.keys(buffer));
+const b64 = buffer.Buffer.from("hello world").toString("base64");
+console.log(b64, buffer.Buffer.from(b64, "base64").toString("hex"));
+const lines = buffer.Buffer.from("one\ntwo\nthree\n");
+console.log(lines.buffer.byteLength === buffer.Buffer.poolSize, lines.byteOffset % 8);
+console.log(lines.indexOf("\n"), lines.lastIndexOf("\n"), lines.indexOf("two"), lines.equals(buffer.Buffer.from("one")));
+const euro = buffer.Buffer.from("\u20ac");
+const decoder = new string_decoder.StringDecoder("utf8");
+console.log(JSON.stringify([decoder.write(euro.subarray(0, 1)), decoder.write(euro.subarray(1)), decoder.end()]));
 
 console.log("testing path:");
 console.log("------------------");
 console.log(Object.keys(path));
 
+console.log("testing tar:");
+console.log("------------------");
+tar.packSync("test.tar.gz", ["test.ts"], { gzip: true });
+console.log(tar.listSync("test.tar.gz").map((e) => [e.path, e.type]));
+fs.unlinkSync("test.tar.gz");
+// a symlink out of the destination, and a file written through one
+function tarHeader(name: string, type: string, link = "") {
+	const h = new Uint8Array(512);
+	const put = (s: string, at: number) => h.set(buffer.Buffer.from(s), at);
+	put(name, 0);
+	put("0000644\u00000000000\u00000000000\u000000000000000\u000000000000000", 100);
+	put("        " + type + link, 148);
+	put("ustar\u000000", 257);
+	put(h.reduce((sum, b) => sum + b, 0).toString(8).padStart(6, "0") + "\u0000", 148);
+	return h;
+}
+for (const entries of [[tarHeader("up", "2", "..")], [tarHeader("s/b", "2", ".."), tarHeader("s/b/evil", "0")]]) {
+	fs.writeFileSync("evil.tar", buffer.Buffer.concat([...entries, new Uint8Array(1024)]));
+	try {
+		tar.extractSync("evil.tar", { cwd: "evil" });
+	} catch (e) {
+		console.log(e.message);
+	}
+}
+fs.unlinkSync("evil/s/b");
+fs.rmdirSync("evil/s");
+fs.rmdirSync("evil");
+fs.unlinkSync("evil.tar");
+
+console.log("testing json:");
+console.log("------------------");
+const rows = new json.JsonParser({ path: "rows.*" });
+console.log(rows.write('{"skip":[{"x":"]"}],"rows":[{"id":1},'), rows.write('{"id":2}]}'), rows.end());
+console.log([...json.parseFileSync("package.json", { depth: 1, keys: true })].length > 0);
+
 console.log("testing fs:");
 console.log("------------------");
 console.log(Object.keys(fs));
@@ -57,7 +123,50 @@ console.log("------------------");
 const md5 = crypto.createHash("md5");
 md5.update("hello world");
 console.log(md5.digest("hex"));
+console.log(crypto.createHash("sha256").update("hello world").digest("base64"));
+console.log(crypto.createHmac("sha1", "key").update("hello world").digest("hex"));
+console.log(crypto.pbkdf2Sync("password", "salt", 1000, 16, "sha256").toString("hex"));
+const gcmKey = buffer.Buffer.alloc(32, 1);
+const gcmIv = buffer.Buffer.alloc(12, 2);
+const gcm = crypto.createCipheriv("aes-256-gcm", gcmKey, gcmIv);
+const sealed = buffer.Buffer.concat([gcm.update("secret artifact"), gcm.final()]);
+const opener = crypto.createDecipheriv("aes-256-gcm", gcmKey, gcmIv).setAuthTag(gcm.getAuthTag());
+console.log(buffer.Buffer.concat([opener.update(sealed), opener.final()]).toString());
+for (const call of [
+	() => crypto.createDecipheriv("aes-128-cbc", gcmKey.subarray(0, 16), gcmKey.subarray(0, 16)).final(),
+	() => gcm.final(),
+	() => gcm.update("more"),
+]) {
+	try {
+		call();
+	} catch (e) {
+		console.log(e.code, e.message);
+	}
+}
+console.log(/^[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}$/.test(crypto.randomUUID()), crypto.randomBytes(32).length);
+console.log(crypto.hashFile("test.ts") === crypto.createHash("sha256").update(fs.readFileSync("test.ts")).digest("hex"));
+
+console.log("testing encoding:");
+console.log("------------------");
+const encoded = new TextEncoder().encode("h\u00e9llo \u20ac\ud83d\ude00");
+console.log(encoded.length, new TextDecoder().decode(encoded.subarray(1, 3)));
+console.log(new TextEncoder().encodeInto("\u00e9\u00e9", new Uint8Array(3)));
 
 console.log("testing commonjs:");
 console.log("------------------");
 console.log(JSON.stringify(require("./test.cjs")));
+
+console.log("testing process:");
+console.log("------------------");
+const usage = process.memoryUsage();
+console.log(Object.keys(usage), usage.heapUsed > 0 && usage.heapUsed <= usage.heapTotal);
+
+console.log("testing perf_hooks:");
+console.log("------------------");
+const delay = perf_hooks.monitorEventLoopDelay({ resolution: 5 });
+delay.enable();
+setTimeout(() => {
+	delay.disable();
+	console.log(delay.count > 0, delay.percentile(50) >= 5e6);
+	console.log(perf_hooks.performance.eventLoopUtilization());
+}, 50);
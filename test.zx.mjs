@@ -11,4 +11,24 @@ use(chaiAsPromised);
 	await assert.isFulfilled($`node ./dist/bin.js node test.ts`);
 	await assert.isFulfilled($`node ./dist/bin.js true`);
 	await assert.isRejected($`node ./dist/bin.js false`);
+
+	// serve mode: jobs queued by a script that exits must not run in the next one
+	fs.writeFileSync("serve-exit.js", "Promise.resolve().then(() => console.log('stale job'));\nprocess.exit(3);\n");
+	fs.writeFileSync("serve-next.js", "console.log('next job');\n");
+	fs.writeFileSync("serve-jobs.txt", "serve-exit.js\nserve-next.js\n");
+	const serve = `require("./dist/index.js")
+		.serveDrop({ stdin: require("fs").openSync("serve-jobs.txt", "r") })
+		.then(({ exec }) => exec());`;
+	try {
+		const { stdout, stderr } = await $`node --experimental-wasi-unstable-preview1 --no-warnings -e ${serve}`;
+		assert.notInclude(stdout, "stale job");
+		assert.include(stdout, "next job");
+		const statuses = stderr
+			.split("\n")
+			.filter((line) => line.startsWith('{"file"'))
+			.map((line) => JSON.parse(line).status);
+		assert.deepEqual(statuses, ["exit", "ok"]);
+	} finally {
+		for (const file of ["serve-exit.js", "serve-next.js", "serve-jobs.txt"]) fs.unlinkSync(file);
+	}
 })();
@@ -2,7 +2,7 @@ import TerserPlugin from "terser-webpack-plugin";
 import path from "path";
 import webpack from "webpack";
 
-const ALL_PACKAGES = ["crypto", "memfs", "zlib", "uvu", "chai"];
+const ALL_PACKAGES = ["crypto", "memfs", "uvu", "chai"];
 
 const createConfig = (name) => {
 	/** @type {webpack.Configuration} */
@@ -24,6 +24,7 @@ const createConfig = (name) => {
 		externals: {
 			"safer-buffer": "buffer",
 			"safe-buffer": "buffer",
+			"_node:crypto": "_node:crypto",
 			...[
 				"assert",
 				"buffer",
@@ -31,6 +32,7 @@ const createConfig = (name) => {
 				"fs",
 				"os",
 				"path",
+				"perf_hooks",
 				"process",
 				"punycode",
 				"querystring",
@@ -41,6 +43,8 @@ const createConfig = (name) => {
 				"tty",
 				"url",
 				"util",
+				"worker_threads",
+				"zlib",
 			]
 				.concat(ALL_PACKAGES.filter((p) => p !== name))
 				.reduce((acc, curr) => ((acc[curr] = curr), acc), {}),